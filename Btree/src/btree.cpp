@@ -5,9 +5,17 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <cstddef>
 #include "btree.h"
+#include "node_search.h"
 #include "filescan.h"
+#include "exceptions/badgerdb_exception.h"
 #include "exceptions/bad_index_info_exception.h"
+#include "exceptions/key_too_long_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
 #include "exceptions/no_such_key_found_exception.h"
@@ -24,704 +32,5126 @@
 namespace badgerdb
 {
 
+	// -----------------------------------------------------------------------------
+	// readKey
+	// Copy a key given as pointer to integer / double / char string
+	// @param maxLength: longest char string key of the index, see BTreeIndex::keySize
+	// -----------------------------------------------------------------------------
+	static inline void readKey(const void* ptr, int& key, int maxLength)
+	{
+		key = *((const int *) ptr);
+	}
+
+	static inline void readKey(const void* ptr, double& key, int maxLength)
+	{
+		key = *((const double *) ptr);
+	}
+
+	static inline void readKey(const void* ptr, std::string& key, int maxLength)
+	{
+		const char *s = (const char *) ptr;
+		key.assign(s, strnlen(s, maxLength));
+	}
+
+	// -----------------------------------------------------------------------------
+	// keyPointer
+	// A key as pointer to integer / double / char string, the inverse of readKey
+	// -----------------------------------------------------------------------------
+	static inline const void* keyPointer(const int& key) { return &key; }
+	static inline const void* keyPointer(const double& key) { return &key; }
+	static inline const void* keyPointer(const std::string& key) { return key.c_str(); }
+
+	// -----------------------------------------------------------------------------
+	// keyLength
+	// Number of bytes keyPointer() points to, without the terminator of a char string
+	// -----------------------------------------------------------------------------
+	static inline size_t keyLength(const int& key) { return sizeof(key); }
+	static inline size_t keyLength(const double& key) { return sizeof(key); }
+	static inline size_t keyLength(const std::string& key) { return key.size(); }
+
+	// -----------------------------------------------------------------------------
+	// bloomHash
+	// Mix the bits of a 32 bit value (the MurmurHash3 finalizer)
+	// -----------------------------------------------------------------------------
+	static inline unsigned int bloomHash(unsigned int x)
+	{
+		x ^= x >> 16;
+		x *= 0x85ebca6b;
+		x ^= x >> 13;
+		x *= 0xc2b2ae35;
+		x ^= x >> 16;
+		return x;
+	}
+
+	// -----------------------------------------------------------------------------
+	// keyHash
+	// Hash of a key for the Bloom filter. Keys that compare equal hash equally.
+	// -----------------------------------------------------------------------------
+	static inline unsigned int keyHash(int key)
+	{
+		return bloomHash(key);
+	}
+
+	static inline unsigned int keyHash(double key)
+	{
+		//0.0 and -0.0 are the same key
+		if(key == 0)
+			key = 0;
+		unsigned long long bits;
+		memcpy(&bits, &key, sizeof(bits));
+		return bloomHash((unsigned int) bits ^ bloomHash((unsigned int) (bits >> 32)));
+	}
+
+	static inline unsigned int keyHash(const std::string& key)
+	{
+		//FNV-1a over the characters of the key
+		unsigned int hash = 2166136261u;
+		for(size_t i = 0; i < key.size(); i++)
+			hash = (hash ^ (unsigned char) key[i]) * 16777619u;
+		return bloomHash(hash);
+	}
+
+	// -----------------------------------------------------------------------------
+	// commonPrefix
+	// Number of leading characters two keys share
+	// -----------------------------------------------------------------------------
+	static inline int commonPrefix(const std::string& a, const std::string& b)
+	{
+		size_t n = std::min(a.size(), b.size());
+		size_t i = 0;
+		while(i < n && a[i] == b[i])
+			i++;
+		return i;
+	}
+
+	// -----------------------------------------------------------------------------
+	// shortestSeparator
+	// Shortest prefix of right that is greater than left, for left < right.
+	// right itself if the two are equal.
+	// -----------------------------------------------------------------------------
+	static inline std::string shortestSeparator(const std::string& left, const std::string& right)
+	{
+		return right.substr(0, commonPrefix(left, right) + 1);
+	}
+
+	// -----------------------------------------------------------------------------
+	// STRING node helpers
+	// The same for LeafNodeString and NonLeafNodeString, an entry is a
+	// RIDKeyPair<std::string> or a PageKeyPair<std::string> respectively
+	// -----------------------------------------------------------------------------
+	static inline void readSlot(const StringLeafSlot& slot, RIDKeyPair<std::string>& entry) { entry.rid = slot.rid; }
+	static inline void readSlot(const StringNonLeafSlot& slot, PageKeyPair<std::string>& entry) { entry.pageNo = slot.pageNo; }
+	static inline void writeSlot(StringLeafSlot& slot, const RIDKeyPair<std::string>& entry) { slot.rid = entry.rid; }
+	static inline void writeSlot(StringNonLeafSlot& slot, const PageKeyPair<std::string>& entry) { slot.pageNo = entry.pageNo; }
+
+	template <class Node>
+	static inline const char* nodePrefix(const Node* node)
+	{
+		return (const char *) node + Page::SIZE - node->prefixLength;
+	}
+
+	template <class Node>
+	static inline int freeSpace(const Node* node)
+	{
+		return node->heapBegin - ((const char *) (node->slotArray + node->numKeys) - (const char *) node);
+	}
+
+	template <class Node>
+	static inline std::string keyAt(const Node* node, int i)
+	{
+		std::string key(nodePrefix(node), node->prefixLength);
+		key.append((const char *) node + node->slotArray[i].offset, node->slotArray[i].length);
+		return key;
+	}
+
+	// -----------------------------------------------------------------------------
+	// stringSearch
+	// Slot of the first key >= key, or > key if upper is set. A key that does not
+	// start with the prefix of the node is before or after all of its keys.
+	// -----------------------------------------------------------------------------
+	template <class Node>
+	static int stringSearch(const Node* node, const std::string& key, bool upper)
+	{
+		int prefixLength = node->prefixLength;
+		int c = memcmp(key.data(), nodePrefix(node), std::min((int) key.size(), prefixLength));
+		if(c < 0 || (c == 0 && (int) key.size() < prefixLength))
+			return 0;
+		if(c > 0)
+			return node->numKeys;
+
+		//Only the rest of the key is compared with the slots
+		const char *rest = key.data() + prefixLength;
+		int restLength = key.size() - prefixLength;
+		int low = 0;
+		int high = node->numKeys;
+		while(low < high){
+			int mid = (low + high) / 2;
+			int length = node->slotArray[mid].length;
+			int c = memcmp((const char *) node + node->slotArray[mid].offset, rest, std::min(length, restLength));
+			if(c == 0)
+				c = length - restLength;
+			if(c < 0 || (upper && c == 0))
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		return low;
+	}
+
+	// -----------------------------------------------------------------------------
+	// encodedSize
+	// Bytes a node holding entries [begin, end) takes
+	// -----------------------------------------------------------------------------
+	template <class Node, class Entry>
+	static int encodedSize(const std::vector<Entry>& entries, size_t begin, size_t end)
+	{
+		int prefixLength = end > begin ? commonPrefix(entries[begin].key, entries[end - 1].key) : 0;
+		int size = offsetof(Node, slotArray) + (end - begin) * sizeof(Node::slotArray[0]) + prefixLength;
+		for(size_t i = begin; i < end; i++)
+			size += entries[i].key.size() - prefixLength;
+		return size;
+	}
+
+	// -----------------------------------------------------------------------------
+	// encodeNode, decodeNode
+	// Write entries [begin, end) into the node, its prefix being the one of the
+	// first and the last key. Read all entries of the node.
+	// -----------------------------------------------------------------------------
+	template <class Node, class Entry>
+	static void encodeNode(Node* node, const std::vector<Entry>& entries, size_t begin, size_t end)
+	{
+		int prefixLength = end > begin ? commonPrefix(entries[begin].key, entries[end - 1].key) : 0;
+		char *base = (char *) node;
+		int heap = Page::SIZE - prefixLength;
+		if(prefixLength > 0)
+			memcpy(base + heap, entries[begin].key.data(), prefixLength);
+		for(size_t i = begin; i < end; i++){
+			int length = entries[i].key.size() - prefixLength;
+			heap -= length;
+			memcpy(base + heap, entries[i].key.data() + prefixLength, length);
+			node->slotArray[i - begin].offset = heap;
+			node->slotArray[i - begin].length = length;
+			writeSlot(node->slotArray[i - begin], entries[i]);
+		}
+		node->numKeys = end - begin;
+		node->prefixLength = prefixLength;
+		node->heapBegin = heap;
+	}
+
+	template <class Node, class Entry>
+	static void decodeNode(const Node* node, std::vector<Entry>& entries)
+	{
+		entries.resize(node->numKeys);
+		for(int i = 0; i < node->numKeys; i++){
+			entries[i].key = keyAt(node, i);
+			readSlot(node->slotArray[i], entries[i]);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// insertInPlace
+	// Insert the entry at slot pos without rewriting the node
+	// @return: false if the key does not start with the prefix of the node or
+	//	    there is no room for it, nothing was inserted then
+	// -----------------------------------------------------------------------------
+	template <class Node, class Entry>
+	static bool insertInPlace(Node* node, int pos, const Entry& entry)
+	{
+		int prefixLength = node->prefixLength;
+		if((int) entry.key.size() < prefixLength || memcmp(entry.key.data(), nodePrefix(node), prefixLength) != 0)
+			return false;
+		int length = entry.key.size() - prefixLength;
+		if(freeSpace(node) < (int) sizeof(node->slotArray[0]) + length)
+			return false;
+
+		memmove(node->slotArray + pos + 1, node->slotArray + pos, (node->numKeys - pos) * sizeof(node->slotArray[0]));
+		node->heapBegin -= length;
+		memcpy((char *) node + node->heapBegin, entry.key.data() + prefixLength, length);
+		node->slotArray[pos].offset = node->heapBegin;
+		node->slotArray[pos].length = length;
+		writeSlot(node->slotArray[pos], entry);
+		node->numKeys++;
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// insertRewrite
+	// Insert the entry at slot pos and write the node again with the prefix of
+	// all its keys
+	// @param entries: receives all entries of the node, the new one included
+	// @return: false if they do not fit a page, the node is unchanged then
+	// -----------------------------------------------------------------------------
+	template <class Node, class Entry>
+	static bool insertRewrite(Node* node, int pos, const Entry& entry, std::vector<Entry>& entries)
+	{
+		decodeNode(node, entries);
+		entries.insert(entries.begin() + pos, entry);
+		if(encodedSize<Node>(entries, 0, entries.size()) > (int) Page::SIZE)
+			return false;
+		encodeNode(node, entries, 0, entries.size());
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// fitSplitPoint
+	// Move the split point keep until both nodes fit a page. The left node holds
+	// entries [0, keep), the right one [keep + gap, end), gap is 1 if the entry
+	// at keep is pushed up.
+	// -----------------------------------------------------------------------------
+	template <class Node, class Entry>
+	static int fitSplitPoint(const std::vector<Entry>& entries, int keep, int gap)
+	{
+		int total = entries.size();
+		while(keep > 1 && encodedSize<Node>(entries, 0, keep) > (int) Page::SIZE)
+			keep--;
+		while(keep + gap < total - 1 && encodedSize<Node>(entries, keep + gap, total) > (int) Page::SIZE)
+			keep++;
+		return keep;
+	}
+
+	// -----------------------------------------------------------------------------
+	// Node accessors
+	// What the descent, the lookups and the scans need of a node, for the fixed
+	// size nodes and the STRING ones
+	// -----------------------------------------------------------------------------
+	template <class T>
+	static inline int leafLowerBound(const LeafNode<T>* leaf, const T& key) { return lowerBoundKey(leaf->keyArray, leaf->numKeys, key); }
+	template <class T>
+	static inline int leafUpperBound(const LeafNode<T>* leaf, const T& key) { return upperBoundKey(leaf->keyArray, leaf->numKeys, key); }
+	template <class T>
+	static inline bool leafKeyEquals(const LeafNode<T>* leaf, int i, const T& key) { return leaf->keyArray[i] == key; }
+	template <class T>
+	static inline RecordId leafRid(const LeafNode<T>* leaf, int i) { return leaf->ridArray[i]; }
+	template <class T>
+	static inline T leafKey(const LeafNode<T>* leaf, int i) { return leaf->keyArray[i]; }
+	template <class T>
+	static inline void copyRids(const LeafNode<T>* leaf, int begin, int end, bool reverse, RecordId* outRids)
+	{
+		if(reverse)
+			std::reverse_copy(leaf->ridArray + begin, leaf->ridArray + end, outRids);
+		else
+			std::copy(leaf->ridArray + begin, leaf->ridArray + end, outRids);
+	}
+	template <class T>
+	static inline int searchChildren(const NonLeafNode<T>* node, int numKeys, const T& key, bool upper)
+	{
+		return upper ? upperBoundKey(node->keyArray, numKeys, key) : lowerBoundKey(node->keyArray, numKeys, key);
+	}
+	static inline int searchChildren(const NonLeafNode<int>* node, int numKeys, int key, bool upper)
+	{
+		return upper ? directorySearch<true>(node->groupKeys, node->lineKeys, node->keyArray, numKeys, key)
+			: directorySearch<false>(node->groupKeys, node->lineKeys, node->keyArray, numKeys, key);
+	}
+	template <class T>
+	static inline int childIndex(const NonLeafNode<T>* node, const T& key) { return searchChildren(node, node->numKeys, key, true); }
+	template <class T>
+	static inline PageId childPageNo(const NonLeafNode<T>* node, int i) { return node->pageNoArray[i]; }
+
+	// -----------------------------------------------------------------------------
+	// indexSeparators
+	// Write the directory of an INTEGER non-leaf again after its keys changed.
+	// Other non-leaves have none.
+	// -----------------------------------------------------------------------------
+	static_assert(LINEKEYS == NODE_SEARCH_WINDOW, "directorySearch() compares one line of keys at a time");
+
+	template <class Node>
+	static inline void indexSeparators(Node* node) {}
+	static inline void indexSeparators(NonLeafNode<int>* node)
+	{
+		int numLines = node->numKeys / LINEKEYS;
+		for(int line = 0; line < numLines; line++)
+			node->lineKeys[line] = node->keyArray[line * LINEKEYS + LINEKEYS - 1];
+		for(int group = 0; group < numLines / LINEKEYS; group++)
+			node->groupKeys[group] = node->lineKeys[group * LINEKEYS + LINEKEYS - 1];
+	}
+
+	static inline int leafLowerBound(const LeafNodeString* leaf, const std::string& key) { return stringSearch(leaf, key, false); }
+	static inline int leafUpperBound(const LeafNodeString* leaf, const std::string& key) { return stringSearch(leaf, key, true); }
+	static inline bool leafKeyEquals(const LeafNodeString* leaf, int i, const std::string& key) { return keyAt(leaf, i) == key; }
+	static inline const RecordId& leafRid(const LeafNodeString* leaf, int i) { return leaf->slotArray[i].rid; }
+	static inline std::string leafKey(const LeafNodeString* leaf, int i) { return keyAt(leaf, i); }
+	static inline void copyRids(const LeafNodeString* leaf, int begin, int end, bool reverse, RecordId* outRids)
+	{
+		for(int i = 0; i < end - begin; i++)
+			outRids[i] = leaf->slotArray[reverse ? end - 1 - i : begin + i].rid;
+	}
+	static inline int childIndex(const NonLeafNodeString* node, const std::string& key) { return stringSearch(node, key, true); }
+	static inline PageId childPageNo(const NonLeafNodeString* node, int i) { return i == 0 ? node->firstPageNo : node->slotArray[i - 1].pageNo; }
+
+	// The non-leaves of a buffered index, the number of key slots of a non-leaf,
+	// and the buffer a new non-leaf starts with
+	static inline int childIndex(const BufferedNonLeafNode* node, int key) { return upperBoundKey(node->keyArray, node->numKeys, key); }
+	static inline int firstChildIndex(const BufferedNonLeafNode* node, int key) { return lowerBoundKey(node->keyArray, node->numKeys, key); }
+	static inline PageId childPageNo(const BufferedNonLeafNode* node, int i) { return node->pageNoArray[i]; }
+	static inline int separatorAt(const BufferedNonLeafNode* node, int i) { return node->keyArray[i]; }
+	template <class T>
+	static inline int nonLeafCapacity(const NonLeafNode<T>* node) { return nonLeafArraySize<T>(); }
+	static inline int nonLeafCapacity(const BufferedNonLeafNode* node) { return BUFFEREDNONLEAFSIZE; }
+	template <class T>
+	static inline void clearBuffer(NonLeafNode<T>* node) {}
+	static inline void clearBuffer(BufferedNonLeafNode* node) { node->numMessages = 0; }
+
+	// -----------------------------------------------------------------------------
+	// Delete helpers
+	// Removing entries from nodes and rebalancing two siblings, for the fixed
+	// size nodes and the STRING ones. Fixed size nodes are less than half full
+	// below half their slots, STRING nodes below half a page of live bytes.
+	// -----------------------------------------------------------------------------
+	template <class Node>
+	static inline void removeSlot(Node* node, int pos)
+	{
+		//The key bytes stay behind until the node is written again
+		memmove(node->slotArray + pos, node->slotArray + pos + 1, (node->numKeys - pos - 1) * sizeof(node->slotArray[0]));
+		node->numKeys--;
+	}
+
+	template <class Node>
+	static int usedSpace(const Node* node)
+	{
+		int size = offsetof(Node, slotArray) + node->numKeys * sizeof(node->slotArray[0]) + node->prefixLength;
+		for(int i = 0; i < node->numKeys; i++)
+			size += node->slotArray[i].length;
+		return size;
+	}
+
+	// -----------------------------------------------------------------------------
+	// replaceKey
+	// Replace key i of a STRING non-leaf
+	// @return: false if the node does not fit a page with the new key, it is
+	//	    unchanged then
+	// -----------------------------------------------------------------------------
+	static bool replaceKey(NonLeafNodeString* node, int i, const std::string& key)
+	{
+		std::vector<PageKeyPair<std::string> > entries;
+		decodeNode(node, entries);
+		entries[i].key = key;
+		if(encodedSize<NonLeafNodeString>(entries, 0, entries.size()) > (int) Page::SIZE)
+			return false;
+		encodeNode(node, entries, 0, entries.size());
+		return true;
+	}
+
+	template <class T>
+	static inline int firstChildIndex(const NonLeafNode<T>* node, const T& key) { return searchChildren(node, node->numKeys, key, false); }
+	template <class T>
+	static inline T separatorAt(const NonLeafNode<T>* node, int i) { return node->keyArray[i]; }
+	template <class T>
+	static inline void setFirstChild(NonLeafNode<T>* node, PageId pageNo) { node->pageNoArray[0] = pageNo; }
+	template <class T>
+	static inline bool underflow(const LeafNode<T>* leaf) { return leaf->numKeys < leafArraySize<T>() / 2; }
+	template <class T>
+	static inline bool underflow(const NonLeafNode<T>* node) { return node->numKeys < nonLeafArraySize<T>() / 2; }
+
+	static inline int firstChildIndex(const NonLeafNodeString* node, const std::string& key) { return stringSearch(node, key, false); }
+	static inline std::string separatorAt(const NonLeafNodeString* node, int i) { return keyAt(node, i); }
+	static inline void setFirstChild(NonLeafNodeString* node, PageId pageNo) { node->firstPageNo = pageNo; }
+	static inline bool underflow(const LeafNodeString* leaf) { return usedSpace(leaf) < (int) Page::SIZE / 2; }
+	static inline bool underflow(const NonLeafNodeString* node) { return usedSpace(node) < (int) Page::SIZE / 2; }
+
+	// -----------------------------------------------------------------------------
+	// leafRemove
+	// Remove the entry <key, rid> from the leaf
+	// @return: false if the leaf does not hold it
+	// -----------------------------------------------------------------------------
+	template <class T>
+	static bool leafRemove(LeafNode<T>* leaf, const T& key, const RecordId& rid)
+	{
+		for(int pos = leafLowerBound(leaf, key); pos < leaf->numKeys && leaf->keyArray[pos] == key; pos++){
+			if(leafRid(leaf, pos) == rid){
+				std::copy(leaf->keyArray + pos + 1, leaf->keyArray + leaf->numKeys, leaf->keyArray + pos);
+				std::copy(leaf->ridArray + pos + 1, leaf->ridArray + leaf->numKeys, leaf->ridArray + pos);
+				leaf->numKeys--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool leafRemove(LeafNodeString* leaf, const std::string& key, const RecordId& rid)
+	{
+		for(int pos = leafLowerBound(leaf, key); pos < leaf->numKeys && keyAt(leaf, pos) == key; pos++){
+			if(leaf->slotArray[pos].rid == rid){
+				removeSlot(leaf, pos);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// -----------------------------------------------------------------------------
+	// mergeIntoLeaf
+	// Merge the sorted entries [begin, end) into the leaf in one rewrite, each
+	// after the entries of an equal key. Only a first part is merged if they do
+	// not all fit.
+	// @return: the number of entries merged
+	// -----------------------------------------------------------------------------
+	template <class T>
+	static size_t mergeIntoLeaf(LeafNode<T>* leaf, const std::vector<RIDKeyPair<T> >& entries, size_t begin, size_t end)
+	{
+		size_t count = std::min(end - begin, (size_t) (leafArraySize<T>() - leaf->numKeys));
+
+		//From the right end, so every entry of the leaf moves once
+		int i = leaf->numKeys - 1;
+		int out = leaf->numKeys + count - 1;
+		for(size_t j = begin + count; j > begin; out--){
+			if(i >= 0 && entries[j - 1].key < leaf->keyArray[i]){
+				leaf->keyArray[out] = leaf->keyArray[i];
+				leaf->ridArray[out] = leaf->ridArray[i];
+				i--;
+			}
+			else{
+				leaf->keyArray[out] = entries[j - 1].key;
+				leaf->ridArray[out] = entries[j - 1].rid;
+				j--;
+			}
+		}
+		leaf->numKeys += count;
+		return count;
+	}
+
+	static size_t mergeIntoLeaf(LeafNodeString* leaf, const std::vector<RIDKeyPair<std::string> >& entries, size_t begin, size_t end)
+	{
+		std::vector<RIDKeyPair<std::string> > current, merged;
+		decodeNode(leaf, current);
+		auto keyLess = [](const RIDKeyPair<std::string>& a, const RIDKeyPair<std::string>& b) { return a.key < b.key; };
+
+		//The most entries that fit, halving the count until they do
+		size_t count = end - begin;
+		while(count > 0){
+			merged.clear();
+			std::merge(current.begin(), current.end(), entries.begin() + begin, entries.begin() + begin + count, std::back_inserter(merged), keyLess);
+			if(encodedSize<LeafNodeString>(merged, 0, merged.size()) <= (int) Page::SIZE)
+				break;
+			count /= 2;
+		}
+		if(count > 0)
+			encodeNode(leaf, merged, 0, merged.size());
+		return count;
+	}
+
+	// -----------------------------------------------------------------------------
+	// removeSeparator
+	// Remove key i and the child right of it from a non-leaf
+	// -----------------------------------------------------------------------------
+	template <class T>
+	static void removeSeparator(NonLeafNode<T>* node, int i)
+	{
+		std::copy(node->keyArray + i + 1, node->keyArray + node->numKeys, node->keyArray + i);
+		std::copy(node->pageNoArray + i + 2, node->pageNoArray + node->numKeys + 1, node->pageNoArray + i + 1);
+		node->numKeys--;
+		indexSeparators(node);
+	}
+
+	static inline void removeSeparator(NonLeafNodeString* node, int i)
+	{
+		removeSlot(node, i);
+	}
+
+	// -----------------------------------------------------------------------------
+	// mergeLeaves, mergeNonLeaves
+	// Append the entries of right to left, for non-leaves with the separator of
+	// the two in between
+	// @return: false if they do not fit one node, nothing was changed then
+	// -----------------------------------------------------------------------------
+	template <class T>
+	static bool mergeLeaves(LeafNode<T>* left, LeafNode<T>* right)
+	{
+		if(left->numKeys + right->numKeys > leafArraySize<T>())
+			return false;
+		std::copy(right->keyArray, right->keyArray + right->numKeys, left->keyArray + left->numKeys);
+		std::copy(right->ridArray, right->ridArray + right->numKeys, left->ridArray + left->numKeys);
+		left->numKeys += right->numKeys;
+		left->highKey = right->highKey;
+		return true;
+	}
+
+	static bool mergeLeaves(LeafNodeString* left, LeafNodeString* right)
+	{
+		std::vector<RIDKeyPair<std::string> > entries, rightEntries;
+		decodeNode(left, entries);
+		decodeNode(right, rightEntries);
+		entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+		if(encodedSize<LeafNodeString>(entries, 0, entries.size()) > (int) Page::SIZE)
+			return false;
+		encodeNode(left, entries, 0, entries.size());
+		return true;
+	}
+
+	template <class T>
+	static bool mergeNonLeaves(NonLeafNode<T>* left, const T& separator, NonLeafNode<T>* right)
+	{
+		int numKeys = left->numKeys;
+		if(numKeys + 1 + right->numKeys > nonLeafArraySize<T>())
+			return false;
+		left->keyArray[numKeys] = separator;
+		std::copy(right->keyArray, right->keyArray + right->numKeys, left->keyArray + numKeys + 1);
+		std::copy(right->pageNoArray, right->pageNoArray + right->numKeys + 1, left->pageNoArray + numKeys + 1);
+		left->numKeys = numKeys + 1 + right->numKeys;
+		left->rightSibPageNo = right->rightSibPageNo;
+		left->highKey = right->highKey;
+		indexSeparators(left);
+		return true;
+	}
+
+	static bool mergeNonLeaves(NonLeafNodeString* left, const std::string& separator, NonLeafNodeString* right)
+	{
+		std::vector<PageKeyPair<std::string> > entries, rightEntries;
+		decodeNode(left, entries);
+		decodeNode(right, rightEntries);
+		PageKeyPair<std::string> middle;
+		middle.set(right->firstPageNo, separator);
+		entries.push_back(middle);
+		entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+		if(encodedSize<NonLeafNodeString>(entries, 0, entries.size()) > (int) Page::SIZE)
+			return false;
+		encodeNode(left, entries, 0, entries.size());
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// redistributeLeaves, redistributeNonLeaves
+	// Even out the entries of two siblings and set their separator in the parent
+	// @param sepIdx: index of the separator of left and right in parent
+	// @return: false if the parent does not fit a page with the new separator
+	//	    (STRING keys only), nothing was changed then
+	// -----------------------------------------------------------------------------
+	template <class T>
+	static bool redistributeLeaves(LeafNode<T>* left, LeafNode<T>* right, NonLeafNode<T>* parent, int sepIdx)
+	{
+		int total = left->numKeys + right->numKeys;
+		int keep = total / 2;
+		if(left->numKeys > keep){
+			//The last entries of left move to the front of right
+			int move = left->numKeys - keep;
+			std::copy_backward(right->keyArray, right->keyArray + right->numKeys, right->keyArray + right->numKeys + move);
+			std::copy_backward(right->ridArray, right->ridArray + right->numKeys, right->ridArray + right->numKeys + move);
+			std::copy(left->keyArray + keep, left->keyArray + left->numKeys, right->keyArray);
+			std::copy(left->ridArray + keep, left->ridArray + left->numKeys, right->ridArray);
+		}
+		else{
+			//The first entries of right move to the end of left
+			int move = keep - left->numKeys;
+			std::copy(right->keyArray, right->keyArray + move, left->keyArray + left->numKeys);
+			std::copy(right->ridArray, right->ridArray + move, left->ridArray + left->numKeys);
+			std::copy(right->keyArray + move, right->keyArray + right->numKeys, right->keyArray);
+			std::copy(right->ridArray + move, right->ridArray + right->numKeys, right->ridArray);
+		}
+		left->numKeys = keep;
+		right->numKeys = total - keep;
+		parent->keyArray[sepIdx] = right->keyArray[0];
+		left->highKey = right->keyArray[0];
+		indexSeparators(parent);
+		return true;
+	}
+
+	static bool redistributeLeaves(LeafNodeString* left, LeafNodeString* right, NonLeafNodeString* parent, int sepIdx)
+	{
+		std::vector<RIDKeyPair<std::string> > entries, rightEntries;
+		decodeNode(left, entries);
+		decodeNode(right, rightEntries);
+		entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+		int total = entries.size();
+		int keep = fitSplitPoint<LeafNodeString>(entries, total / 2, 0);
+		if(!replaceKey(parent, sepIdx, shortestSeparator(entries[keep - 1].key, entries[keep].key)))
+			return false;
+		encodeNode(left, entries, 0, keep);
+		encodeNode(right, entries, keep, total);
+		return true;
+	}
+
+	template <class T>
+	static bool redistributeNonLeaves(NonLeafNode<T>* left, NonLeafNode<T>* right, NonLeafNode<T>* parent, int sepIdx)
+	{
+		//All keys with the separator between them, and all children, in order
+		std::vector<T> keys(left->keyArray, left->keyArray + left->numKeys);
+		keys.push_back(parent->keyArray[sepIdx]);
+		keys.insert(keys.end(), right->keyArray, right->keyArray + right->numKeys);
+		std::vector<PageId> children(left->pageNoArray, left->pageNoArray + left->numKeys + 1);
+		children.insert(children.end(), right->pageNoArray, right->pageNoArray + right->numKeys + 1);
+
+		//Keys [0, keep) stay, key keep goes up, the rest move right
+		int total = keys.size();
+		int keep = total / 2;
+		std::copy(keys.begin(), keys.begin() + keep, left->keyArray);
+		std::copy(children.begin(), children.begin() + keep + 1, left->pageNoArray);
+		left->numKeys = keep;
+		parent->keyArray[sepIdx] = keys[keep];
+		left->highKey = keys[keep];
+		std::copy(keys.begin() + keep + 1, keys.end(), right->keyArray);
+		std::copy(children.begin() + keep + 1, children.end(), right->pageNoArray);
+		right->numKeys = total - keep - 1;
+		indexSeparators(left);
+		indexSeparators(right);
+		indexSeparators(parent);
+		return true;
+	}
+
+	static bool redistributeNonLeaves(NonLeafNodeString* left, NonLeafNodeString* right, NonLeafNodeString* parent, int sepIdx)
+	{
+		std::vector<PageKeyPair<std::string> > entries, rightEntries;
+		decodeNode(left, entries);
+		decodeNode(right, rightEntries);
+		PageKeyPair<std::string> middle;
+		middle.set(right->firstPageNo, keyAt(parent, sepIdx));
+		entries.push_back(middle);
+		entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+		int total = entries.size();
+		int keep = fitSplitPoint<NonLeafNodeString>(entries, total / 2, 1);
+		if(!replaceKey(parent, sepIdx, entries[keep].key))
+			return false;
+		encodeNode(left, entries, 0, keep);
+		right->firstPageNo = entries[keep].pageNo;
+		encodeNode(right, entries, keep + 1, total);
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// Posting list helpers
+	// A RecordId is compared and delta-encoded as page_number << 16 | slot_number,
+	// the order RIDKeyPair gives the duplicates of a key
+	// -----------------------------------------------------------------------------
+	static const int POSTINGLEAFSPACE = Page::SIZE - offsetof(PostingLeafNode, slotArray);
+
+	static inline unsigned long long ridValue(const RecordId& rid)
+	{
+		return ((unsigned long long) rid.page_number << 16) | rid.slot_number;
+	}
+
+	static inline RecordId valueRid(unsigned long long value)
+	{
+		RecordId rid;
+		rid.page_number = value >> 16;
+		rid.slot_number = value & 0xffff;
+		return rid;
+	}
+
+	static inline bool ridLess(const RecordId& a, const RecordId& b) { return ridValue(a) < ridValue(b); }
+
+	// appendRids: append the varints of the distance of each RecordId from the
+	// one before it, the first one from previous. Returns the last RecordId.
+	static inline unsigned long long appendRids(std::string& bytes, const RecordId* rids, size_t count, unsigned long long previous)
+	{
+		for(size_t i = 0; i < count; i++){
+			unsigned long long value = ridValue(rids[i]);
+			unsigned long long delta = value - previous;
+			previous = value;
+			while(delta >= 0x80){
+				bytes += (char) (delta | 0x80);
+				delta >>= 7;
+			}
+			bytes += (char) delta;
+		}
+		return previous;
+	}
+
+	// decodeRids: append numRids RecordIds encoded by appendRids() from 0
+	static inline void decodeRids(const char* bytes, int numRids, std::vector<RecordId>& rids)
+	{
+		const unsigned char *p = (const unsigned char *) bytes;
+		unsigned long long value = 0;
+		for(int i = 0; i < numRids; i++){
+			unsigned long long delta = 0;
+			int shift = 0;
+			while(*p & 0x80){
+				delta |= (unsigned long long) (*p++ & 0x7f) << shift;
+				shift += 7;
+			}
+			delta |= (unsigned long long) *p++ << shift;
+			value += delta;
+			rids.push_back(valueRid(value));
+		}
+	}
+
+	static inline int postingLowerBound(const PostingLeafNode* leaf, int key)
+	{
+		int low = 0, high = leaf->numKeys;
+		while(low < high){
+			int mid = (low + high) / 2;
+			if(leaf->slotArray[mid].key < key)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		return low;
+	}
+
+	static inline int postingUpperBound(const PostingLeafNode* leaf, int key)
+	{
+		int low = 0, high = leaf->numKeys;
+		while(low < high){
+			int mid = (low + high) / 2;
+			if(leaf->slotArray[mid].key <= key)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		return low;
+	}
+
+	static inline int postingSize(const PostingList& list) { return sizeof(PostingSlot) + list.bytes.size(); }
+
+	static inline int postingFreeSpace(const PostingLeafNode* leaf)
+	{
+		return leaf->heapBegin - (int) (offsetof(PostingLeafNode, slotArray) + leaf->numKeys * sizeof(PostingSlot));
+	}
+
+	static inline void readPostingSlot(const PostingLeafNode* leaf, int i, PostingList& list)
+	{
+		const PostingSlot& slot = leaf->slotArray[i];
+		list.key = slot.key;
+		list.numRids = slot.numRids;
+		list.overflowPageNo = slot.overflowPageNo;
+		list.bytes.assign((const char *) leaf + slot.offset, slot.length);
+	}
+
+	// writePostingSlot: set slot i to list, taking the bytes of the list from the free space
+	static inline void writePostingSlot(PostingLeafNode* leaf, int i, const PostingList& list)
+	{
+		PostingSlot& slot = leaf->slotArray[i];
+		slot.key = list.key;
+		slot.numRids = list.numRids;
+		slot.overflowPageNo = list.overflowPageNo;
+		leaf->heapBegin -= list.bytes.size();
+		memcpy((char *) leaf + leaf->heapBegin, list.bytes.data(), list.bytes.size());
+		slot.offset = leaf->heapBegin;
+		slot.length = list.bytes.size();
+	}
+
+	// encodePostingLeaf: write lists [begin, end) into an empty heap, the sibling links stay
+	static void encodePostingLeaf(PostingLeafNode* leaf, const std::vector<PostingList>& lists, size_t begin, size_t end)
+	{
+		leaf->numKeys = 0;
+		leaf->heapBegin = Page::SIZE;
+		for(size_t i = begin; i < end; i++)
+			writePostingSlot(leaf, leaf->numKeys++, lists[i]);
+	}
+
+	// storePostingList: put a list at slot pos of a leaf, replacing the list there
+	// or inserting a new one. A list that does not grow is overwritten in place,
+	// one that fits the free space goes there, otherwise the leaf is rewritten
+	// without the bytes of replaced lists if that makes room. Returns false if
+	// the leaf must split, lists then holds all its lists with the new one, and
+	// the leaf is unchanged.
+	static bool storePostingList(PostingLeafNode* leaf, int pos, bool replace, const PostingList& list, std::vector<PostingList>& lists)
+	{
+		int length = list.bytes.size();
+		if(replace && length <= leaf->slotArray[pos].length){
+			PostingSlot& slot = leaf->slotArray[pos];
+			memcpy((char *) leaf + slot.offset, list.bytes.data(), length);
+			slot.length = length;
+			slot.numRids = list.numRids;
+			slot.overflowPageNo = list.overflowPageNo;
+			return true;
+		}
+		if(postingFreeSpace(leaf) >= length + (replace ? 0 : (int) sizeof(PostingSlot))){
+			if(!replace){
+				memmove(leaf->slotArray + pos + 1, leaf->slotArray + pos, (leaf->numKeys - pos) * sizeof(PostingSlot));
+				leaf->numKeys++;
+			}
+			writePostingSlot(leaf, pos, list);
+			return true;
+		}
+
+		lists.resize(leaf->numKeys);
+		for(int i = 0; i < leaf->numKeys; i++)
+			readPostingSlot(leaf, i, lists[i]);
+		if(replace)
+			lists[pos] = list;
+		else
+			lists.insert(lists.begin() + pos, list);
+		int size = 0;
+		for(size_t i = 0; i < lists.size(); i++)
+			size += postingSize(lists[i]);
+		if(size > POSTINGLEAFSPACE)
+			return false;
+		encodePostingLeaf(leaf, lists, 0, lists.size());
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// Buffered node helpers
+	// A buffered insert belongs to the child the descent for its key takes
+	// -----------------------------------------------------------------------------
+	static inline bool messageLess(const BufferedMessage& a, const BufferedMessage& b) { return a.key < b.key; }
+
+	static inline int messageChild(const std::vector<int>& keys, const BufferedMessage& message)
+	{
+		return std::upper_bound(keys.begin(), keys.end(), message.key) - keys.begin();
+	}
+
+	// takeMessages: move the messages bound for children [first, last] from
+	// messages to batch, keeping the order of both
+	static void takeMessages(const std::vector<int>& keys, int first, int last,
+			std::vector<BufferedMessage>& messages, std::vector<BufferedMessage>& batch)
+	{
+		std::vector<BufferedMessage> rest;
+		for(size_t i = 0; i < messages.size(); i++){
+			int c = messageChild(keys, messages[i]);
+			(c >= first && c <= last ? batch : rest).push_back(messages[i]);
+		}
+		messages.swap(rest);
+	}
+
+	// -----------------------------------------------------------------------------
+	// deltaEntrySize
+	// Bytes of memory an entry of the delta takes: the key, the RecordId and the
+	// tree node around them, and the characters of a STRING key
+	// -----------------------------------------------------------------------------
+	static const size_t DELTANODEBYTES = 4 * sizeof(void *);
+
+	template <class T>
+	static inline size_t deltaEntrySize(const T& key) { return DELTANODEBYTES + sizeof(std::pair<const T, RecordId>); }
+	static inline size_t deltaEntrySize(const std::string& key) { return DELTANODEBYTES + sizeof(std::pair<const std::string, RecordId>) + key.size(); }
+
+	// -----------------------------------------------------------------------------
+	// CompositeKey::CompositeKey -- Constructor
+	// -----------------------------------------------------------------------------
+
+	CompositeKey::CompositeKey(const std::vector<KeyAttribute>& attributes, const char* record)
+	{
+		for(size_t i = 0; i < attributes.size(); i++){
+			const char *value = record + attributes[i].byteOffset;
+			switch(attributes[i].type){
+				case INTEGER:
+					add(*((const int *) value));
+					break;
+				case DOUBLE:
+					add(*((const double *) value));
+					break;
+				default:
+					addString(value, strnlen(value, STRINGSIZE));
+					break;
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// CompositeKey::add
+	// -----------------------------------------------------------------------------
+
+	CompositeKey& CompositeKey::add(int value)
+	{
+		//Flipping the sign bit orders negative values before positive ones
+		size_t oldLength = bytes.size();
+		unsigned int bits = (unsigned int) value ^ 0x80000000u;
+		for(int shift = 24; shift >= 0; shift -= 8)
+			appendByte(bits >> shift);
+		checkLength(oldLength);
+		return *this;
+	}
+
+	CompositeKey& CompositeKey::add(double value)
+	{
+		//0.0 and -0.0 are the same key
+		if(value == 0)
+			value = 0;
+		unsigned long long bits;
+		memcpy(&bits, &value, sizeof(bits));
+		//Negative values order the other way round, so all their bits flip
+		size_t oldLength = bytes.size();
+		bits = (bits >> 63) ? ~bits : bits ^ (1ULL << 63);
+		for(int shift = 56; shift >= 0; shift -= 8)
+			appendByte(bits >> shift);
+		checkLength(oldLength);
+		return *this;
+	}
+
+	CompositeKey& CompositeKey::add(const char* value)
+	{
+		//A longer value would only differ from others past what the key keeps
+		size_t length = strnlen(value, STRINGSIZE + 1);
+		if(length > (size_t) STRINGSIZE)
+			throw KeyTooLongException(length, STRINGSIZE);
+		return addString(value, length);
+	}
+
+	// -----------------------------------------------------------------------------
+	// CompositeKey::addString
+	// -----------------------------------------------------------------------------
+
+	CompositeKey& CompositeKey::addString(const char* value, size_t length)
+	{
+		size_t oldLength = bytes.size();
+		for(size_t i = 0; i < length; i++)
+			appendByte(value[i]);
+		//The terminator sorts before every byte, so a value sorts before its extensions
+		bytes += '\1';
+		bytes += '\1';
+		checkLength(oldLength);
+		return *this;
+	}
+
+	// -----------------------------------------------------------------------------
+	// CompositeKey::prefixEnd
+	// -----------------------------------------------------------------------------
+
+	CompositeKey CompositeKey::prefixEnd() const
+	{
+		//Keys are at most COMPOSITEKEYSIZE bytes, and only those of escaped bytes are that long,
+		//so no key starting with this one is greater
+		CompositeKey end(*this);
+		if(end.bytes.size() < (size_t) COMPOSITEKEYSIZE)
+			end.bytes.append(COMPOSITEKEYSIZE - end.bytes.size(), '\xff');
+		return end;
+	}
+
+	// -----------------------------------------------------------------------------
+	// CompositeKey::appendByte
+	// 0 and 1 become 1 2 and 1 3, leaving 1 1 for the terminator of STRING values
+	// and no zero byte that would end the key early
+	// -----------------------------------------------------------------------------
+
+	void CompositeKey::appendByte(unsigned char b)
+	{
+		if(b <= 1){
+			bytes += '\1';
+			b += 2;
+		}
+		bytes += (char) b;
+	}
+
+	// -----------------------------------------------------------------------------
+	// CompositeKey::checkLength
+	// The index keeps COMPOSITEKEYSIZE bytes of a key, a longer one is taken back
+	// to oldLength and refused instead of cut
+	// -----------------------------------------------------------------------------
+
+	void CompositeKey::checkLength(size_t oldLength)
+	{
+		if(bytes.size() > (size_t) COMPOSITEKEYSIZE){
+			size_t length = bytes.size();
+			bytes.resize(oldLength);
+			throw KeyTooLongException(length, COMPOSITEKEYSIZE);
+		}
+	}
+
 	// -----------------------------------------------------------------------------
 	// BTreeIndex::BTreeIndex -- Constructor
 	// -----------------------------------------------------------------------------
 
-	BTreeIndex::BTreeIndex(const std::string & relationName,
-			std::string & outIndexName,
-			BufMgr *bufMgrIn,
-			const int attrByteOffset,
-			const Datatype attrType)
+	BTreeIndex::BTreeIndex(const std::string & relationName,
+			std::string & outIndexName,
+			BufMgr *bufMgrIn,
+			const int attrByteOffset,
+			const Datatype attrType,
+			const IndexOptions& options)
+		: BTreeIndex(relationName, outIndexName, bufMgrIn, std::vector<KeyAttribute>(1, KeyAttribute{attrByteOffset, attrType}), options)
+	{
+	}
+
+	BTreeIndex::BTreeIndex(const std::string & relationName,
+			std::string & outIndexName,
+			BufMgr *bufMgrIn,
+			const std::vector<KeyAttribute>& attributes,
+			const IndexOptions& options)
+		: keySize(attributes.size() > 1 ? COMPOSITEKEYSIZE : STRINGSIZE), deltaMemory(options.deltaMemory), deltaBytes(0), scanCursor(this), bloomPageNum(0), bloomNumHashes(0), bloomFilterSkips(0),
+		hotNodesFull(false), hotNodeHits(0), hotNodeMisses(0), hotNodeCapMisses(0)
+	{
+		if(attributes.empty() || attributes.size() > (size_t) MAXKEYATTRIBUTES)
+			throw BadIndexInfoException("ERROR: An index needs 1 to MAXKEYATTRIBUTES attributes");
+		for(size_t i = 0; i < attributes.size(); i++){
+			if(attributes[i].type == COMPOSITE)
+				throw BadIndexInfoException("ERROR: An attribute of an index cannot be COMPOSITE");
+		}
+
+		std::ostringstream idxStr;
+		idxStr << relationName;
+		for(size_t i = 0; i < attributes.size(); i++)
+			idxStr << '.' << attributes[i].byteOffset;
+		outIndexName = idxStr.str();// name of the index file
+		this->bufMgr = bufMgrIn;
+		//A composite index reads its keys from the whole record
+		if(attributes.size() == 1){
+			this->attrByteOffset = attributes[0].byteOffset;
+			this->attributeType = attributes[0].type;
+		}else{
+			this->attrByteOffset = 0;
+			this->attributeType = COMPOSITE;
+			this->keyAttributes = attributes;
+		}
+		const int attrByteOffset = this->attrByteOffset;
+		const Datatype attrType = this->attributeType;
+		this->concurrent = options.concurrent;
+		this->postingLists = options.postingLists;
+		if(postingLists && (attrType != INTEGER || concurrent))
+			throw BadIndexInfoException("ERROR: Posting lists need INTEGER keys and an index that is not concurrent");
+		this->buffered = options.buffered;
+		if(buffered && (attrType != INTEGER || concurrent || postingLists))
+			throw BadIndexInfoException("ERROR: A buffered index needs INTEGER keys, no posting lists and an index that is not concurrent");
+		if(deltaMemory > 0 && (concurrent || postingLists || buffered))
+			throw BadIndexInfoException("ERROR: A delta needs an index that is not concurrent, without posting lists or buffers");
+
+		//The only place that looks at the attribute type
+		switch(attrType){
+			case INTEGER:
+				keyOps = postingLists ? postingKeyTypeOps() : buffered ? bufferedKeyTypeOps() : deltaMemory > 0 ? deltaKeyTypeOps<int>()
+					: concurrent ? concurrentKeyTypeOps<int>() : keyTypeOps<int>();
+				leafOccupancy = postingLists ? POSTINGLEAFSLOTS : INTARRAYLEAFSIZE;
+				nodeOccupancy = buffered ? BUFFEREDNONLEAFSIZE : INTARRAYNONLEAFSIZE;
+				break;
+			case DOUBLE:
+				keyOps = deltaMemory > 0 ? deltaKeyTypeOps<double>() : concurrent ? concurrentKeyTypeOps<double>() : keyTypeOps<double>();
+				leafOccupancy = DOUBLEARRAYLEAFSIZE;
+				nodeOccupancy = DOUBLEARRAYNONLEAFSIZE;
+				break;
+			default:
+				//STRING and COMPOSITE keys are char strings.
+				//STRING nodes have no high keys to move right by
+				if(concurrent)
+					throw BadIndexInfoException("ERROR: A concurrent index needs INTEGER or DOUBLE keys");
+				keyOps = deltaMemory > 0 ? deltaKeyTypeOps<std::string>() : keyTypeOps<std::string>();
+				leafOccupancy = STRINGLEAFSLOTS;
+				nodeOccupancy = STRINGNONLEAFSLOTS;
+				break;
+		}
+
+		headerPageNum = 1;
+		rightmostLeafPageNum = 0;
+		this->appendSplitRatio = std::min(std::max(options.appendSplitRatio, 0.5), 0.99);
+
+
+		// try create a file and check if it exists
+		try {
+			IndexMetaInfo* metadata;
+			//Page* page;
+			Page* metapage;
+			Page* rootpage;
+
+			//metapage
+			file = new BlobFile(outIndexName, true);
+			bufMgrIn->allocPage(file, headerPageNum, metapage);
+			metadata = (IndexMetaInfo*) metapage;
+			metadata->attrByteOffset = attrByteOffset;
+			metadata->attrType = attrType;
+			strcpy(metadata->relationName, relationName.c_str());
+			metadata->postingLists = postingLists;
+			metadata->buffered = buffered;
+			metadata->deltaPageNo = 0;
+			metadata->numAttributes = keyAttributes.size();
+			std::copy(keyAttributes.begin(), keyAttributes.end(), metadata->attributes);
+
+			//root page
+			PageId rootPageId;
+			bufMgrIn->allocPage(file, rootPageId, rootpage);
+			rootPageNum = rootPageId;
+			metadata->rootPageNo = rootPageNum;
+			std::cout<<"RootPageNo = "<<rootPageNum<<"  headerPageNum = "<<headerPageNum<<std::endl;
+
+			//the filter itself stays in memory until the destructor writes it back
+			if(options.useBloomFilter)
+				createBloomFilter(relationName);
+			metadata->bloomNumHashes = bloomNumHashes;
+			metadata->bloomPageNo = bloomPageNum;
+			metadata->bloomNumPages = bloomFilter.size() / BLOOMPAGEBYTES;
+			try{
+				bufMgrIn->unPinPage(file, headerPageNum, true);
+			} catch (PageNotPinnedException e) {
+			}
+
+			//initialize root
+			(this->*keyOps->initRoot)(rootpage);
+			std::cout<<"leafOccupancy:"<<leafOccupancy<<std::endl;
+			std::cout<<"nodeOccupancy:"<<nodeOccupancy<<std::endl;
+
+			try{
+				bufMgrIn->unPinPage(file, rootPageNum, true);
+			}catch (PageNotPinnedException e) {}
+			//build bottom-up from the sorted relation
+			if(options.bulkLoad){
+				(this->*keyOps->bulkLoad)(relationName, options.fillFactor);
+				return;
+			}
+			//insert the records one by one, in key order
+			(this->*keyOps->insertRelation)(relationName);
+		}
+		// file exists, just open it
+		catch (FileExistsException e){
+			this->file = new BlobFile(outIndexName, false);
+			Page* metapage;
+			//headerPageNum = 1;
+			bufMgrIn->readPage(file, headerPageNum, metapage);
+			IndexMetaInfo* metadata = (IndexMetaInfo*) metapage;
+			bool attributesMatch = metadata->numAttributes == (int) keyAttributes.size();
+			for(int i = 0; attributesMatch && i < metadata->numAttributes; i++){
+				attributesMatch = metadata->attributes[i].byteOffset == keyAttributes[i].byteOffset
+					&& metadata->attributes[i].type == keyAttributes[i].type;
+			}
+			if(metadata->attrType != attrType ||strcmp(metadata->relationName, relationName.c_str()) != 0
+					|| metadata->attrByteOffset != attrByteOffset || !attributesMatch || metadata->postingLists != postingLists || metadata->buffered != buffered ){
+				try {
+					bufMgrIn->unPinPage(file, headerPageNum, false);
+				} catch (PageNotPinnedException e ){}
+				//No destructor runs, so the file is closed here
+				bufMgrIn->flushFile(file);
+				delete file;
+				throw BadIndexInfoException("ERROR: MetaData does not match");
+			}
+			//Metadata matches
+			this->rootPageNum = metadata->rootPageNo;
+			this->bloomNumHashes = metadata->bloomNumHashes;
+			this->bloomPageNum = metadata->bloomPageNo;
+			int bloomNumPages = metadata->bloomNumPages;
+			PageId deltaPageNo = metadata->deltaPageNo;
+
+			try {
+				bufMgrIn->unPinPage(file, headerPageNum, false);
+			} catch (PageNotPinnedException e ){}
+			if(bloomNumHashes > 0)
+				readBloomFilter(bloomNumPages);
+			if(deltaPageNo != 0)
+				readDelta(deltaPageNo);
+		}
+		catch (EndOfFileException e){}
+
+
+	}
+
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::recordKey
+	// -----------------------------------------------------------------------------
+
+	const void* BTreeIndex::recordKey(const std::string& record, CompositeKey& composite) const
+	{
+		if(keyAttributes.empty())
+			return record.c_str() + attrByteOffset;
+		composite = CompositeKey(keyAttributes, record.c_str());
+		return composite.data();
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::initRootOfType
+	// -----------------------------------------------------------------------------
+
+	template <class T, class NonLeaf>
+	void BTreeIndex::initRootOfType(Page* rootPage)
+	{
+		NonLeaf *root = (NonLeaf *) rootPage;
+		root->pageNoArray[0] = 0;
+		root->numKeys = 0;
+		root->level = 1;
+		root->rightSibPageNo = 0;
+		clearBuffer(root);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bulkLoadOfType
+	// Build the tree bottom-up: extract all <key, rid> pairs of the relation, sort
+	// them and write leaves, then each non-leaf level, from left to right.
+	// No node is ever split. The top level is written into the root page.
+	// @param relationName: the base relation to be indexed
+	// @param fillFactor:   fraction of the key slots used in every written node
+	// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf>
+	void BTreeIndex::bulkLoadOfType(const std::string & relationName, double fillFactor)
+	{
+		std::vector<RIDKeyPair<T> > pairs;
+		extractPairs(relationName, pairs);
+		loadSortedPairs<T, NonLeaf>(pairs, fillFactor);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::loadSortedPairs
+	// -----------------------------------------------------------------------------
+
+	template <class T, class NonLeaf>
+	void BTreeIndex::loadSortedPairs(const std::vector<RIDKeyPair<T> >& pairs, double fillFactor)
+	{
+		if(fillFactor <= 0 || fillFactor > 1) fillFactor = 1.0;
+
+		//No entries, the empty root stays as it is
+		if(pairs.empty())
+			return;
+
+		//Entries per leaf at the requested fill factor
+		int leafFill = std::max(1, (int) (leafArraySize<T>() * fillFactor));
+
+		//Write the leaves left to right, remembering <first key, pageNo> of each
+		std::vector<PageKeyPair<T> > level;
+		int numLeaves = (pairs.size() + leafFill - 1) / leafFill;
+		int pos = 0;
+		PageId prevPageId = 0;
+		LeafNode<T> *prevLeaf = NULL;
+		for(int n = 0; n < numLeaves; n++){
+			//Spread the entries evenly so that the last leaf is not left nearly empty
+			int count = (pairs.size() - pos + (numLeaves - n) - 1) / (numLeaves - n);
+
+			PageId pageId;
+			Page *page;
+			bufMgr->allocPage(file, pageId, page);
+			LeafNode<T> *leaf = (LeafNode<T> *) page;
+			for(int i = 0; i < count; i++){
+				leaf->keyArray[i] = pairs[pos + i].key;
+				leaf->ridArray[i] = pairs[pos + i].rid;
+			}
+			leaf->numKeys = count;
+			leaf->rightSibPageNo = 0;
+			leaf->leftSibPageNo = prevPageId;
+
+			PageKeyPair<T> entry;
+			entry.set(pageId, pairs[pos].key);
+			level.push_back(entry);
+			pos += count;
+
+			//Link the previous leaf to this one, then release it
+			if(prevLeaf != NULL){
+				prevLeaf->rightSibPageNo = pageId;
+				prevLeaf->highKey = entry.key;
+				try{
+					bufMgr->unPinPage(file, prevPageId, true);
+				}catch (PageNotPinnedException e) {}
+			}
+			prevLeaf = leaf;
+			prevPageId = pageId;
+		}
+		try{
+			bufMgr->unPinPage(file, prevPageId, true);
+		}catch (PageNotPinnedException e) {}
+		rightmostLeafPageNum = prevPageId;
+
+		buildNonLeafLevels<T, NonLeaf>(level, fillFactor);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::buildNonLeafLevels
+	// -----------------------------------------------------------------------------
+
+	template <class T, class NonLeaf>
+	void BTreeIndex::buildNonLeafLevels(std::vector<PageKeyPair<T> >& level, double fillFactor)
+	{
+		int childFill = std::max(1, (int) (nonLeafCapacity((NonLeaf *) NULL) * fillFactor)) + 1;
+
+		//Write the non-leaf levels until a single node, the root, is left
+		int nodeLevel = 1;
+		while(1){
+			bool isRoot = (int) level.size() <= childFill;
+			int numNodes = isRoot ? 1 : (level.size() + childFill - 1) / childFill;
+			std::vector<PageKeyPair<T> > upper;
+			int pos = 0;
+			PageId prevPageId = 0;
+			NonLeaf *prevNode = NULL;
+			for(int n = 0; n < numNodes; n++){
+				int count = (level.size() - pos + (numNodes - n) - 1) / (numNodes - n);
+
+				//The top level reuses the root page allocated by the constructor
+				PageId pageId;
+				Page *page;
+				if(isRoot){
+					pageId = rootPageNum;
+					bufMgr->readPage(file, pageId, page);
+				}
+				else
+					bufMgr->allocPage(file, pageId, page);
+				NonLeaf *node = (NonLeaf *) page;
+
+				node->level = nodeLevel;
+				node->numKeys = count - 1;
+				node->rightSibPageNo = 0;
+				clearBuffer(node);
+				for(int i = 0; i < count; i++){
+					node->pageNoArray[i] = level[pos + i].pageNo;
+					if(i > 0)
+						node->keyArray[i - 1] = level[pos + i].key;
+				}
+				indexSeparators(node);
+
+				PageKeyPair<T> entry;
+				entry.set(pageId, level[pos].key);
+				upper.push_back(entry);
+				pos += count;
+
+				//Link the previous node of the level to this one, then release it
+				if(prevNode != NULL){
+					prevNode->rightSibPageNo = pageId;
+					prevNode->highKey = entry.key;
+					try{
+						bufMgr->unPinPage(file, prevPageId, true);
+					}catch (PageNotPinnedException e) {}
+				}
+				prevNode = node;
+				prevPageId = pageId;
+			}
+			try{
+				bufMgr->unPinPage(file, prevPageId, true);
+			}catch (PageNotPinnedException e) {}
+			if(isRoot)
+				break;
+			level.swap(upper);
+			nodeLevel++;
+		}
+	}
+
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::initRootOfType, BTreeIndex::loadSortedPairs for STRING keys
+	// The bulk load fills each node up to fillFactor of a page, in bytes
+	// -----------------------------------------------------------------------------
+
+	template <>
+	void BTreeIndex::initRootOfType<std::string>(Page* rootPage)
+	{
+		NonLeafNodeString *root = (NonLeafNodeString *) rootPage;
+		root->firstPageNo = 0;
+		root->numKeys = 0;
+		root->level = 1;
+		root->prefixLength = 0;
+		root->heapBegin = Page::SIZE;
+	}
+
+	template <>
+	void BTreeIndex::loadSortedPairs<std::string>(const std::vector<RIDKeyPair<std::string> >& pairs, double fillFactor)
+	{
+		if(fillFactor <= 0 || fillFactor > 1) fillFactor = 1.0;
+		int fillBytes = (int) (Page::SIZE * fillFactor);
+
+		//No entries, the empty root stays as it is
+		if(pairs.empty())
+			return;
+
+		//Write the leaves left to right, each taking entries while they fit in fillBytes.
+		//The separator in front of each leaf is cut against the last key of the one before.
+		std::vector<PageKeyPair<std::string> > level;
+		size_t pos = 0;
+		PageId prevPageId = 0;
+		LeafNodeString *prevLeaf = NULL;
+		while(pos < pairs.size()){
+			size_t end = pos + 1;
+			while(end < pairs.size() && encodedSize<LeafNodeString>(pairs, pos, end + 1) <= fillBytes)
+				end++;
+
+			PageId pageId;
+			Page *page;
+			bufMgr->allocPage(file, pageId, page);
+			LeafNodeString *leaf = (LeafNodeString *) page;
+			encodeNode(leaf, pairs, pos, end);
+			leaf->rightSibPageNo = 0;
+			leaf->leftSibPageNo = prevPageId;
+
+			PageKeyPair<std::string> entry;
+			entry.set(pageId, pos == 0 ? std::string() : shortestSeparator(pairs[pos - 1].key, pairs[pos].key));
+			level.push_back(entry);
+			pos = end;
+
+			//Link the previous leaf to this one, then release it
+			if(prevLeaf != NULL){
+				prevLeaf->rightSibPageNo = pageId;
+				try{
+					bufMgr->unPinPage(file, prevPageId, true);
+				}catch (PageNotPinnedException e) {}
+			}
+			prevLeaf = leaf;
+			prevPageId = pageId;
+		}
+		try{
+			bufMgr->unPinPage(file, prevPageId, true);
+		}catch (PageNotPinnedException e) {}
+
+		//Write the non-leaf levels until a single node, the root, is left. A node
+		//over level[pos, end) has level[pos] as first child and the keys of the rest.
+		int nodeLevel = 1;
+		while(1){
+			std::vector<PageKeyPair<std::string> > upper;
+			pos = 0;
+			while(pos < level.size()){
+				size_t end = std::min(pos + 2, level.size());
+				while(end < level.size() && encodedSize<NonLeafNodeString>(level, pos + 1, end + 1) <= fillBytes)
+					end++;
+
+				//The top level reuses the root page allocated by the constructor
+				bool isRoot = pos == 0 && end == level.size();
+				PageId pageId;
+				Page *page;
+				if(isRoot){
+					pageId = rootPageNum;
+					bufMgr->readPage(file, pageId, page);
+				}
+				else
+					bufMgr->allocPage(file, pageId, page);
+				NonLeafNodeString *node = (NonLeafNodeString *) page;
+				node->level = nodeLevel;
+				node->firstPageNo = level[pos].pageNo;
+				encodeNode(node, level, pos + 1, end);
+
+				PageKeyPair<std::string> entry;
+				entry.set(pageId, level[pos].key);
+				upper.push_back(entry);
+				pos = end;
+
+				try{
+					bufMgr->unPinPage(file, pageId, true);
+				}catch (PageNotPinnedException e) {}
+			}
+			if(upper.size() == 1)
+				break;
+			level.swap(upper);
+			nodeLevel++;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertRelationOfType
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::insertRelationOfType(const std::string & relationName)
+	{
+		//Sorted, the inserts take the append path and descend through the same nodes one after the other
+		std::vector<RIDKeyPair<T> > pairs;
+		extractPairs(relationName, pairs);
+		for(size_t i = 0; i < pairs.size(); i++)
+			insertEntry(keyPointer(pairs[i].key), pairs[i].rid);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::extractPairs
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::extractPairs(const std::string & relationName, std::vector<RIDKeyPair<T> >& pairs)
+	{
+		//The page numbers come from the page headers, the pages are read by the threads
+		PageFile relation(relationName, false);
+		std::vector<PageId> pageNos;
+		for(FileIterator it = relation.begin(); it != relation.end(); ++it)
+			pageNos.push_back(it.page_number());
+
+		//Each thread extracts and sorts the pairs of a contiguous part of the pages
+		size_t numRuns = std::min((size_t) std::max(std::thread::hardware_concurrency(), BUILDTHREADS), std::max(pageNos.size(), (size_t) 1));
+		std::vector<std::vector<RIDKeyPair<T> > > runs(numRuns);
+		std::vector<std::thread> workers;
+		for(size_t r = 0; r < numRuns; r++){
+			workers.push_back(std::thread([&, r]()
+			{
+				for(size_t i = r * pageNos.size() / numRuns; i < (r + 1) * pageNos.size() / numRuns; i++){
+					Page* page;
+					bufMgr->readPage(&relation, pageNos[i], page);
+					CompositeKey composite;
+					for(PageIterator rec = page->begin(); rec != page->end(); ++rec){
+						std::string record = *rec;
+						RIDKeyPair<T> pair;
+						T key;
+						readKey(recordKey(record, composite), key, keySize);
+						pair.set(rec.getCurrentRecord(), key);
+						runs[r].push_back(pair);
+						bloomFilterAdd(keyHash(pair.key));
+					}
+					try{
+						bufMgr->unPinPage(&relation, pageNos[i], false);
+					}catch (PageNotPinnedException e) {}
+				}
+				std::sort(runs[r].begin(), runs[r].end());
+			}));
+		}
+		size_t numPairs = 0;
+		for(size_t r = 0; r < numRuns; r++){
+			workers[r].join();
+			numPairs += runs[r].size();
+		}
+		//The frames of the relation must not outlive its File object
+		bufMgr->flushFile(&relation);
+
+		//k-way merge of the runs, the heap holds the next pair of each run
+		typedef std::pair<RIDKeyPair<T>, size_t> HeapEntry;
+		std::vector<HeapEntry> heap;
+		std::vector<size_t> next(numRuns, 0);
+		auto greater = [](const HeapEntry& a, const HeapEntry& b) { return b.first < a.first; };
+		for(size_t r = 0; r < numRuns; r++){
+			if(!runs[r].empty()){
+				heap.push_back(HeapEntry(runs[r][0], r));
+				next[r] = 1;
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), greater);
+		pairs.reserve(numPairs);
+		while(!heap.empty()){
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			size_t r = heap.back().second;
+			pairs.push_back(heap.back().first);
+			heap.pop_back();
+			if(next[r] < runs[r].size()){
+				heap.push_back(HeapEntry(runs[r][next[r]++], r));
+				std::push_heap(heap.begin(), heap.end(), greater);
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::~BTreeIndex -- destructor
+	// -----------------------------------------------------------------------------
+
+	BTreeIndex::~BTreeIndex()
+	{
+
+		try {
+			scanCursor.endScan();
+		} 
+		catch (ScanNotInitializedException e) {}
+		bool merged = true;
+		try {
+			mergeDelta();
+		}
+		catch (BadgerDbException e) {
+			merged = false;
+		}
+
+		//The hot nodes must be unpinned before the file is flushed
+		for(std::map<PageId, Page*>::iterator it = hotNodes.begin(); it != hotNodes.end(); ++it){
+			try {
+				bufMgr->unPinPage(file, it->first, dirtyHotNodes.count(it->first) > 0);
+			} catch (PageNotPinnedException e ){}
+		}
+		bufMgr->releaseFrames(hotNodes.size());
+		hotNodes.clear();
+		dirtyHotNodes.clear();
+
+		//Entries of the delta that could not be merged are written to pages, with the frames the hot nodes gave back,
+		//for the next open to insert
+		PageId deltaPageNo = 0;
+		if(!merged){
+			try {
+				deltaPageNo = writeDelta();
+			}
+			catch (BadgerDbException e) {
+				std::cerr << "ERROR: " << deltaInt.size() + deltaDouble.size() + deltaString.size() << " entries of the delta of "
+					<< file->filename() << " are lost: " << e.message() << std::endl;
+			}
+		}
+
+		//Write the root, which splits and deletes may have moved, back to the header, and the Bloom filter to its pages
+		Page* metapage;
+		bufMgr->readPage(file, headerPageNum, metapage);
+		((IndexMetaInfo *) metapage)->rootPageNo = rootPageNum;
+		((IndexMetaInfo *) metapage)->deltaPageNo = deltaPageNo;
+		try {
+			bufMgr->unPinPage(file, headerPageNum, true);
+		} catch (PageNotPinnedException e ){}
+		writeBloomFilter();
+
+		//bufMgr->printSelf();
+		bufMgr->flushFile(file);
+		file->~File();
+
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertEntry
+	// Descend iteratively, keeping the nodes a split could still reach pinned on
+	// a path stack, then absorb the splits bottom-up from that stack.
+	// Helper: unpinPath()
+	// 	   createNewRoot()
+	// -----------------------------------------------------------------------------
+
+	const void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
+	{
+		(this->*keyOps->insertEntry)(key, rid);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertEntryOfType
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::insertEntryOfType(const void *key, const RecordId rid) 
+	{
+		//Setup the RidKeyPair
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		RIDKeyPair<T> pair;
+		pair.set(rid, keyVal);
+
+		//Ascending keys skip the descent
+		if(appendToRightmostLeaf(pair)){
+			bloomFilterAdd(keyHash(pair.key));
+			return;
+		}
+
+		std::vector<PathEntry> path;
+		path.reserve(8);
+
+		//Descend the non-leaf levels
+		PageId pageId = rootPageNum;
+		while(1){
+			Page* page = pinHotNode(pageId);
+			NonLeafNode<T> *node = (NonLeafNode<T> *) page;
+			int slot = childIndex(node, pair.key);
+
+			//Empty tree, initLeaf() creates the first leaf and releases the node
+			if(node->pageNoArray[slot] == 0){
+				std::cout<<"Init newLeaf"<<std::endl;
+				unpinPath(path);
+				initLeaf(pair, node, pageId);
+				bloomFilterAdd(keyHash(pair.key));
+				return;
+			}
+
+			//A node with a free slot absorbs a split from below, nothing above it can change
+			if(nonLeafCheckFull(node) < nonLeafArraySize<T>())
+				unpinPath(path);
+			PathEntry entry;
+			entry.set(pageId, page, slot);
+			path.push_back(entry);
+
+			pageId = node->pageNoArray[slot];
+			if(node->level == 1)
+				break;
+		}
+
+		//Insert into the leaf
+		Page* page;
+		bufMgr->readPage(file, pageId, page);
+		LeafNode<T> *leaf = (LeafNode<T> *) page;
+		int currNodeSize = leafCheckFull(leaf);
+		int targetPos = lowerBoundKey(leaf->keyArray, currNodeSize, pair.key);
+		bool rightmost = leaf->rightSibPageNo == 0;
+
+		PageId newPageId = 0;	//stores new PageId if split happens
+		T newChildKey; 		//stores new Key pushed up if split happens
+		if(currNodeSize == leafArraySize<T>())
+			leafSplit(pair, leaf, pageId, newChildKey, newPageId, targetPos);
+		else{
+			//No split, the path is not needed anymore
+			unpinPath(path);
+			//Right shift all the element on the right of the targetPos in both arrays  
+			for(int j = currNodeSize; j > targetPos; j--){
+				leaf->keyArray[j] = leaf->keyArray[j -1]; //KeyArray
+				leaf->ridArray[j] = leaf->ridArray[j -1];//PageId
+			}
+			leaf->keyArray[targetPos] = pair.key;
+			leaf->ridArray[targetPos] = pair.rid;
+			leaf->numKeys++;
+		}
+		try{
+			bufMgr->unPinPage(file, pageId, true);		
+		}catch (PageNotPinnedException e) {}
+		//A split of the rightmost leaf moves the right end to the new leaf
+		if(rightmost)
+			rightmostLeafPageNum = newPageId != 0 ? newPageId : pageId;
+
+		insertIntoParents(path, newPageId, newChildKey);
+		bloomFilterAdd(keyHash(pair.key));
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertIntoParents
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::insertIntoParents(std::vector<PathEntry>& path, PageId newPageId, T& newChildKey)
+	{
+		//Absorb the split into the pinned parents, bottom-up
+		while(!path.empty()){
+			PathEntry entry = path.back();
+			path.pop_back();
+			NonLeafNode<T> *node = (NonLeafNode<T> *) entry.page;
+			bool dirty = newPageId != 0;
+			if(dirty){
+				int currNodeSize = nonLeafCheckFull(node);
+				//IF FULL, split
+				if(currNodeSize == nonLeafArraySize<T>()){
+					T pushedUpKey;
+					PageId splitPageId;
+					nonLeafSplit(node, pushedUpKey, splitPageId, entry.slot, newChildKey, newPageId);
+					newChildKey = pushedUpKey;
+					newPageId = splitPageId;
+				}
+				//Not full, shift
+				else{
+					for(int j = currNodeSize; j > entry.slot; j--){
+						node->keyArray[j] = node->keyArray[j -1]; //KeyArray
+						node->pageNoArray[j + 1] = node->pageNoArray[j];//PageId
+					}
+					node->keyArray[entry.slot] = newChildKey;
+					node->pageNoArray[entry.slot + 1] = newPageId;
+					node->numKeys++;
+					indexSeparators(node);
+					newPageId = 0;
+				}
+			}
+			unpinHotNode(entry.pageId, dirty);
+		}
+
+		//Handle newroot split
+		if(newPageId != 0)
+			createNewRoot(newPageId,newChildKey);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::createNewRoot for STRING keys
+	// -----------------------------------------------------------------------------
+	template <>
+	void BTreeIndex::createNewRoot<std::string>(PageId newChildId, std::string& newKey)
+	{
+		//Alloc space for the new root
+		PageId newRootId, oldRootPageNum;
+		Page *page;
+		Page *oldRootPage;
+		bufMgr->allocPage(file, newRootId, page);
+		bufMgr->readPage(file, rootPageNum, oldRootPage);
+		NonLeafNodeString *oldRoot = (NonLeafNodeString *) oldRootPage;
+		NonLeafNodeString *newRoot = (NonLeafNodeString *) page;
+
+		//Setup newRoot
+		std::vector<PageKeyPair<std::string> > entries(1);
+		entries[0].set(newChildId, newKey);
+		newRoot->level = oldRoot->level + 1;
+		newRoot->firstPageNo = rootPageNum;
+		encodeNode(newRoot, entries, 0, 1);
+		oldRootPageNum = rootPageNum;
+		rootPageNum = newRootId;
+
+		//Release both pages
+		try{
+			bufMgr->unPinPage(file, newRootId, true);
+			bufMgr->unPinPage(file, oldRootPageNum, false);
+		}
+		catch (PageNotPinnedException e) {}	
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertEntryOfType for STRING keys
+	// The same descent as for the fixed size keys. A key is added to a node in
+	// place while it shares the prefix of the node and fits, otherwise the node is
+	// rewritten with a shorter prefix or split.
+	// -----------------------------------------------------------------------------
+
+	template <>
+	void BTreeIndex::insertEntryOfType<std::string>(const void *key, const RecordId rid) 
+	{
+		std::string keyVal;
+		readKey(key, keyVal, keySize);
+		RIDKeyPair<std::string> pair;
+		pair.set(rid, keyVal);
+
+		std::vector<PathEntry> path;
+		path.reserve(8);
+
+		//Descend the non-leaf levels
+		PageId pageId = rootPageNum;
+		while(1){
+			Page* page = pinHotNode(pageId);
+			NonLeafNodeString *node = (NonLeafNodeString *) page;
+			int slot = childIndex(node, pair.key);
+
+			//Empty tree, create the first leaf
+			if(childPageNo(node, slot) == 0){
+				unpinPath(path);
+				PageId leafPageId;
+				Page* leafPage;
+				bufMgr->allocPage(file, leafPageId, leafPage);
+				LeafNodeString *leaf = (LeafNodeString *) leafPage;
+				std::vector<RIDKeyPair<std::string> > entries(1, pair);
+				encodeNode(leaf, entries, 0, 1);
+				leaf->rightSibPageNo = 0;
+				leaf->leftSibPageNo = 0;
+				node->firstPageNo = leafPageId;
+				try{
+					bufMgr->unPinPage(file, leafPageId, true);
+				}
+				catch (PageNotPinnedException e) {}		
+				unpinHotNode(pageId, true);
+				bloomFilterAdd(keyHash(pair.key));
+				return;
+			}
+
+			//A node that takes the longest separator even after losing its prefix
+			//absorbs a split from below, nothing above it can change
+			if(freeSpace(node) >= (int) sizeof(StringNonLeafSlot) + keySize + node->numKeys * node->prefixLength)
+				unpinPath(path);
+			PathEntry entry;
+			entry.set(pageId, page, slot);
+			path.push_back(entry);
+
+			pageId = childPageNo(node, slot);
+			if(node->level == 1)
+				break;
+		}
+
+		//Insert into the leaf
+		Page* page;
+		bufMgr->readPage(file, pageId, page);
+		LeafNodeString *leaf = (LeafNodeString *) page;
+		int targetPos = leafLowerBound(leaf, pair.key);
+
+		PageId newPageId = 0;	//stores new PageId if split happens
+		std::string newChildKey; 	//stores new Key pushed up if split happens
+		if(!insertInPlace(leaf, targetPos, pair)){
+			std::vector<RIDKeyPair<std::string> > entries;
+			if(!insertRewrite(leaf, targetPos, pair, entries))
+				stringLeafSplit(leaf, pageId, entries, targetPos == leaf->numKeys, newChildKey, newPageId);
+		}
+		//No split, the path is not needed anymore
+		if(newPageId == 0)
+			unpinPath(path);
+		try{
+			bufMgr->unPinPage(file, pageId, true);		
+		}catch (PageNotPinnedException e) {}
+
+		//Absorb the split into the pinned parents, bottom-up
+		while(!path.empty()){
+			PathEntry entry = path.back();
+			path.pop_back();
+			NonLeafNodeString *node = (NonLeafNodeString *) entry.page;
+			bool dirty = newPageId != 0;
+			if(dirty){
+				PageKeyPair<std::string> child;
+				child.set(newPageId, newChildKey);
+				newPageId = 0;
+				if(!insertInPlace(node, entry.slot, child)){
+					std::vector<PageKeyPair<std::string> > entries;
+					if(!insertRewrite(node, entry.slot, child, entries))
+						stringNonLeafSplit(node, entries, entry.slot == node->numKeys, newChildKey, newPageId);
+				}
+			}
+			unpinHotNode(entry.pageId, dirty);
+		}
+
+		//Handle newroot split
+		if(newPageId != 0)
+			createNewRoot(newPageId, newChildKey);
+		bloomFilterAdd(keyHash(pair.key));
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::stringLeafSplit
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::stringLeafSplit(LeafNodeString* node,
+			PageId pageId,
+			std::vector<RIDKeyPair<std::string> >& entries,
+			bool append,
+			std::string& newPushedUpKey,
+			PageId& newSplitPageId)
+	{
+		Page* newLeafPage;
+		bufMgr->allocPage(file, newSplitPageId, newLeafPage);
+		LeafNodeString *newLeaf = (LeafNodeString *) newLeafPage;
+
+		//Entries [0, midVal) stay, the rest move to the new leaf
+		int total = entries.size();
+		int midVal = fitSplitPoint<LeafNodeString>(entries, splitPoint(total, append, total - 1), 0);
+		encodeNode(node, entries, 0, midVal);
+		encodeNode(newLeaf, entries, midVal, total);
+		newPushedUpKey = shortestSeparator(entries[midVal - 1].key, entries[midVal].key);
+
+		//Setup sibling (insert)
+		newLeaf->rightSibPageNo = node->rightSibPageNo;
+		newLeaf->leftSibPageNo = pageId;
+		node->rightSibPageNo = newSplitPageId;
+		try{
+			bufMgr->unPinPage(file, newSplitPageId, true);
+		}
+		catch (PageNotPinnedException e) {}		
+
+		//The old right sibling now has the new leaf on its left
+		if(newLeaf->rightSibPageNo != 0){
+			Page* rightPage;
+			bufMgr->readPage(file, newLeaf->rightSibPageNo, rightPage);
+			((LeafNodeString *) rightPage)->leftSibPageNo = newSplitPageId;
+			try{
+				bufMgr->unPinPage(file, newLeaf->rightSibPageNo, true);
+			}
+			catch (PageNotPinnedException e) {}		
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::stringNonLeafSplit
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::stringNonLeafSplit(NonLeafNodeString* node,
+			std::vector<PageKeyPair<std::string> >& entries,
+			bool append,
+			std::string& newPushedUpKey,
+			PageId& newSplitPageId)
+	{
+		Page* newNonLeafPage;
+		bufMgr->allocPage(file, newSplitPageId, newNonLeafPage);
+		NonLeafNodeString *newNonLeaf = (NonLeafNodeString *) newNonLeafPage;
+
+		//Keys [0, midVal) stay, key midVal is pushed up, the rest move
+		int total = entries.size();
+		int midVal = fitSplitPoint<NonLeafNodeString>(entries, splitPoint(total, append, total - 2), 1);
+		newNonLeaf->level = node->level;
+		newNonLeaf->firstPageNo = entries[midVal].pageNo;
+		encodeNode(newNonLeaf, entries, midVal + 1, total);
+		encodeNode(node, entries, 0, midVal);
+		newPushedUpKey = entries[midVal].key;
+
+		//Release the page
+		try{
+			bufMgr->unPinPage(file,newSplitPageId, true);
+		}
+		catch (PageNotPinnedException e) {}	
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::appendToRightmostLeaf
+	// Every key not below the last key of the rightmost leaf belongs in that
+	// leaf, so no separator needs to be looked at. A full leaf is left to the
+	// descent in insertEntry, which keeps the path for the split.
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::appendToRightmostLeaf(RIDKeyPair<T> pair)
+	{
+		if(rightmostLeafPageNum == 0)
+			return false;
+		Page* page;
+		bufMgr->readPage(file, rightmostLeafPageNum, page);
+		LeafNode<T> *leaf = (LeafNode<T> *) page;
+		int currNodeSize = leafCheckFull(leaf);
+		bool append = currNodeSize > 0 && currNodeSize < leafArraySize<T>()
+			&& pair.key >= leaf->keyArray[currNodeSize - 1];
+		if(append){
+			leaf->keyArray[currNodeSize] = pair.key;
+			leaf->ridArray[currNodeSize] = pair.rid;
+			leaf->numKeys++;
+		}
+		try{
+			bufMgr->unPinPage(file, rightmostLeafPageNum, append);		
+		}catch (PageNotPinnedException e) {}
+		return append;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::splitPoint
+	// -----------------------------------------------------------------------------
+
+	int BTreeIndex::splitPoint(int total, bool append, int maxKeep)
+	{
+		int keep = append ? (int) (total * appendSplitRatio) : total / 2;
+		return std::max(1, std::min(keep, maxKeep));
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::unpinPath
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::unpinPath(std::vector<PathEntry>& path)
+	{
+		for(size_t i = 0; i < path.size(); i++)
+			unpinHotNode(path[i].pageId);
+		path.clear();
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::createBloomFilter
+	// -----------------------------------------------------------------------------
+	void BTreeIndex::createBloomFilter(const std::string & relationName)
+	{
+		size_t numRecords = 0;
+		{
+			PageFile relation(relationName, false);
+			for(FileIterator it = relation.begin(); it != relation.end(); ++it){
+				Page page = *it;
+				for(PageIterator rec = page.begin(); rec != page.end(); ++rec)
+					numRecords++;
+			}
+		}
+		size_t numBytes = std::max(numRecords * BLOOMBITSPERKEY / 8, (size_t) 1);
+		int numPages = (numBytes + BLOOMPAGEBYTES - 1) / BLOOMPAGEBYTES;
+		bloomNumHashes = BLOOMNUMHASHES;
+		bloomFilter.assign((size_t) numPages * BLOOMPAGEBYTES, 0);
+
+		//The pages are chained from the last one allocated, the bits are written by the destructor
+		PageId nextPageNo = 0;
+		for(int i = 0; i < numPages; i++){
+			PageId pageId;
+			Page* page;
+			bufMgr->allocPage(file, pageId, page);
+			((BloomFilterPage *) page)->nextPageNo = nextPageNo;
+			try{
+				bufMgr->unPinPage(file, pageId, true);
+			}catch (PageNotPinnedException e) {}
+			nextPageNo = pageId;
+		}
+		bloomPageNum = nextPageNo;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::readBloomFilter
+	// -----------------------------------------------------------------------------
+	void BTreeIndex::readBloomFilter(int numPages)
+	{
+		bloomFilter.resize((size_t) numPages * BLOOMPAGEBYTES);
+		PageId pageId = bloomPageNum;
+		for(int i = 0; i < numPages; i++){
+			Page* page;
+			bufMgr->readPage(file, pageId, page);
+			BloomFilterPage *filterPage = (BloomFilterPage *) page;
+			std::copy(filterPage->bits, filterPage->bits + BLOOMPAGEBYTES, bloomFilter.begin() + (size_t) i * BLOOMPAGEBYTES);
+			PageId nextPageNo = filterPage->nextPageNo;
+			try{
+				bufMgr->unPinPage(file, pageId, false);
+			}catch (PageNotPinnedException e) {}
+			pageId = nextPageNo;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::writeBloomFilter
+	// -----------------------------------------------------------------------------
+	void BTreeIndex::writeBloomFilter()
+	{
+		PageId pageId = bloomPageNum;
+		for(size_t pos = 0; pos < bloomFilter.size(); pos += BLOOMPAGEBYTES){
+			Page* page;
+			bufMgr->readPage(file, pageId, page);
+			BloomFilterPage *filterPage = (BloomFilterPage *) page;
+			std::copy(bloomFilter.begin() + pos, bloomFilter.begin() + pos + BLOOMPAGEBYTES, filterPage->bits);
+			PageId nextPageNo = filterPage->nextPageNo;
+			try{
+				bufMgr->unPinPage(file, pageId, true);
+			}catch (PageNotPinnedException e) {}
+			pageId = nextPageNo;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::writeDelta
+	// -----------------------------------------------------------------------------
+	PageId BTreeIndex::writeDelta()
+	{
+		if(!deltaInt.empty())
+			return writeDeltaOfType<int>();
+		if(!deltaDouble.empty())
+			return writeDeltaOfType<double>();
+		return writeDeltaOfType<std::string>();
+	}
+
+	template <class T>
+	PageId BTreeIndex::writeDeltaOfType()
+	{
+		PageId firstPageNo = 0, pageId = 0;
+		DeltaPage *deltaPage = NULL;
+		try{
+			for(typename std::multimap<T, RecordId>::const_iterator it = delta<T>().begin(); it != delta<T>().end(); ++it){
+				unsigned short length = keyLength(it->first);
+				int entrySize = sizeof(length) + length + sizeof(RecordId);
+				if(deltaPage == NULL || deltaPage->numBytes + entrySize > DELTAPAGEBYTES){
+					PageId nextPageId;
+					Page* page;
+					bufMgr->allocPage(file, nextPageId, page);
+					DeltaPage *nextPage = (DeltaPage *) page;
+					nextPage->nextPageNo = 0;
+					nextPage->numBytes = 0;
+					if(deltaPage == NULL)
+						firstPageNo = nextPageId;
+					else{
+						deltaPage->nextPageNo = nextPageId;
+						try{
+							bufMgr->unPinPage(file, pageId, true);
+						}catch (PageNotPinnedException e) {}
+					}
+					deltaPage = nextPage;
+					pageId = nextPageId;
+				}
+				char *entry = deltaPage->entries + deltaPage->numBytes;
+				memcpy(entry, &length, sizeof(length));
+				memcpy(entry + sizeof(length), keyPointer(it->first), length);
+				memcpy(entry + sizeof(length) + length, &it->second, sizeof(RecordId));
+				deltaPage->numBytes += entrySize;
+			}
+		}
+		catch(...){
+			if(deltaPage != NULL){
+				try{
+					bufMgr->unPinPage(file, pageId, true);
+				}catch (PageNotPinnedException e) {}
+			}
+			throw;
+		}
+		if(deltaPage != NULL){
+			try{
+				bufMgr->unPinPage(file, pageId, true);
+			}catch (PageNotPinnedException e) {}
+		}
+		return firstPageNo;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::readDelta
+	// -----------------------------------------------------------------------------
+	void BTreeIndex::readDelta(PageId pageNo)
+	{
+		//The keys get a terminator, so that char string keys read like those passed to insertEntry()
+		std::vector<std::pair<std::string, RecordId> > entries;
+		std::vector<PageId> pageIds;
+		for(PageId pageId = pageNo; pageId != 0;){
+			Page* page;
+			bufMgr->readPage(file, pageId, page);
+			const DeltaPage *deltaPage = (const DeltaPage *) page;
+			for(int pos = 0; pos < deltaPage->numBytes;){
+				unsigned short length;
+				memcpy(&length, deltaPage->entries + pos, sizeof(length));
+				std::pair<std::string, RecordId> entry;
+				entry.first.assign(deltaPage->entries + pos + sizeof(length), length);
+				memcpy(&entry.second, deltaPage->entries + pos + sizeof(length) + length, sizeof(RecordId));
+				entries.push_back(entry);
+				pos += sizeof(length) + length + sizeof(RecordId);
+			}
+			pageIds.push_back(pageId);
+			PageId nextPageNo = deltaPage->nextPageNo;
+			try{
+				bufMgr->unPinPage(file, pageId, false);
+			}catch (PageNotPinnedException e) {}
+			pageId = nextPageNo;
+		}
+
+		for(size_t i = 0; i < entries.size(); i++)
+			insertEntry(entries[i].first.c_str(), entries[i].second);
+
+		//The entries are in the index now, the pages go
+		Page* metapage;
+		bufMgr->readPage(file, headerPageNum, metapage);
+		((IndexMetaInfo *) metapage)->deltaPageNo = 0;
+		try{
+			bufMgr->unPinPage(file, headerPageNum, true);
+		}catch (PageNotPinnedException e) {}
+		for(size_t i = 0; i < pageIds.size(); i++)
+			bufMgr->disposePage(file, pageIds[i]);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bloomFilterAdd
+	// The i-th bit of a key is h1 + i * h2 (double hashing)
+	// -----------------------------------------------------------------------------
+	void BTreeIndex::bloomFilterAdd(unsigned int hash)
+	{
+		if(bloomFilter.empty())
+			return;
+		unsigned int h1 = hash;
+		unsigned int h2 = bloomHash(h1) | 1;
+		for(int i = 0; i < bloomNumHashes; i++){
+			size_t bit = (h1 + i * h2) % (bloomFilter.size() * 8);
+			//Inserts of a concurrent index may set bits of the same byte at once
+			__atomic_fetch_or(&bloomFilter[bit / 8], (unsigned char) (1 << (bit % 8)), __ATOMIC_RELAXED);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bloomFilterMayContain
+	// -----------------------------------------------------------------------------
+	bool BTreeIndex::bloomFilterMayContain(unsigned int hash)
+	{
+		if(bloomFilter.empty())
+			return true;
+		unsigned int h1 = hash;
+		unsigned int h2 = bloomHash(h1) | 1;
+		for(int i = 0; i < bloomNumHashes; i++){
+			size_t bit = (h1 + i * h2) % (bloomFilter.size() * 8);
+			if(!(__atomic_load_n(&bloomFilter[bit / 8], __ATOMIC_RELAXED) & (1 << (bit % 8))))
+				return false;
+		}
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookup
+	// -----------------------------------------------------------------------------
+
+	const bool BTreeIndex::lookup(const void* key, std::vector<RecordId>& outRids)
+	{
+		return (this->*keyOps->lookup)(key, outRids);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookupOfType
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::lookupOfType(const void* key, std::vector<RecordId>& outRids)
+	{
+		typedef typename NodeTypes<T>::Leaf Leaf;
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		if(!bloomFilterMayContain(keyHash(keyVal))){
+			bloomFilterSkips++;
+			return false;
+		}
+
+		PageId pageNum = findLeaf(keyVal, true);
+		if(pageNum == 0)
+			return false;
+		Page* page;
+		bufMgr->readPage(file, pageNum, page);
+		Leaf* leaf = (Leaf *) page;
+
+		//Duplicates of the key may start in a leaf to the left
+		while(leaf->numKeys > 0 && leafKeyEquals(leaf, 0, keyVal) && leaf->leftSibPageNo != 0){
+			PageId leftPageNum = leaf->leftSibPageNo;
+			try{
+				bufMgr->unPinPage(file, pageNum, false);
+			}catch (PageNotPinnedException e) {}
+			pageNum = leftPageNum;
+			bufMgr->readPage(file, pageNum, page);
+			leaf = (Leaf *) page;
+		}
+
+		//Collect the entries, moving right while they run up to the end of the leaf
+		size_t numFound = outRids.size();
+		int pos = leafLowerBound(leaf, keyVal);
+		while(1){
+			for(; pos < leaf->numKeys && leafKeyEquals(leaf, pos, keyVal); pos++)
+				outRids.push_back(leafRid(leaf, pos));
+			if(pos < leaf->numKeys || leaf->rightSibPageNo == 0)
+				break;
+			PageId rightPageNum = leaf->rightSibPageNo;
+			try{
+				bufMgr->unPinPage(file, pageNum, false);
+			}catch (PageNotPinnedException e) {}
+			pageNum = rightPageNum;
+			bufMgr->readPage(file, pageNum, page);
+			leaf = (Leaf *) page;
+			pos = 0;
+		}
+		try{
+			bufMgr->unPinPage(file, pageNum, false);
+		}catch (PageNotPinnedException e) {}
+		return outRids.size() > numFound;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteEntry
+	// -----------------------------------------------------------------------------
+
+	const bool BTreeIndex::deleteEntry(const void *key, const RecordId rid) 
+	{
+		return (this->*keyOps->deleteEntry)(key, rid);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteEntryOfType
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::deleteEntryOfType(const void *key, const RecordId rid) 
+	{
+		typedef typename NodeTypes<T>::Leaf Leaf;
+		typedef typename NodeTypes<T>::NonLeaf NonLeaf;
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		if(!deleteFromSubtree(rootPageNum, keyVal, rid))
+			return false;
+
+		//A root left with a single child hands over to it, the last leaf goes once it is empty
+		NonLeaf *root = (NonLeaf *) pinHotNode(rootPageNum);
+		bool dirty = false;
+		if(root->numKeys == 0 && root->level > 1){
+			PageId oldRootPageNum = rootPageNum;
+			rootPageNum = childPageNo(root, 0);
+			dropHotNode(oldRootPageNum);
+			bufMgr->disposePage(file, oldRootPageNum);
+			return true;
+		}
+		if(root->numKeys == 0){
+			PageId leafPageNum = childPageNo(root, 0);
+			Page* leafPage;
+			bufMgr->readPage(file, leafPageNum, leafPage);
+			if(((Leaf *) leafPage)->numKeys == 0){
+				bufMgr->disposePage(file, leafPageNum);
+				setFirstChild(root, 0);
+				rightmostLeafPageNum = 0;
+				dirty = true;
+			}
+			else{
+				try{
+					bufMgr->unPinPage(file, leafPageNum, false);
+				}catch (PageNotPinnedException e) {}
+			}
+		}
+		unpinHotNode(rootPageNum, dirty);
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteFromSubtree
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::deleteFromSubtree(PageId pageId, const T& key, const RecordId& rid)
+	{
+		typedef typename NodeTypes<T>::Leaf Leaf;
+		typedef typename NodeTypes<T>::NonLeaf NonLeaf;
+		NonLeaf *node = (NonLeaf *) pinHotNode(pageId);
+
+		bool found = false;
+		int lastIdx = childIndex(node, key);
+		for(int idx = firstChildIndex(node, key); idx <= lastIdx && !found; idx++){
+			PageId childPageNum = childPageNo(node, idx);
+			//Empty tree
+			if(childPageNum == 0)
+				break;
+			if(node->level == 1){
+				Page* leafPage;
+				bufMgr->readPage(file, childPageNum, leafPage);
+				found = leafRemove((Leaf *) leafPage, key, rid);
+				try{
+					bufMgr->unPinPage(file, childPageNum, found);
+				}catch (PageNotPinnedException e) {}
+			}
+			else
+				found = deleteFromSubtree(childPageNum, key, rid);
+			if(found)
+				rebalanceChild<T>(node, idx);
+		}
+		unpinHotNode(pageId, found);
+		return found;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::rebalanceChild
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::rebalanceChild(typename NodeTypes<T>::NonLeaf* node, int idx)
+	{
+		typedef typename NodeTypes<T>::Leaf Leaf;
+		typedef typename NodeTypes<T>::NonLeaf NonLeaf;
+		PageId childPageNum = childPageNo(node, idx);
+		Page* childPage;
+		bufMgr->readPage(file, childPageNum, childPage);
+		bool isUnderflow = node->level == 1 ? underflow((Leaf *) childPage) : underflow((NonLeaf *) childPage);
+		//A single child has no sibling to rebalance with
+		if(!isUnderflow || node->numKeys == 0){
+			try{
+				bufMgr->unPinPage(file, childPageNum, false);
+			}catch (PageNotPinnedException e) {}
+			return;
+		}
+
+		//The child and its left sibling, or its right one for the first child
+		int sepIdx = idx > 0 ? idx - 1 : 0;
+		PageId siblingPageNum = childPageNo(node, idx > 0 ? idx - 1 : 1);
+		Page* siblingPage;
+		bufMgr->readPage(file, siblingPageNum, siblingPage);
+		PageId leftPageNum = idx > 0 ? siblingPageNum : childPageNum;
+		PageId rightPageNum = idx > 0 ? childPageNum : siblingPageNum;
+		Page* leftPage = idx > 0 ? siblingPage : childPage;
+		Page* rightPage = idx > 0 ? childPage : siblingPage;
+
+		bool merged;
+		bool moved = false;
+		if(node->level == 1){
+			Leaf *left = (Leaf *) leftPage;
+			Leaf *right = (Leaf *) rightPage;
+			merged = mergeLeaves(left, right);
+			if(merged){
+				//Unlink right from the leaf level
+				left->rightSibPageNo = right->rightSibPageNo;
+				if(right->rightSibPageNo != 0){
+					Page* nextPage;
+					bufMgr->readPage(file, right->rightSibPageNo, nextPage);
+					((Leaf *) nextPage)->leftSibPageNo = leftPageNum;
+					try{
+						bufMgr->unPinPage(file, right->rightSibPageNo, true);
+					}catch (PageNotPinnedException e) {}
+				}
+				if(rightmostLeafPageNum == rightPageNum)
+					rightmostLeafPageNum = leftPageNum;
+			}
+			else
+				moved = redistributeLeaves(left, right, node, sepIdx);
+		}
+		else{
+			NonLeaf *left = (NonLeaf *) leftPage;
+			NonLeaf *right = (NonLeaf *) rightPage;
+			merged = mergeNonLeaves(left, separatorAt(node, sepIdx), right);
+			if(!merged)
+				moved = redistributeNonLeaves(left, right, node, sepIdx);
+		}
+
+		//A merge frees the right node
+		if(merged){
+			removeSeparator(node, sepIdx);
+			try{
+				bufMgr->unPinPage(file, leftPageNum, true);
+			}catch (PageNotPinnedException e) {}
+			dropHotNode(rightPageNum);
+			bufMgr->disposePage(file, rightPageNum);
+		}
+		else{
+			try{
+				bufMgr->unPinPage(file, leftPageNum, moved);
+				bufMgr->unPinPage(file, rightPageNum, moved);
+			}catch (PageNotPinnedException e) {}
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::descendConcurrent
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	PageId BTreeIndex::descendConcurrent(const T& key, bool upper, int level, std::vector<PageId>* path)
+	{
+		size_t pathSize = path != NULL ? path->size() : 0;
+		while(1){
+			if(path != NULL)
+				path->resize(pathSize);
+			//Non-leaf nodes come from the hot nodes, so that readers reach them without the buffer pool mutex
+			PageId pageId = rootPageNum;
+			Page* page = pinHotNode(pageId);
+			unsigned int version = bufMgr->readVersion(page);
+			while(1){
+				//A writer may change the node while it is read, so nothing read is used
+				//before the version is validated, and numKeys is kept inside the arrays
+				NonLeafNode<T> *node = (NonLeafNode<T> *) page;
+				int numKeys = std::min(std::max(node->numKeys, 0), nonLeafArraySize<T>());
+				int nodeLevel = node->level;
+				PageId rightPageNum = node->rightSibPageNo;
+				bool right = rightPageNum != 0 && (upper ? !(key < node->highKey) : node->highKey < key);
+				PageId childPageNum = node->pageNoArray[searchChildren(node, numKeys, key, upper)];
+				if(!bufMgr->validateVersion(page, version))
+					break;
+
+				PageId nextPageNum = rightPageNum;
+				if(!right){
+					if(nodeLevel == level){
+						unpinHotNode(pageId);
+						return pageId;
+					}
+					if(path != NULL)
+						path->push_back(pageId);
+					//Only the root of an empty tree has no child
+					if(childPageNum == 0 || nodeLevel == level + 1){
+						unpinHotNode(pageId);
+						return childPageNum;
+					}
+					nextPageNum = childPageNum;
+				}
+
+				//Pages of a concurrent index are never freed, a validated link stays valid
+				Page* nextPage = pinHotNode(nextPageNum);
+				unpinHotNode(pageId);
+				pageId = nextPageNum;
+				page = nextPage;
+				version = bufMgr->readVersion(page);
+			}
+			unpinHotNode(pageId);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::moveRight
+	// -----------------------------------------------------------------------------
+
+	template <class Node, class T>
+	Node* BTreeIndex::moveRight(PageId& pageId, Page*& page, const T& key, bool upper, LatchMode latchMode)
+	{
+		Node *node = (Node *) page;
+		while(node->rightSibPageNo != 0 && (upper ? !(key < node->highKey) : node->highKey < key)){
+			//Latch the right node before the current one is released
+			PageId rightPageNum = node->rightSibPageNo;
+			Page* rightPage;
+			bufMgr->readPage(file, rightPageNum, rightPage, latchMode);
+			try{
+				bufMgr->unPinPage(file, pageId, false, latchMode);
+			}catch (PageNotPinnedException e) {}
+			pageId = rightPageNum;
+			page = rightPage;
+			node = (Node *) page;
+		}
+		return node;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertEntryConcurrent
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::insertEntryConcurrent(const void *key, const RecordId rid)
+	{
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		RIDKeyPair<T> pair;
+		pair.set(rid, keyVal);
+		//Set the filter bits before the entry can be found
+		bloomFilterAdd(keyHash(pair.key));
+
+		//Nodes on the way down, the parents of a split
+		std::vector<PageId> path;
+		path.reserve(8);
+		PageId pageId;
+		while(1){
+			path.clear();
+			pageId = descendConcurrent(keyVal, true, 0, &path);
+			if(pageId != 0)
+				break;
+
+			//Empty tree, the first insert to latch the root creates the first leaf
+			Page* page;
+			PageId rootId = path.back();
+			bufMgr->readPage(file, rootId, page, LATCH_EXCLUSIVE);
+			NonLeafNode<T> *root = (NonLeafNode<T> *) page;
+			if(root->pageNoArray[0] == 0){
+				initLeaf(pair, root, rootId);
+				return;
+			}
+			try{
+				bufMgr->unPinPage(file, rootId, false, LATCH_EXCLUSIVE);
+			}catch (PageNotPinnedException e) {}
+		}
+
+		//Insert into the leaf
+		Page* page;
+		bufMgr->readPage(file, pageId, page, LATCH_EXCLUSIVE);
+		LeafNode<T> *leaf = moveRight<LeafNode<T> >(pageId, page, keyVal, true, LATCH_EXCLUSIVE);
+		int currNodeSize = leafCheckFull(leaf);
+		int targetPos = lowerBoundKey(leaf->keyArray, currNodeSize, pair.key);
+		PageId newPageId = 0;	//stores new PageId if split happens
+		T newChildKey; 		//stores new Key pushed up if split happens
+		if(currNodeSize == leafArraySize<T>())
+			leafSplit(pair, leaf, pageId, newChildKey, newPageId, targetPos);
+		else{
+			for(int j = currNodeSize; j > targetPos; j--){
+				leaf->keyArray[j] = leaf->keyArray[j -1];
+				leaf->ridArray[j] = leaf->ridArray[j -1];
+			}
+			leaf->keyArray[targetPos] = pair.key;
+			leaf->ridArray[targetPos] = pair.rid;
+			leaf->numKeys++;
+		}
+
+		//Carry the split up. The split node stays latched until its parent is, so
+		//the right half cannot be split again before its link reaches the parent
+		int level = 1;
+		while(newPageId != 0){
+			//Only the node the root pointer names can grow a new root
+			if(path.empty() && rootPageNum == pageId){
+				createNewRoot(newPageId, newChildKey);
+				break;
+			}
+			PageId parentId;
+			if(!path.empty()){
+				parentId = path.back();
+				path.pop_back();
+			}
+			else
+				parentId = descendConcurrent(newChildKey, false, level, NULL);
+
+			//The link to the split node is in this parent or moved right with a split of it
+			Page* parentPage;
+			bufMgr->readPage(file, parentId, parentPage, LATCH_EXCLUSIVE);
+			NonLeafNode<T> *parent = (NonLeafNode<T> *) parentPage;
+			int slot = std::find(parent->pageNoArray, parent->pageNoArray + parent->numKeys + 1, pageId) - parent->pageNoArray;
+			while(slot > parent->numKeys){
+				PageId rightPageNum = parent->rightSibPageNo;
+				bufMgr->readPage(file, rightPageNum, parentPage, LATCH_EXCLUSIVE);
+				try{
+					bufMgr->unPinPage(file, parentId, false, LATCH_EXCLUSIVE);
+				}catch (PageNotPinnedException e) {}
+				parentId = rightPageNum;
+				parent = (NonLeafNode<T> *) parentPage;
+				slot = std::find(parent->pageNoArray, parent->pageNoArray + parent->numKeys + 1, pageId) - parent->pageNoArray;
+			}
+			try{
+				bufMgr->unPinPage(file, pageId, true, LATCH_EXCLUSIVE);
+			}catch (PageNotPinnedException e) {}
+
+			int currNodeSize = nonLeafCheckFull(parent);
+			if(currNodeSize == nonLeafArraySize<T>()){
+				T pushedUpKey;
+				PageId splitPageId;
+				nonLeafSplit(parent, pushedUpKey, splitPageId, slot, newChildKey, newPageId);
+				newChildKey = pushedUpKey;
+				newPageId = splitPageId;
+			}
+			else{
+				for(int j = currNodeSize; j > slot; j--){
+					parent->keyArray[j] = parent->keyArray[j -1];
+					parent->pageNoArray[j + 1] = parent->pageNoArray[j];
+				}
+				parent->keyArray[slot] = newChildKey;
+				parent->pageNoArray[slot + 1] = newPageId;
+				parent->numKeys++;
+				indexSeparators(parent);
+				newPageId = 0;
+			}
+			pageId = parentId;
+			level++;
+		}
+		try{
+			bufMgr->unPinPage(file, pageId, true, LATCH_EXCLUSIVE);
+		}catch (PageNotPinnedException e) {}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteEntryConcurrent
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::deleteEntryConcurrent(const void *key, const RecordId rid)
+	{
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		PageId pageId = descendConcurrent(keyVal, false, 0, NULL);
+		if(pageId == 0)
+			return false;
+
+		Page* page;
+		bufMgr->readPage(file, pageId, page, LATCH_EXCLUSIVE);
+		LeafNode<T> *leaf = moveRight<LeafNode<T> >(pageId, page, keyVal, false, LATCH_EXCLUSIVE);
+
+		//Duplicates of the key may continue in the leaves to the right
+		bool found;
+		while(!(found = leafRemove(leaf, keyVal, rid)) && leaf->rightSibPageNo != 0 && !(keyVal < leaf->highKey)){
+			PageId rightPageNum = leaf->rightSibPageNo;
+			bufMgr->readPage(file, rightPageNum, page, LATCH_EXCLUSIVE);
+			try{
+				bufMgr->unPinPage(file, pageId, false, LATCH_EXCLUSIVE);
+			}catch (PageNotPinnedException e) {}
+			pageId = rightPageNum;
+			leaf = (LeafNode<T> *) page;
+		}
+		try{
+			bufMgr->unPinPage(file, pageId, found, LATCH_EXCLUSIVE);
+		}catch (PageNotPinnedException e) {}
+		return found;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookupConcurrent
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::lookupConcurrent(const void* key, std::vector<RecordId>& outRids)
+	{
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		if(!bloomFilterMayContain(keyHash(keyVal))){
+			bloomFilterSkips++;
+			return false;
+		}
+
+		//The lower descent ends on the leftmost leaf that can hold the key
+		PageId pageNum = descendConcurrent(keyVal, false, 0, NULL);
+		if(pageNum == 0)
+			return false;
+		Page* page;
+		bufMgr->readPage(file, pageNum, page, LATCH_SHARED);
+		LeafNode<T> *leaf = moveRight<LeafNode<T> >(pageNum, page, keyVal, false, LATCH_SHARED);
+
+		//Collect the entries, moving right while the key range of the leaf ends at the key
+		size_t numFound = outRids.size();
+		int pos = leafLowerBound(leaf, keyVal);
+		while(1){
+			for(; pos < leaf->numKeys && leaf->keyArray[pos] == keyVal; pos++)
+				outRids.push_back(leaf->ridArray[pos]);
+			if(pos < leaf->numKeys || leaf->rightSibPageNo == 0 || keyVal < leaf->highKey)
+				break;
+			PageId rightPageNum = leaf->rightSibPageNo;
+			bufMgr->readPage(file, rightPageNum, page, LATCH_SHARED);
+			try{
+				bufMgr->unPinPage(file, pageNum, false, LATCH_SHARED);
+			}catch (PageNotPinnedException e) {}
+			pageNum = rightPageNum;
+			leaf = (LeafNode<T> *) page;
+			pos = 0;
+		}
+		try{
+			bufMgr->unPinPage(file, pageNum, false, LATCH_SHARED);
+		}catch (PageNotPinnedException e) {}
+		return outRids.size() > numFound;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bulkLoadPosting
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::bulkLoadPosting(const std::string & relationName, double fillFactor)
+	{
+		if(fillFactor <= 0 || fillFactor > 1) fillFactor = 1.0;
+
+		std::vector<RIDKeyPair<int> > pairs;
+		extractPairs(relationName, pairs);
+		if(pairs.empty())
+			return;
+
+		//One list per distinct key, the pairs order the rids of a key by page only
+		std::vector<PostingList> lists;
+		std::vector<RecordId> rids;
+		for(size_t begin = 0; begin < pairs.size();){
+			size_t end = begin;
+			rids.clear();
+			while(end < pairs.size() && pairs[end].key == pairs[begin].key)
+				rids.push_back(pairs[end++].rid);
+			std::sort(rids.begin(), rids.end(), ridLess);
+
+			PostingList list;
+			list.key = pairs[begin].key;
+			list.overflowPageNo = 0;
+			setPostingList(list, rids);
+			lists.push_back(list);
+			begin = end;
+		}
+
+		//Bytes per leaf at the requested fill factor, at least one list of the largest inline size
+		int leafFill = std::max((int) (POSTINGLEAFSPACE * fillFactor), (int) sizeof(PostingSlot) + POSTINGINLINESIZE);
+
+		//Write the leaves left to right, remembering <first key, pageNo> of each
+		std::vector<PageKeyPair<int> > level;
+		size_t pos = 0;
+		PageId prevPageId = 0;
+		PostingLeafNode *prevLeaf = NULL;
+		while(pos < lists.size()){
+			size_t end = pos;
+			int size = 0;
+			while(end < lists.size() && size + postingSize(lists[end]) <= leafFill)
+				size += postingSize(lists[end++]);
+
+			PageId pageId;
+			Page *page;
+			bufMgr->allocPage(file, pageId, page);
+			PostingLeafNode *leaf = (PostingLeafNode *) page;
+			encodePostingLeaf(leaf, lists, pos, end);
+			leaf->rightSibPageNo = 0;
+			leaf->leftSibPageNo = prevPageId;
+
+			PageKeyPair<int> entry;
+			entry.set(pageId, lists[pos].key);
+			level.push_back(entry);
+			pos = end;
+
+			if(prevLeaf != NULL){
+				prevLeaf->rightSibPageNo = pageId;
+				try{
+					bufMgr->unPinPage(file, prevPageId, true);
+				}catch (PageNotPinnedException e) {}
+			}
+			prevLeaf = leaf;
+			prevPageId = pageId;
+		}
+		try{
+			bufMgr->unPinPage(file, prevPageId, true);
+		}catch (PageNotPinnedException e) {}
+
+		buildNonLeafLevels(level, fillFactor);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertEntryPosting
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::insertEntryPosting(const void *key, const RecordId rid)
+	{
+		int keyVal;
+		readKey(key, keyVal, keySize);
+		std::vector<PathEntry> path;
+		path.reserve(8);
+
+		//Descend the non-leaf levels, as insertEntryOfType<int>()
+		PageId pageId = rootPageNum;
+		while(1){
+			Page* page = pinHotNode(pageId);
+			NonLeafNode<int> *node = (NonLeafNode<int> *) page;
+			int slot = childIndex(node, keyVal);
+
+			//Empty tree, the first leaf holds the new list
+			if(node->pageNoArray[slot] == 0){
+				unpinPath(path);
+				PageId leafPageId;
+				Page* leafPage;
+				bufMgr->allocPage(file, leafPageId, leafPage);
+				PostingLeafNode *leaf = (PostingLeafNode *) leafPage;
+				leaf->rightSibPageNo = 0;
+				leaf->leftSibPageNo = 0;
+				PostingList list;
+				list.key = keyVal;
+				list.overflowPageNo = 0;
+				setPostingList(list, std::vector<RecordId>(1, rid));
+				std::vector<PostingList> lists(1, list);
+				encodePostingLeaf(leaf, lists, 0, 1);
+				node->pageNoArray[0] = leafPageId;
+				try{
+					bufMgr->unPinPage(file, leafPageId, true);
+				}catch (PageNotPinnedException e) {}
+				unpinHotNode(pageId, true);
+				bloomFilterAdd(keyHash(keyVal));
+				return;
+			}
+
+			if(node->numKeys < nonLeafArraySize<int>())
+				unpinPath(path);
+			PathEntry entry;
+			entry.set(pageId, page, slot);
+			path.push_back(entry);
+
+			pageId = node->pageNoArray[slot];
+			if(node->level == 1)
+				break;
+		}
+
+		//Add to the list of the key, or insert a new one
+		Page* page;
+		bufMgr->readPage(file, pageId, page);
+		PostingLeafNode *leaf = (PostingLeafNode *) page;
+		int pos = postingLowerBound(leaf, keyVal);
+		bool replace = pos < leaf->numKeys && leaf->slotArray[pos].key == keyVal;
+		bool append = pos == leaf->numKeys;
+		PostingList list;
+		if(replace){
+			readPostingSlot(leaf, pos, list);
+			addToPostingList(list, rid);
+		}else{
+			list.key = keyVal;
+			list.overflowPageNo = 0;
+			setPostingList(list, std::vector<RecordId>(1, rid));
+		}
+
+		PageId newPageId = 0;
+		int newChildKey;
+		std::vector<PostingList> lists;
+		if(!storePostingList(leaf, pos, replace, list, lists))
+			postingLeafSplit(leaf, pageId, lists, append, newChildKey, newPageId);
+		else
+			unpinPath(path);
+		try{
+			bufMgr->unPinPage(file, pageId, true);
+		}catch (PageNotPinnedException e) {}
+
+		insertIntoParents(path, newPageId, newChildKey);
+		bloomFilterAdd(keyHash(keyVal));
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::postingLeafSplit
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::postingLeafSplit(PostingLeafNode* leaf,
+			PageId pageId,
+			const std::vector<PostingList>& lists,
+			bool append,
+			int& newPushedUpKey,
+			PageId& newSplitPageId)
+	{
+		//Divide the bytes as splitPoint() divides entries, then make sure both halves fit
+		int total = 0;
+		for(size_t i = 0; i < lists.size(); i++)
+			total += postingSize(lists[i]);
+		int target = (int) (total * (append ? appendSplitRatio : 0.5));
+		int keep = 0, kept = 0;
+		while(keep < (int) lists.size() - 1 && (keep == 0 || kept + postingSize(lists[keep]) <= target))
+			kept += postingSize(lists[keep++]);
+		while(kept > POSTINGLEAFSPACE)
+			kept -= postingSize(lists[--keep]);
+		while(total - kept > POSTINGLEAFSPACE)
+			kept += postingSize(lists[keep++]);
+
+		Page* page;
+		bufMgr->allocPage(file, newSplitPageId, page);
+		PostingLeafNode *right = (PostingLeafNode *) page;
+		encodePostingLeaf(right, lists, keep, lists.size());
+		encodePostingLeaf(leaf, lists, 0, keep);
+		newPushedUpKey = lists[keep].key;
+
+		//Link the new leaf between the node and its right sibling
+		right->rightSibPageNo = leaf->rightSibPageNo;
+		right->leftSibPageNo = pageId;
+		if(leaf->rightSibPageNo != 0){
+			Page* sibPage;
+			bufMgr->readPage(file, leaf->rightSibPageNo, sibPage);
+			((PostingLeafNode *) sibPage)->leftSibPageNo = newSplitPageId;
+			try{
+				bufMgr->unPinPage(file, leaf->rightSibPageNo, true);
+			}catch (PageNotPinnedException e) {}
+		}
+		leaf->rightSibPageNo = newSplitPageId;
+		try{
+			bufMgr->unPinPage(file, newSplitPageId, true);
+		}catch (PageNotPinnedException e) {}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteEntryPosting
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::deleteEntryPosting(const void *key, const RecordId rid)
+	{
+		int keyVal;
+		readKey(key, keyVal, keySize);
+		PageId pageNum = findLeaf(keyVal, true);
+		if(pageNum == 0)
+			return false;
+		Page* page;
+		bufMgr->readPage(file, pageNum, page);
+		PostingLeafNode *leaf = (PostingLeafNode *) page;
+
+		int pos = postingLowerBound(leaf, keyVal);
+		bool found = false;
+		if(pos < leaf->numKeys && leaf->slotArray[pos].key == keyVal){
+			PostingList list;
+			readPostingSlot(leaf, pos, list);
+			std::vector<RecordId> rids;
+			readPostingList(list, rids);
+			std::vector<RecordId>::iterator it = std::lower_bound(rids.begin(), rids.end(), rid, ridLess);
+			found = it != rids.end() && *it == rid;
+			if(found){
+				rids.erase(it);
+				//An emptied list goes away with its slot, any other shrinks in place
+				if(rids.empty()){
+					freeOverflowPages(list.overflowPageNo);
+					removeSlot(leaf, pos);
+				}else{
+					std::vector<PostingList> lists;
+					setPostingList(list, rids);
+					storePostingList(leaf, pos, true, list, lists);
+				}
+			}
+		}
+		try{
+			bufMgr->unPinPage(file, pageNum, found);
+		}catch (PageNotPinnedException e) {}
+		return found;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookupPosting
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::lookupPosting(const void *key, std::vector<RecordId>& outRids)
+	{
+		int keyVal;
+		readKey(key, keyVal, keySize);
+		if(!bloomFilterMayContain(keyHash(keyVal))){
+			bloomFilterSkips++;
+			return false;
+		}
+
+		PageId pageNum = findLeaf(keyVal, true);
+		if(pageNum == 0)
+			return false;
+		Page* page;
+		bufMgr->readPage(file, pageNum, page);
+		PostingLeafNode *leaf = (PostingLeafNode *) page;
+
+		//All entries of the key are in its one list
+		int pos = postingLowerBound(leaf, keyVal);
+		bool found = pos < leaf->numKeys && leaf->slotArray[pos].key == keyVal;
+		if(found){
+			PostingList list;
+			readPostingSlot(leaf, pos, list);
+			readPostingList(list, outRids);
+		}
+		try{
+			bufMgr->unPinPage(file, pageNum, false);
+		}catch (PageNotPinnedException e) {}
+		return found;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::readPostingList
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::readPostingList(const PostingList& list, std::vector<RecordId>& rids)
+	{
+		if(list.overflowPageNo == 0){
+			decodeRids(list.bytes.data(), list.numRids, rids);
+			return;
+		}
+		for(PageId pageNo = list.overflowPageNo; pageNo != 0;){
+			Page* page;
+			bufMgr->readPage(file, pageNo, page);
+			PostingOverflowPage *overflow = (PostingOverflowPage *) page;
+			decodeRids(overflow->bytes, overflow->numRids, rids);
+			PageId nextPageNo = overflow->nextPageNo;
+			try{
+				bufMgr->unPinPage(file, pageNo, false);
+			}catch (PageNotPinnedException e) {}
+			pageNo = nextPageNo;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::setPostingList
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::setPostingList(PostingList& list, const std::vector<RecordId>& rids)
+	{
+		std::string bytes;
+		if(!rids.empty())
+			appendRids(bytes, &rids[0], rids.size(), 0);
+		if(list.overflowPageNo != 0 && !rids.empty())
+			writeOverflowPages(list, rids);
+		else if(bytes.size() > (size_t) POSTINGINLINESIZE)
+			writeOverflowPages(list, rids);
+		else{
+			freeOverflowPages(list.overflowPageNo);
+			list.overflowPageNo = 0;
+			list.numRids = rids.size();
+			list.bytes.swap(bytes);
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::addToPostingList
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::addToPostingList(PostingList& list, const RecordId& rid)
+	{
+		if(list.overflowPageNo != 0){
+			//Find the last page of the chain
+			PageId pageNo = list.overflowPageNo;
+			Page* page;
+			bufMgr->readPage(file, pageNo, page);
+			PostingOverflowPage *overflow = (PostingOverflowPage *) page;
+			while(overflow->nextPageNo != 0){
+				PageId nextPageNo = overflow->nextPageNo;
+				try{
+					bufMgr->unPinPage(file, pageNo, false);
+				}catch (PageNotPinnedException e) {}
+				pageNo = nextPageNo;
+				bufMgr->readPage(file, pageNo, page);
+				overflow = (PostingOverflowPage *) page;
+			}
+
+			if(ridValue(rid) >= overflow->lastRid){
+				//The longest varint of a distance is 10 bytes
+				std::string bytes;
+				if(overflow->length + 10 <= POSTINGOVERFLOWSIZE){
+					overflow->lastRid = appendRids(bytes, &rid, 1, overflow->lastRid);
+					memcpy(overflow->bytes + overflow->length, bytes.data(), bytes.size());
+					overflow->length += bytes.size();
+					overflow->numRids++;
+				}else{
+					PageId newPageNo;
+					Page* newPage;
+					bufMgr->allocPage(file, newPageNo, newPage);
+					PostingOverflowPage *next = (PostingOverflowPage *) newPage;
+					next->nextPageNo = 0;
+					next->lastRid = appendRids(bytes, &rid, 1, 0);
+					memcpy(next->bytes, bytes.data(), bytes.size());
+					next->length = bytes.size();
+					next->numRids = 1;
+					overflow->nextPageNo = newPageNo;
+					try{
+						bufMgr->unPinPage(file, newPageNo, true);
+					}catch (PageNotPinnedException e) {}
+				}
+				try{
+					bufMgr->unPinPage(file, pageNo, true);
+				}catch (PageNotPinnedException e) {}
+				list.numRids++;
+				return;
+			}
+			try{
+				bufMgr->unPinPage(file, pageNo, false);
+			}catch (PageNotPinnedException e) {}
+		}
+
+		std::vector<RecordId> rids;
+		readPostingList(list, rids);
+		rids.insert(std::upper_bound(rids.begin(), rids.end(), rid, ridLess), rid);
+		setPostingList(list, rids);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::writeOverflowPages
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::writeOverflowPages(PostingList& list, const std::vector<RecordId>& rids)
+	{
+		std::vector<PageId> pageNos;
+		for(PageId pageNo = list.overflowPageNo; pageNo != 0;){
+			Page* page;
+			bufMgr->readPage(file, pageNo, page);
+			pageNos.push_back(pageNo);
+			PageId nextPageNo = ((PostingOverflowPage *) page)->nextPageNo;
+			try{
+				bufMgr->unPinPage(file, pageNo, false);
+			}catch (PageNotPinnedException e) {}
+			pageNo = nextPageNo;
+		}
+
+		//Fill each page, leaving room for the longest varint
+		list.overflowPageNo = 0;
+		size_t pos = 0, numPages = 0;
+		PageId prevPageNo = 0;
+		PostingOverflowPage *prev = NULL;
+		while(pos < rids.size()){
+			PageId pageNo;
+			Page* page;
+			if(numPages < pageNos.size()){
+				pageNo = pageNos[numPages];
+				bufMgr->readPage(file, pageNo, page);
+			}
+			else
+				bufMgr->allocPage(file, pageNo, page);
+			numPages++;
+
+			PostingOverflowPage *overflow = (PostingOverflowPage *) page;
+			std::string bytes;
+			unsigned long long previous = 0;
+			int count = 0;
+			for(; pos < rids.size() && bytes.size() + 10 <= (size_t) POSTINGOVERFLOWSIZE; pos++, count++)
+				previous = appendRids(bytes, &rids[pos], 1, previous);
+			overflow->nextPageNo = 0;
+			overflow->numRids = count;
+			overflow->length = bytes.size();
+			overflow->lastRid = previous;
+			memcpy(overflow->bytes, bytes.data(), bytes.size());
+
+			if(prev != NULL){
+				prev->nextPageNo = pageNo;
+				try{
+					bufMgr->unPinPage(file, prevPageNo, true);
+				}catch (PageNotPinnedException e) {}
+			}
+			else
+				list.overflowPageNo = pageNo;
+			prev = overflow;
+			prevPageNo = pageNo;
+		}
+		if(prev != NULL){
+			try{
+				bufMgr->unPinPage(file, prevPageNo, true);
+			}catch (PageNotPinnedException e) {}
+		}
+
+		for(; numPages < pageNos.size(); numPages++){
+			Page* page;
+			bufMgr->readPage(file, pageNos[numPages], page);
+			bufMgr->disposePage(file, pageNos[numPages]);
+		}
+		list.numRids = rids.size();
+		list.bytes.clear();
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::freeOverflowPages
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::freeOverflowPages(PageId pageNo)
+	{
+		while(pageNo != 0){
+			Page* page;
+			bufMgr->readPage(file, pageNo, page);
+			PageId nextPageNo = ((PostingOverflowPage *) page)->nextPageNo;
+			bufMgr->disposePage(file, pageNo);
+			pageNo = nextPageNo;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertEntryBuffered
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::insertEntryBuffered(const void *key, const RecordId rid)
+	{
+		BufferedMessage message;
+		readKey(key, message.key, keySize);
+		message.rid = rid;
+
+		Page* page;
+		bufMgr->readPage(file, rootPageNum, page);
+		BufferedNonLeafNode *root = (BufferedNonLeafNode *) page;
+
+		//Empty tree, the first leaf holds the entry
+		if(root->pageNoArray[0] == 0){
+			PageId leafPageId;
+			Page* leafPage;
+			bufMgr->allocPage(file, leafPageId, leafPage);
+			LeafNode<int> *leaf = (LeafNode<int> *) leafPage;
+			leaf->numKeys = 1;
+			leaf->keyArray[0] = message.key;
+			leaf->ridArray[0] = rid;
+			leaf->rightSibPageNo = 0;
+			leaf->leftSibPageNo = 0;
+			root->pageNoArray[0] = leafPageId;
+			rightmostLeafPageNum = leafPageId;
+			try{
+				bufMgr->unPinPage(file, leafPageId, true);
+			}catch (PageNotPinnedException e) {}
+			try{
+				bufMgr->unPinPage(file, rootPageNum, true);
+			}catch (PageNotPinnedException e) {}
+			bloomFilterAdd(keyHash(message.key));
+			return;
+		}
+
+		//Most inserts only append to the buffer of the root
+		if(root->numMessages < BUFFERSIZE){
+			root->messages[root->numMessages++] = message;
+			try{
+				bufMgr->unPinPage(file, rootPageNum, true);
+			}catch (PageNotPinnedException e) {}
+		}
+		else{
+			int level = root->level;
+			std::vector<PageKeyPair<int> > splits;
+			bufferMessages(rootPageNum, page, std::vector<BufferedMessage>(1, message), splits);
+			try{
+				bufMgr->unPinPage(file, rootPageNum, true);
+			}catch (PageNotPinnedException e) {}
+			if(!splits.empty())
+				growBufferedRoot(level, splits);
+		}
+		bloomFilterAdd(keyHash(message.key));
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bufferMessages
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::bufferMessages(PageId pageId, Page* page, const std::vector<BufferedMessage>& incoming,
+			std::vector<PageKeyPair<int> >& splits)
+	{
+		BufferedNonLeafNode *node = (BufferedNonLeafNode *) page;
+		int level = node->level;
+		std::vector<int> keys(node->keyArray, node->keyArray + node->numKeys);
+		std::vector<PageId> children(node->pageNoArray, node->pageNoArray + node->numKeys + 1);
+		std::vector<BufferedMessage> messages(node->messages, node->messages + node->numMessages);
+		messages.insert(messages.end(), incoming.begin(), incoming.end());
+		bool changed = !incoming.empty();
+
+		//An overfull buffer sends the largest batch down, one child at a time
+		while(messages.size() > (size_t) BUFFERSIZE){
+			std::vector<int> counts(children.size(), 0);
+			for(size_t i = 0; i < messages.size(); i++)
+				counts[messageChild(keys, messages[i])]++;
+			int c = std::max_element(counts.begin(), counts.end()) - counts.begin();
+			std::vector<BufferedMessage> batch;
+			takeMessages(keys, c, c, messages, batch);
+			pushToChild(level, keys, children, c, batch);
+			changed = true;
+		}
+
+		if(changed)
+			storeBufferedNode(pageId, node, keys, children, messages, splits);
+		return changed;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::pushToChild
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::pushToChild(int level, std::vector<int>& keys, std::vector<PageId>& children, int c,
+			const std::vector<BufferedMessage>& batch)
+	{
+		std::vector<PageKeyPair<int> > splits;
+		PageId childPageId = children[c];
+		if(level == 1){
+			if(batch.empty())
+				return false;
+			applyToLeaf(childPageId, batch, splits);
+		}
+		else{
+			Page* page;
+			bufMgr->readPage(file, childPageId, page);
+			bool childChanged = bufferMessages(childPageId, page, batch, splits);
+			try{
+				bufMgr->unPinPage(file, childPageId, childChanged);
+			}catch (PageNotPinnedException e) {}
+		}
+
+		//The nodes split off follow the child
+		for(size_t i = 0; i < splits.size(); i++){
+			keys.insert(keys.begin() + c + i, splits[i].key);
+			children.insert(children.begin() + c + 1 + i, splits[i].pageNo);
+		}
+		return !splits.empty();
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::applyToLeaf
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::applyToLeaf(PageId pageId, std::vector<BufferedMessage> batch, std::vector<PageKeyPair<int> >& splits)
+	{
+		Page* page;
+		bufMgr->readPage(file, pageId, page);
+		LeafNode<int> *leaf = (LeafNode<int> *) page;
+
+		//Merge the batch in, the entries of the leaf before the inserts of an equal key
+		std::stable_sort(batch.begin(), batch.end(), messageLess);
+		std::vector<RIDKeyPair<int> > entries;
+		entries.reserve(leaf->numKeys + batch.size());
+		size_t j = 0;
+		for(int i = 0; i <= leaf->numKeys; i++){
+			for(; j < batch.size() && (i == leaf->numKeys || batch[j].key < leaf->keyArray[i]); j++){
+				RIDKeyPair<int> pair;
+				pair.set(batch[j].rid, batch[j].key);
+				entries.push_back(pair);
+			}
+			if(i < leaf->numKeys){
+				RIDKeyPair<int> pair;
+				pair.set(leaf->ridArray[i], leaf->keyArray[i]);
+				entries.push_back(pair);
+			}
+		}
+
+		//Divide the entries evenly over as few leaves as hold them, the new ones to the right
+		int total = entries.size();
+		int numLeaves = (total + leafArraySize<int>() - 1) / leafArraySize<int>();
+		PageId rightSibPageNo = leaf->rightSibPageNo;
+		int highKey = leaf->highKey;
+		PageId prevPageId = pageId;
+		LeafNode<int> *prevLeaf = leaf;
+		for(int n = 0; n < numLeaves; n++){
+			int begin = (long long) total * n / numLeaves;
+			int end = (long long) total * (n + 1) / numLeaves;
+			PageId currPageId = pageId;
+			LeafNode<int> *currLeaf = leaf;
+			if(n > 0){
+				Page* newPage;
+				bufMgr->allocPage(file, currPageId, newPage);
+				currLeaf = (LeafNode<int> *) newPage;
+				currLeaf->leftSibPageNo = prevPageId;
+				prevLeaf->rightSibPageNo = currPageId;
+				prevLeaf->highKey = entries[begin].key;
+				if(prevLeaf != leaf){
+					try{
+						bufMgr->unPinPage(file, prevPageId, true);
+					}catch (PageNotPinnedException e) {}
+				}
+				PageKeyPair<int> split;
+				split.set(currPageId, entries[begin].key);
+				splits.push_back(split);
+			}
+			for(int i = begin; i < end; i++){
+				currLeaf->keyArray[i - begin] = entries[i].key;
+				currLeaf->ridArray[i - begin] = entries[i].rid;
+			}
+			currLeaf->numKeys = end - begin;
+			prevPageId = currPageId;
+			prevLeaf = currLeaf;
+		}
+		prevLeaf->rightSibPageNo = rightSibPageNo;
+		prevLeaf->highKey = highKey;
+		if(prevLeaf != leaf){
+			try{
+				bufMgr->unPinPage(file, prevPageId, true);
+			}catch (PageNotPinnedException e) {}
+			if(rightSibPageNo != 0){
+				Page* sibPage;
+				bufMgr->readPage(file, rightSibPageNo, sibPage);
+				((LeafNode<int> *) sibPage)->leftSibPageNo = prevPageId;
+				try{
+					bufMgr->unPinPage(file, rightSibPageNo, true);
+				}catch (PageNotPinnedException e) {}
+			}
+			else
+				rightmostLeafPageNum = prevPageId;
+		}
+		try{
+			bufMgr->unPinPage(file, pageId, true);
+		}catch (PageNotPinnedException e) {}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::storeBufferedNode
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::storeBufferedNode(PageId pageId, BufferedNonLeafNode* node, const std::vector<int>& keys,
+			const std::vector<PageId>& children, const std::vector<BufferedMessage>& messages, std::vector<PageKeyPair<int> >& splits)
+	{
+		//Children [begin, end) of part n go to one node, key begin - 1 separates it from the part before
+		int numChildren = children.size();
+		int numParts = (numChildren + BUFFEREDNONLEAFSIZE) / (BUFFEREDNONLEAFSIZE + 1);
+		std::vector<PageId> pageIds(1, pageId);
+		std::vector<BufferedNonLeafNode *> nodes(1, node);
+		for(int n = 1; n < numParts; n++){
+			PageId newPageId;
+			Page* newPage;
+			bufMgr->allocPage(file, newPageId, newPage);
+			pageIds.push_back(newPageId);
+			nodes.push_back((BufferedNonLeafNode *) newPage);
+		}
+
+		int level = node->level;
+		PageId rightSibPageNo = node->rightSibPageNo;
+		int highKey = node->highKey;
+		for(int n = 0; n < numParts; n++){
+			int begin = numChildren * n / numParts;
+			int end = numChildren * (n + 1) / numParts;
+			BufferedNonLeafNode *part = nodes[n];
+			part->level = level;
+			part->numKeys = end - begin - 1;
+			std::copy(keys.begin() + begin, keys.begin() + end - 1, part->keyArray);
+			std::copy(children.begin() + begin, children.begin() + end, part->pageNoArray);
+			part->rightSibPageNo = n + 1 < numParts ? pageIds[n + 1] : rightSibPageNo;
+			part->highKey = n + 1 < numParts ? keys[end - 1] : highKey;
+			part->numMessages = 0;
+			for(size_t i = 0; i < messages.size(); i++){
+				int c = messageChild(keys, messages[i]);
+				if(c >= begin && c < end)
+					part->messages[part->numMessages++] = messages[i];
+			}
+
+			//The first part is the node itself, which the caller releases
+			if(n > 0){
+				PageKeyPair<int> split;
+				split.set(pageIds[n], keys[begin - 1]);
+				splits.push_back(split);
+				try{
+					bufMgr->unPinPage(file, pageIds[n], true);
+				}catch (PageNotPinnedException e) {}
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::growBufferedRoot
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::growBufferedRoot(int level, const std::vector<PageKeyPair<int> >& splits)
+	{
+		std::vector<int> keys;
+		std::vector<PageId> children(1, rootPageNum);
+		for(size_t i = 0; i < splits.size(); i++){
+			keys.push_back(splits[i].key);
+			children.push_back(splits[i].pageNo);
+		}
+
+		PageId newRootPageNum;
+		Page* page;
+		bufMgr->allocPage(file, newRootPageNum, page);
+		BufferedNonLeafNode *root = (BufferedNonLeafNode *) page;
+		root->level = level + 1;
+		root->rightSibPageNo = 0;
+
+		//A root with too many children splits in turn
+		std::vector<PageKeyPair<int> > rootSplits;
+		storeBufferedNode(newRootPageNum, root, keys, children, std::vector<BufferedMessage>(), rootSplits);
+		rootPageNum = newRootPageNum;
+		try{
+			bufMgr->unPinPage(file, newRootPageNum, true);
+		}catch (PageNotPinnedException e) {}
+		if(!rootSplits.empty())
+			growBufferedRoot(level + 1, rootSplits);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bufferedRange
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::bufferedRange(PageId pageId, int low, int high, std::vector<BufferedMessage>& messages)
+	{
+		Page* page;
+		bufMgr->readPage(file, pageId, page);
+		BufferedNonLeafNode *node = (BufferedNonLeafNode *) page;
+		for(int i = 0; i < node->numMessages; i++){
+			if(low <= node->messages[i].key && node->messages[i].key <= high)
+				messages.push_back(node->messages[i]);
+		}
+
+		//Above level 1 a child may hold inserts of the range even if this node has none
+		std::vector<PageId> children;
+		if(node->level > 1){
+			for(int c = childIndex(node, low); c <= childIndex(node, high); c++)
+				children.push_back(childPageNo(node, c));
+		}
+		try{
+			bufMgr->unPinPage(file, pageId, false);
+		}catch (PageNotPinnedException e) {}
+		for(size_t c = 0; c < children.size(); c++)
+			bufferedRange(children[c], low, high, messages);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bufferedLeaf
+	// -----------------------------------------------------------------------------
+
+	PageId BTreeIndex::bufferedLeaf(int key, bool upper)
+	{
+		PageId pageId = rootPageNum;
+		while(1){
+			Page* page;
+			bufMgr->readPage(file, pageId, page);
+			BufferedNonLeafNode *node = (BufferedNonLeafNode *) page;
+			PageId childPageId = childPageNo(node, upper ? childIndex(node, key) : firstChildIndex(node, key));
+			bool leafLevel = node->level == 1;
+			try{
+				bufMgr->unPinPage(file, pageId, false);
+			}catch (PageNotPinnedException e) {}
+			if(leafLevel)
+				return childPageId;
+			pageId = childPageId;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookupBuffered
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::lookupBuffered(const void *key, std::vector<RecordId>& outRids)
+	{
+		int keyVal;
+		readKey(key, keyVal, keySize);
+		if(!bloomFilterMayContain(keyHash(keyVal))){
+			bloomFilterSkips++;
+			return false;
+		}
+
+		//The entries in the leaves, from the leftmost leaf that can hold the key
+		size_t numFound = outRids.size();
+		PageId pageNum = bufferedLeaf(keyVal, false);
+		if(pageNum == 0)
+			return false;
+		while(1){
+			Page* page;
+			bufMgr->readPage(file, pageNum, page);
+			LeafNode<int> *leaf = (LeafNode<int> *) page;
+			int pos = leafLowerBound(leaf, keyVal);
+			for(; pos < leaf->numKeys && leaf->keyArray[pos] == keyVal; pos++)
+				outRids.push_back(leaf->ridArray[pos]);
+			PageId rightPageNum = pos < leaf->numKeys ? 0 : leaf->rightSibPageNo;
+			try{
+				bufMgr->unPinPage(file, pageNum, false);
+			}catch (PageNotPinnedException e) {}
+			if(rightPageNum == 0)
+				break;
+			pageNum = rightPageNum;
+		}
+
+		//Then the inserts still buffered on the path of the key
+		PageId pageId = rootPageNum;
+		while(1){
+			Page* page;
+			bufMgr->readPage(file, pageId, page);
+			BufferedNonLeafNode *node = (BufferedNonLeafNode *) page;
+			for(int i = 0; i < node->numMessages; i++){
+				if(node->messages[i].key == keyVal)
+					outRids.push_back(node->messages[i].rid);
+			}
+			PageId childPageId = childPageNo(node, childIndex(node, keyVal));
+			bool leafLevel = node->level == 1;
+			try{
+				bufMgr->unPinPage(file, pageId, false);
+			}catch (PageNotPinnedException e) {}
+			if(leafLevel)
+				break;
+			pageId = childPageId;
+		}
+		return outRids.size() > numFound;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteEntryBuffered
+	// -----------------------------------------------------------------------------
+
+	bool BTreeIndex::deleteEntryBuffered(const void *key, const RecordId rid)
+	{
+		int keyVal;
+		readKey(key, keyVal, keySize);
+
+		//An insert still on the path of the key is taken back
+		PageId pageId = rootPageNum;
+		while(1){
+			Page* page;
+			bufMgr->readPage(file, pageId, page);
+			BufferedNonLeafNode *node = (BufferedNonLeafNode *) page;
+			int pos = 0;
+			while(pos < node->numMessages && (node->messages[pos].key != keyVal || node->messages[pos].rid != rid))
+				pos++;
+			if(pos < node->numMessages){
+				std::copy(node->messages + pos + 1, node->messages + node->numMessages, node->messages + pos);
+				node->numMessages--;
+				try{
+					bufMgr->unPinPage(file, pageId, true);
+				}catch (PageNotPinnedException e) {}
+				return true;
+			}
+			PageId childPageId = childPageNo(node, childIndex(node, keyVal));
+			bool leafLevel = node->level == 1;
+			try{
+				bufMgr->unPinPage(file, pageId, false);
+			}catch (PageNotPinnedException e) {}
+			if(leafLevel)
+				break;
+			pageId = childPageId;
+		}
+
+		//Otherwise the entry is in a leaf, duplicates of the key may span several
+		PageId pageNum = bufferedLeaf(keyVal, false);
+		while(pageNum != 0){
+			Page* page;
+			bufMgr->readPage(file, pageNum, page);
+			LeafNode<int> *leaf = (LeafNode<int> *) page;
+			bool found = leafRemove(leaf, keyVal, rid);
+			bool more = !found && (leaf->numKeys == 0 || leaf->keyArray[leaf->numKeys - 1] <= keyVal);
+			PageId rightPageNum = more ? leaf->rightSibPageNo : 0;
+			try{
+				bufMgr->unPinPage(file, pageNum, found);
+			}catch (PageNotPinnedException e) {}
+			if(found)
+				return true;
+			pageNum = rightPageNum;
+		}
+		return false;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::delta
+	// -----------------------------------------------------------------------------
+
+	template <> std::multimap<int, RecordId>& BTreeIndex::delta<int>() { return deltaInt; }
+	template <> std::multimap<double, RecordId>& BTreeIndex::delta<double>() { return deltaDouble; }
+	template <> std::multimap<std::string, RecordId>& BTreeIndex::delta<std::string>() { return deltaString; }
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertEntryDelta
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::insertEntryDelta(const void *key, const RecordId rid)
+	{
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		//Goes after the entries of an equal key
+		delta<T>().insert(std::make_pair(keyVal, rid));
+		deltaBytes += deltaEntrySize(keyVal);
+		if(deltaBytes >= deltaMemory)
+			mergeDeltaOfType<T>();
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteEntryDelta
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::deleteEntryDelta(const void *key, const RecordId rid)
+	{
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		typedef typename std::multimap<T, RecordId>::iterator Iterator;
+		std::pair<Iterator, Iterator> range = delta<T>().equal_range(keyVal);
+		for(Iterator it = range.first; it != range.second; ++it){
+			if(it->second == rid){
+				delta<T>().erase(it);
+				deltaBytes -= deltaEntrySize(keyVal);
+				return true;
+			}
+		}
+		return deleteEntryOfType<T>(key, rid);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookupDelta
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	bool BTreeIndex::lookupDelta(const void *key, std::vector<RecordId>& outRids)
+	{
+		size_t numFound = outRids.size();
+		lookupOfType<T>(key, outRids);
+
+		//The Bloom filter only knows the keys merged into the tree
+		T keyVal;
+		readKey(key, keyVal, keySize);
+		typedef typename std::multimap<T, RecordId>::const_iterator Iterator;
+		std::pair<Iterator, Iterator> range = delta<T>().equal_range(keyVal);
+		for(Iterator it = range.first; it != range.second; ++it)
+			outRids.push_back(it->second);
+		return outRids.size() > numFound;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::mergeDelta
+	// -----------------------------------------------------------------------------
+
+	void BTreeIndex::mergeDelta()
+	{
+		(this->*keyOps->mergeDelta)();
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::mergeDeltaOfType
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	void BTreeIndex::mergeDeltaOfType()
+	{
+		typedef typename NodeTypes<T>::NonLeaf NonLeaf;
+		std::multimap<T, RecordId>& pairs = delta<T>();
+		if(pairs.empty())
+			return;
+
+		bool emptyTree = childPageNo((NonLeaf *) pinHotNode(rootPageNum), 0) == 0;
+		unpinHotNode(rootPageNum);
+
+		if(emptyTree){
+			//The whole batch is bulk loaded
+			std::vector<RIDKeyPair<T> > batch;
+			batch.reserve(pairs.size());
+			for(typename std::multimap<T, RecordId>::const_iterator it = pairs.begin(); it != pairs.end(); ++it){
+				RIDKeyPair<T> pair;
+				pair.set(it->second, it->first);
+				batch.push_back(pair);
+				bloomFilterAdd(keyHash(pair.key));
+			}
+			loadSortedPairs<T>(batch, 1.0);
+		}
+		else{
+			std::vector<RIDKeyPair<T> > batch;
+			batch.reserve(pairs.size());
+			for(typename std::multimap<T, RecordId>::const_iterator it = pairs.begin(); it != pairs.end(); ++it){
+				RIDKeyPair<T> pair;
+				pair.set(it->second, it->first);
+				batch.push_back(pair);
+			}
+
+			//The entries before the separator right of the leaf of the first one all go to that
+			//leaf, and are merged into it with one write
+			size_t pos = 0;
+			try{
+				while(pos < batch.size()){
+					T bound;
+					bool bounded;
+					PageId leafPageId = findLeafBound<T>(batch[pos].key, bound, bounded);
+					size_t end = pos + 1;
+					while(end < batch.size() && (!bounded || batch[end].key < bound))
+						end++;
+
+					Page* page;
+					bufMgr->readPage(file, leafPageId, page);
+					size_t merged = mergeIntoLeaf((typename NodeTypes<T>::Leaf *) page, batch, pos, end);
+					try{
+						bufMgr->unPinPage(file, leafPageId, merged > 0);
+					}catch (PageNotPinnedException e) {}
+					for(size_t i = pos; i < pos + merged; i++)
+						bloomFilterAdd(keyHash(batch[i].key));
+					pos += merged;
+
+					//A full leaf is split by the insert of the next entry, the rest of the group then
+					//goes to the two halves
+					if(pos < end){
+						insertEntryOfType<T>(keyPointer(batch[pos].key), batch[pos].rid);
+						pos++;
+					}
+				}
+			}
+			catch(...){
+				//Only the entries not yet in the tree stay in the delta, in the order of batch
+				typename std::multimap<T, RecordId>::iterator it = pairs.begin();
+				for(size_t i = 0; i < pos; i++){
+					deltaBytes -= deltaEntrySize(it->first);
+					pairs.erase(it++);
+				}
+				throw;
+			}
+		}
+		pairs.clear();
+		deltaBytes = 0;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::checkFull
+	// check whether the current node is full 
+	// @param newChildId: the PageId of the newly created child.
+	// @param newKey: the push up Key of the child, which will be the first key
+	// 	  of the new Root
+	// @return: the index of avaliable spot 
+	// -----------------------------------------------------------------------------
+	template <class T>
+	void BTreeIndex::createNewRoot(PageId newChildId, T& newKey){
+		std::cout<<"New Root Created"<<std::endl;
+
+		//Alloc space for the new root
+		PageId newRootId, oldRootPageNum;
+		Page *page;
+		Page *oldRootPage;
+		bufMgr->allocPage(file, newRootId, page);
+		bufMgr->readPage(file, rootPageNum, oldRootPage);
+		NonLeafNode<T> *oldRoot = (NonLeafNode<T> *) oldRootPage;
+		NonLeafNode<T>* newRoot = (NonLeafNode<T> *) page;
+
+		// the parent of leaves will be level 1, upper level will be 2,3,4...
+		newRoot->level = oldRoot->level + 1 ;
+
+		//Setup newRoot
+		newRoot->numKeys = 1;
+		newRoot->rightSibPageNo = 0;
+		newRoot->keyArray[0] = newKey;
+		newRoot->pageNoArray[0] = rootPageNum;
+		newRoot->pageNoArray[1] = newChildId;
+		indexSeparators(newRoot);
+		oldRootPageNum = rootPageNum;
+		rootPageNum = newRootId;
+
+		//Release both pages
+		try{
+			bufMgr->unPinPage(file, newRootId, true);
+			bufMgr->unPinPage(file, oldRootPageNum, true);
+		}
+		catch (PageNotPinnedException e) {}	
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::checkFull
+	// check whether the current leaf node is full 
+	// @return: the index of avaliable spot 
+	// -----------------------------------------------------------------------------
+	template <class T>
+	int BTreeIndex::leafCheckFull(LeafNode<T> *node)
+	{
+		return node->numKeys;
+	}
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::checkFull
+	// check whether the current nonLeaf node is full 
+	// @return: the index of avaliable spot 
+	// -----------------------------------------------------------------------------
+	template <class T>
+	int BTreeIndex:: nonLeafCheckFull(NonLeafNode<T> *node){
+		return node->numKeys;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::initLeaf
+	// Create the very first leaf in the current B+ tree
+	// @param pair: <key, rid> pair to be added to the first leaf
+	// @param node: parent node
+	// @param pageId: the pageNo of the parent node
+	// -----------------------------------------------------------------------------
+	template <class T>
+	void BTreeIndex::initLeaf(RIDKeyPair<T> pair,NonLeafNode<T>* node, PageId pageId)
+	{
+		PageId newPageId;
+		Page* newPage;
+
+		//Alloc new memory space for the new leaf
+		bufMgr->allocPage(file, newPageId, newPage);
+		LeafNode<T> *leaf = (LeafNode<T> *) newPage;
+
+		//Init values
+		leaf->numKeys = 1;
+		leaf->keyArray[0] = pair.key;
+		leaf->ridArray[0] = pair.rid;
+
+		//Set sigbling = 0 since it is the first leafAdded to the B+tree;
+		leaf->rightSibPageNo = 0;
+		leaf->leftSibPageNo = 0;
+
+		//Set up values in the parent node
+		node->pageNoArray[0] = newPageId;
+		rightmostLeafPageNum = newPageId;
+
+		//releas the temp page
+		try{
+			bufMgr->unPinPage(file, newPageId, true);
+			//Parent node should also be unpinned since the recursive call will return after initLeaf()
+			if(concurrent)
+				bufMgr->unPinPage(file, pageId, true, LATCH_EXCLUSIVE);
+		}
+		catch (PageNotPinnedException e) {}		
+		if(!concurrent)
+			unpinHotNode(pageId, true);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::leafSplit
+	// Split the leafNode and return the newly created pageId and key
+	// @param pair: the <key, rid> pair that will be added to the B+ tree
+	// @param node: the current node that will be split
+	// @param newPushedUpKey:  return value for adding new key toparent KeyArraykey
+	// @param newSplitPageId:  return value for adding new page parent PageNoArray
+	// @param targetPos:	   Posiion in the current that will add the new key
+	// @param pageId:	   the pageNo of the current node, for the sibling links
+	// -----------------------------------------------------------------------------
+	template <class T>
+	void BTreeIndex::leafSplit(RIDKeyPair<T> pair, 
+			LeafNode<T>* node,
+			PageId pageId,		 //pageNo of the current node
+			T& newPushedUpKey,	 //return value for adding new key toparent KeyArraykey
+			PageId& newSplitPageId,  //return value for adding new page parent PageNoArray
+			int targetPos		 //Posiion in the current that will add the new key
+			){
+		Page* newLeafPage;
+		bufMgr->allocPage(file, newSplitPageId, newLeafPage);
+		LeafNode<T> *newLeaf = (LeafNode<T> *) newLeafPage;		
+
+		//The full node plus the new entry hold leafArraySize<T>() + 1 entries,
+		//the first midVal of them stay in the current node
+		int midVal = splitPoint(leafArraySize<T>() + 1, targetPos == leafArraySize<T>(), leafArraySize<T>());
+		if(targetPos < midVal){
+			//Move the upper half over, then make room for the new entry on the left
+			for(int i = midVal - 1; i < leafArraySize<T>(); i++){
+				newLeaf->keyArray[i - midVal + 1] = node->keyArray[i];
+				newLeaf->ridArray[i - midVal + 1] = node->ridArray[i];
+			}
+			for(int i = midVal - 1; i > targetPos; i--){
+				node->keyArray[i] = node->keyArray[i - 1];
+				node->ridArray[i] = node->ridArray[i - 1];
+			}
+			node->keyArray[targetPos] = pair.key;
+			node->ridArray[targetPos] = pair.rid;
+		}
+		else{
+			//Move the upper half over, placing the new entry on the way
+			int j = 0;
+			for(int i = midVal; i < leafArraySize<T>(); i++){
+				if(i == targetPos){
+					newLeaf->keyArray[j] = pair.key;
+					newLeaf->ridArray[j++] = pair.rid;
+				}
+				newLeaf->keyArray[j] = node->keyArray[i];
+				newLeaf->ridArray[j++] = node->ridArray[i];
+			}
+			if(targetPos == leafArraySize<T>()){
+				newLeaf->keyArray[j] = pair.key;
+				newLeaf->ridArray[j] = pair.rid;
+			}
+		}
+		node->numKeys = midVal;
+		newLeaf->numKeys = leafArraySize<T>() + 1 - midVal;
+
+		//Setup return Value	
+		newPushedUpKey = newLeaf->keyArray[0];		
+
+		//Setup sibling (insert), the new leaf takes over the right link and the high key
+		PageId rightSibPageNo = node->rightSibPageNo;
+		newLeaf->rightSibPageNo = rightSibPageNo;
+		newLeaf->leftSibPageNo = pageId;
+		newLeaf->highKey = node->highKey;
+		node->rightSibPageNo = newSplitPageId;
+		node->highKey = newPushedUpKey;
+		try{
+			bufMgr->unPinPage(file, newSplitPageId, true);
+		}
+		catch (PageNotPinnedException e) {}		
+
+		//The old right sibling now has the new leaf on its left
+		if(rightSibPageNo != 0){
+			LatchMode latchMode = concurrent ? LATCH_EXCLUSIVE : LATCH_NONE;
+			Page* rightPage;
+			bufMgr->readPage(file, rightSibPageNo, rightPage, latchMode);
+			((LeafNode<T> *) rightPage)->leftSibPageNo = newSplitPageId;
+			try{
+				bufMgr->unPinPage(file, rightSibPageNo, true, latchMode);
+			}
+			catch (PageNotPinnedException e) {}		
+		}
+
+
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::nonLeafSplit
+	// Split the nonLeaf with the input of its created child's key and PageId.
+	// return the newly created pageId and key
+	// @param node: the current node that will be split
+	// @param newPushedUpKey:  return value for adding new key toparent KeyArraykey
+	// @param newSplitPageId:  return value for adding new page parent PageNoArray
+	// @param targetPos:	   Posiion in the current that will add the new key
+	// @param childKey:	   Parameter that contain the new created key in the child level
+	// @PageId childPageId:	   parameter indicate the new created node in the child level
+	// -----------------------------------------------------------------------------	
+	template <class T>
+	void BTreeIndex::nonLeafSplit(
+			NonLeafNode<T>* node, 	 //Current node
+			T& newPushedUpKey,	 //return value for adding new key toparent KeyArraykey
+			PageId& newSplitPageId,  //return value for adding new page parent PageNoArray
+			int targetPos,		 //potential index to add the new key
+			T& childKey,		 //Parameter that contain the new created key in the child level
+			PageId childPageId	 //parameter indicate the new created node in the child level
+			){
+		//Temp arrays for insert and split: the keys with childKey at targetPos and the
+		//children with childPageId right after the child that was split
+		T sortedKey[nonLeafArraySize<T>() + 1];	
+		PageId sortedPageNo[nonLeafArraySize<T>() + 2];
+
+		//allocate new memory space for the new Nonleafnode
+		Page* newNonLeafPage;
+		bufMgr->allocPage(file, newSplitPageId, newNonLeafPage);
+		NonLeafNode<T> *newNonLeaf = (NonLeafNode<T> *) newNonLeafPage;	
+
+		for(int i = 0, j = 0; i < nonLeafArraySize<T>() + 1; i++){
+			if(i == targetPos)
+				sortedKey[i] = childKey;
+			else
+				sortedKey[i] = node->keyArray[j++];
+		}
+		for(int i = 0, j = 0; i < nonLeafArraySize<T>() + 2; i++){
+			if(i == targetPos + 1)
+				sortedPageNo[i] = childPageId;
+			else
+				sortedPageNo[i] = node->pageNoArray[j++];
+		}
+
+		//Redistribution: keys [0, midVal) stay, key midVal is pushed up, the rest move
+		int midVal = splitPoint(nonLeafArraySize<T>() + 1, targetPos == nonLeafArraySize<T>(), nonLeafArraySize<T>() - 1);
+		for(int i = 0; i < midVal; i++){
+			node->keyArray[i] = sortedKey[i];
+			node->pageNoArray[i] = sortedPageNo[i];
+		}
+		node->pageNoArray[midVal] = sortedPageNo[midVal];
+		node->numKeys = midVal;
+
+		for(int i = midVal + 1; i < nonLeafArraySize<T>() + 1; i++){
+			newNonLeaf->keyArray[i - 1 - midVal] = sortedKey[i]; 
+			newNonLeaf->pageNoArray[i - 1 - midVal] = sortedPageNo[i];
+		}
+		newNonLeaf->pageNoArray[nonLeafArraySize<T>() - midVal] = sortedPageNo[nonLeafArraySize<T>() + 1];
+		newNonLeaf->numKeys = nonLeafArraySize<T>() - midVal;
+		indexSeparators(node);
+		indexSeparators(newNonLeaf);
+
+		//Set up the return key for the new nonLeaf
+		newPushedUpKey = sortedKey[midVal];	//this key will be deleted from the leaf
+		newNonLeaf->level = node->level;
+
+		//The new node takes over the right link and the high key
+		newNonLeaf->rightSibPageNo = node->rightSibPageNo;
+		newNonLeaf->highKey = node->highKey;
+		node->rightSibPageNo = newSplitPageId;
+		node->highKey = newPushedUpKey;
+
+		//Release the page
+		try{
+			bufMgr->unPinPage(file,newSplitPageId, true);
+		}
+		catch (PageNotPinnedException e) {}	
+
+	}
+
+
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::startScan
+	// -----------------------------------------------------------------------------
+
+	const void BTreeIndex::startScan(const void* lowValParm,
+			const Operator lowOpParm,
+			const void* highValParm,
+			const Operator highOpParm,
+			const ScanDirection directionParm)
 	{
-		std::ostringstream idxStr;
-		idxStr << relationName << '.' << attrByteOffset;
-		outIndexName = idxStr.str();// name of the index file
-		this->bufMgr = bufMgrIn;
-		this->attrByteOffset = attrByteOffset;
-		this->attributeType = attrType;
-		scanExecuting = false;
+		scanCursor.startScan(lowValParm, lowOpParm, highValParm, highOpParm, directionParm);
+	}
 
-		leafOccupancy = 0 ;
-		nodeOccupancy = 0;
-		headerPageNum = 1;
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::findParentOfLeaf
+	// Recursive call to find the parent node that contains the leaf which has the
+	// key greater than lowVal in its keyArray
+	// @param: lowVal: the lowValInt to be searched
+	// @param  upper: descend to the last child that may hold lowVal, else to the first
+	// @param  currPage: the current Page to be handle
+	// @param  parentPageNum: return value for the pageNo of the returned node,
+	//	   which is left pinned
+	// @return: the child node that contains or its children contain the lowVal 
+	// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf>
+	NonLeaf* BTreeIndex::findParentOfLeaf(const T& lowVal, bool upper, PageId currPage, PageId& parentPageNum){
 
+		//Read info of the currentPae
+		NonLeaf* currNode = (NonLeaf*) pinHotNode(currPage);
 
-		// try create a file and check if it exists
-		try {
-			IndexMetaInfo* metadata;
-			//Page* page;
-			Page* metapage;
-			Page* rootpage;
+		//Handle the data
+		if(currNode->level == 1)
+		{
+			parentPageNum = currPage;
+			return currNode;
+		}
+		//Paged = childPage;
+		PageId childPage = childPageNo(currNode, upper ? childIndex(currNode, lowVal) : firstChildIndex(currNode, lowVal));
+		unpinHotNode(currPage);
 
-			//metapage
-			file = new BlobFile(outIndexName, true);
-			bufMgrIn->allocPage(file, headerPageNum, metapage);
-			metadata = (IndexMetaInfo*) metapage;
-			metadata->attrByteOffset = attrByteOffset;
-			metadata->attrType = attrType;
-			strcpy(metadata->relationName, relationName.c_str());
+		NonLeaf* retNode = findParentOfLeaf<T, NonLeaf>(lowVal, upper, childPage, parentPageNum); 
+		return retNode;	
+	}
 
-			//root page
-			bufMgrIn->allocPage(file, rootPageNum, rootpage);
-			metadata->rootPageNo = rootPageNum;
-			std::cout<<"RootPageNo = "<<rootPageNum<<"  headerPageNum = "<<headerPageNum<<std::endl;
-			try{
-				bufMgrIn->unPinPage(file, headerPageNum, true);
-			} catch (PageNotPinnedException e) {
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::findLeaf
+	// Find the leaf the scan for lowVal starts on. No page is left pinned.
+	// @param: lowVal: the lowValInt to be searched
+	// @param: upper: true for the last leaf that may hold lowVal, false for the first.
+	//	   Splits leave copies of a separator in the leaf left of it, so a scan
+	//	   that starts at lowVal with GTE needs the first one.
+	// @return: the pageNo of the leaf, 0 if the tree is empty
+	// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf>
+	PageId BTreeIndex::findLeaf(const T& lowVal, bool upper)
+	{
+		PageId parentPageNum;
+		NonLeaf * currNode = findParentOfLeaf<T, NonLeaf>(lowVal, upper, rootPageNum, parentPageNum);	
+		PageId leafPageNum = childPageNo(currNode, upper ? childIndex(currNode, lowVal) : firstChildIndex(currNode, lowVal));
+		unpinHotNode(parentPageNum);
+		return leafPageNum;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::findLeafBound
+	// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf>
+	PageId BTreeIndex::findLeafBound(const T& key, T& bound, bool& bounded)
+	{
+		//The separators right of the path get smaller on the way down
+		bounded = false;
+		PageId pageId = rootPageNum;
+		while(1){
+			NonLeaf* node = (NonLeaf *) pinHotNode(pageId);
+			int slot = childIndex(node, key);
+			if(slot < node->numKeys){
+				bound = separatorAt(node, slot);
+				bounded = true;
 			}
+			PageId childPageId = childPageNo(node, slot);
+			bool leafLevel = node->level == 1;
+			unpinHotNode(pageId);
+			if(leafLevel)
+				return childPageId;
+			pageId = childPageId;
+		}
+	}
 
-			//initialize root
-			NonLeafNodeInt *root = (NonLeafNodeInt *) rootpage;
-			for(int i = 0; i<INTARRAYNONLEAFSIZE + 1; i++) 
-				root->pageNoArray[i] = 0;
-			for(int i = 0; i<INTARRAYNONLEAFSIZE; i++) 
-				root->keyArray[i] = 0;
-			root->level = 1;
-			//INTARRAYLEAFSIZE, INTARRAYNONLEAFSIZE//
-			std::cout<<"INTARRAYLEAFSIZE:"<<INTARRAYLEAFSIZE<<std::endl;
-			std::cout<<"INTARRAYNONLEAFSIZE:"<<INTARRAYNONLEAFSIZE<<std::endl;
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::pinHotNode
+	// -----------------------------------------------------------------------------
+
+	Page* BTreeIndex::pinHotNode(PageId pageNo)
+	{
+		hotNodeLatch.lockShared();
+		std::map<PageId, Page*>::iterator it = hotNodes.find(pageNo);
+		Page* page = it != hotNodes.end() ? it->second : NULL;
+		hotNodeLatch.unlockShared();
+		if(page != NULL){
+			hotNodeHits++;
+			return page;
+		}
 
+		//The page is read without the latch, so that a read from disk holds up no other descent
+		bufMgr->readPage(file, pageNo, page);
+		hotNodeLatch.lockExclusive();
+		if(hotNodes.count(pageNo) > 0){
+			//Another descent made the node hot meanwhile, its pin is the one that stays
+			hotNodeLatch.unlockExclusive();
+			hotNodeHits++;
 			try{
-				bufMgrIn->unPinPage(file, rootPageNum, true);
+				bufMgr->unPinPage(file, pageNo, false);
 			}catch (PageNotPinnedException e) {}
-			//scan records
-			try{		
-				FileScan fscan(relationName, bufMgr);
-				RecordId scanRid;
-				while(1) {	
-					fscan.scanNext(scanRid);
-					insertEntry((int *) fscan.getRecord().c_str() + attrByteOffset, scanRid);
-				}
-			} catch (EndOfFileException e){ }
+			return page;
 		}
-		// file exists, just open it
-		catch (FileExistsException e){
-			this->file = new BlobFile(outIndexName, false);
-			Page* metapage;
-			//headerPageNum = 1;
-			bufMgrIn->readPage(file, headerPageNum, metapage);
-			IndexMetaInfo* metadata = (IndexMetaInfo*) metapage;
-			if(metadata->attrType != attrType ||strcmp(metadata->relationName, relationName.c_str()) != 0
-					|| metadata->attrByteOffset != attrByteOffset ){
-				try {
-					bufMgrIn->unPinPage(file, headerPageNum, false);
-				} catch (PageNotPinnedException e ){}
-				throw BadIndexInfoException("ERROR: MetaData does not match");
-			}
-			//Metadata matches
-			this->rootPageNum = metadata->rootPageNo;
 
-			try {
-				bufMgrIn->unPinPage(file, headerPageNum, false);
-			} catch (PageNotPinnedException e ){}
+		//The pin taken here stays with the node until the destructor
+		if(!hotNodesFull && bufMgr->reserveFrame(bufMgr->getNumBufs() * HOTNODEFRACTION)){
+			hotNodeMisses++;
+			hotNodes[pageNo] = page;
 		}
-		catch (EndOfFileException e){}
+		else{
+			hotNodeCapMisses++;
+			hotNodesFull = true;
+		}
+		hotNodeLatch.unlockExclusive();
+		return page;
+	}
 
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::unpinHotNode
+	// -----------------------------------------------------------------------------
 
+	void BTreeIndex::unpinHotNode(PageId pageNo, bool dirty)
+	{
+		hotNodeLatch.lockShared();
+		bool hot = hotNodes.count(pageNo) > 0;
+		hotNodeLatch.unlockShared();
+		if(hot){
+			if(dirty){
+				hotNodeLatch.lockExclusive();
+				dirtyHotNodes.insert(pageNo);
+				hotNodeLatch.unlockExclusive();
+			}
+			return;
+		}
+		try{
+			bufMgr->unPinPage(file, pageNo, dirty);
+		}catch (PageNotPinnedException e) {}
 	}
 
-
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::~BTreeIndex -- destructor
+	// BTreeIndex::dropHotNode
 	// -----------------------------------------------------------------------------
 
-	BTreeIndex::~BTreeIndex()
+	void BTreeIndex::dropHotNode(PageId pageNo)
 	{
+		hotNodeLatch.lockExclusive();
+		if(hotNodes.erase(pageNo) > 0)
+			bufMgr->releaseFrames(1);
+		dirtyHotNodes.erase(pageNo);
+		hotNodeLatch.unlockExclusive();
+	}
 
-		scanExecuting = false;
-		try {
-			bufMgr->unPinPage(file, currentPageNum, false);
-		} 
-		catch (HashNotFoundException e) {} 
-		catch (PageNotPinnedException e) {}
-
-		//bufMgr->printSelf();
-		bufMgr->flushFile(file);
-		file->~File();
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::tryScanNext
+	// -----------------------------------------------------------------------------
 
+	bool BTreeIndex::tryScanNext(RecordId& outRid) 
+	{
+		return scanCursor.tryScanNext(outRid);
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::findAndInsert
-	// Recursive method to traverse down the B+tree to insert the given <key, rid> pair
-	// check whether the current leaf node is full 
-	// @return: the index of avaliable spot 
+	// BTreeIndex::scanNext
 	// -----------------------------------------------------------------------------
-	void BTreeIndex::findAndInsert(RIDKeyPair<int> pair,
-			PageId pageId, 
-			bool isLeaf,
-			int & newPushedUpKey,	//Return value used in split function
-			PageId& newSplitPageId	//Return value used in split function
-			){
-		//Handle non-leaf nodes
-		if(!isLeaf){
-
-			//Get info from the given pageId and store in a temp page
-			Page* page;
-			bufMgr->readPage(file, pageId, page);
-			NonLeafNodeInt *node = (NonLeafNodeInt *) page;
 
-			//Find Appropriate position to insert
-			int targetPos = 0;
+	const void BTreeIndex::scanNext(RecordId& outRid) 
+	{
+		scanCursor.scanNext(outRid);
+	}
 
-			for(targetPos = 0; targetPos < INTARRAYNONLEAFSIZE; targetPos++)
-				if(pair.key < node->keyArray[targetPos] || node->pageNoArray[targetPos + 1] == 0)
-					break;
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::scanNextBatch
+	// -----------------------------------------------------------------------------
 
+	size_t BTreeIndex::scanNextBatch(RecordId* outRids, size_t maxRids)
+	{
+		return scanCursor.scanNextBatch(outRids, maxRids);
+	}
 
-			// both PageNoArray Entry on the left and right of the 
-			// target key are empty --> The node does not have any valid key.
-			// So initLeaf() will create a new leaf in the current B+ tree index
-			if(node->pageNoArray[targetPos] == 0){
-				std::cout<<"Init newLeaf"<<std::endl;
-				initLeaf(pair,node, pageId);	
-				return;
-			}
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::endScan
+	// -----------------------------------------------------------------------------
+	//
+	const void BTreeIndex::endScan() 
+	{
+		scanCursor.endScan();
+	}
 
-			// unpin the temp page
-			try{
-				bufMgr->unPinPage(file, pageId, false);		
-			}catch (PageNotPinnedException e) {}
-			//FindAndInsert in the child node
-			PageId newChildPageId = 0;	//change if child get split
-			int newChildKey;		//store the new pushed up key value if split happens
-			findAndInsert(pair, node->pageNoArray[targetPos], node->level == 1, newChildKey, newChildPageId);
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::parallelScan
+	// -----------------------------------------------------------------------------
 
+	size_t BTreeIndex::parallelScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			int numThreads, const ScanBatchCallback& callback)
+	{
+		if((lowOp != GT && lowOp != GTE)||(highOp != LT && highOp != LTE))
+			throw BadOpcodesException();
+		return (this->*keyOps->parallelScan)(lowVal, lowOp, highVal, highOp, std::max(numThreads, 1), callback);
+	}
 
-			//Check whether the array is full
-			if(newChildPageId != 0){			
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::parallelScanOfType
+	// -----------------------------------------------------------------------------
 
-				//get the page again for spliting
-				bufMgr->readPage(file, pageId, page);
-				NonLeafNodeInt *node = (NonLeafNodeInt *) page;
+	template <class T, class NonLeaf>
+	size_t BTreeIndex::parallelScanOfType(const void* lowValParm, const Operator lowOp, const void* highValParm, const Operator highOp,
+			int numThreads, const ScanBatchCallback& callback)
+	{
+		T lowVal, highVal;
+		readKey(lowValParm, lowVal, keySize);
+		readKey(highValParm, highVal, keySize);
+		if(lowVal > highVal)
+			throw BadScanrangeException();
 
-				//check full
-				int currNodeSize = nonLeafCheckFull(node);
-				if(currNodeSize > INTARRAYNONLEAFSIZE) std::cout<<"ERROR in LEAF_CHECK_FULL"<<std::endl;
+		//Every sub-range but the last ends before a separator, the next one starts at it,
+		//so the duplicates of a separator all fall into the same sub-range
+		std::vector<T> separators, bounds;
+		rangeSeparators<T, NonLeaf>(lowVal, highVal, numThreads - 1, separators);
+		if(separators.size() < (size_t) numThreads)
+			bounds.swap(separators);
+		else{
+			for(int i = 1; i < numThreads; i++)
+				bounds.push_back(separators[i * separators.size() / numThreads]);
+		}
 
-				//IF FULL, split
-				if(currNodeSize == INTARRAYNONLEAFSIZE){
-					nonLeafSplit(node, newPushedUpKey, newSplitPageId, targetPos, newChildKey, newChildPageId);
+		int numParts = bounds.size() + 1;
+		std::vector<size_t> numRids(numParts, 0);
+		std::vector<std::thread> workers;
+		for(int part = 0; part < numParts; part++){
+			workers.push_back(std::thread([&, part]()
+			{
+				const T& low = part == 0 ? lowVal : bounds[part - 1];
+				const T& high = part == numParts - 1 ? highVal : bounds[part];
+				IndexCursor cursor(this);
+				try{
+					cursor.startScan(keyPointer(low), part == 0 ? lowOp : GTE, keyPointer(high), part == numParts - 1 ? highOp : LT);
+				}catch (NoSuchKeyFoundException e) {
+					return;
 				}
-				//Not full, shift
-				else{
-					for(int j = currNodeSize; j > targetPos; j--){
-						node->keyArray[j] = node->keyArray[j -1]; //KeyArray
-						node->pageNoArray[j + 1] = node->pageNoArray[j];//PageId
-					}
+				RecordId rids[PARALLELSCANBATCH];
+				size_t count;
+				while((count = cursor.scanNextBatch(rids, PARALLELSCANBATCH)) > 0){
+					callback(part, rids, count);
+					numRids[part] += count;
+				}
+				cursor.endScan();
+			}));
+		}
+
+		size_t total = 0;
+		for(int part = 0; part < numParts; part++){
+			workers[part].join();
+			total += numRids[part];
+		}
+		return total;
+	}
 
-					//Insert new pageID
-					node->keyArray[targetPos] = newChildKey;
-					node->pageNoArray[targetPos + 1] = newChildPageId;
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::rangeSeparators
+	// -----------------------------------------------------------------------------
 
+	template <class T, class NonLeaf>
+	void BTreeIndex::rangeSeparators(const T& low, const T& high, size_t maxSeparators, std::vector<T>& separators)
+	{
+		LatchMode latchMode = concurrent ? LATCH_SHARED : LATCH_NONE;
+		std::vector<PageId> levelPages(1, rootPageNum);
+		while(1){
+			//The children of this level whose ranges meet [low, high], and the separators between them
+			std::vector<PageId> children;
+			bool lastLevel = false;
+			for(size_t i = 0; i < levelPages.size(); i++){
+				Page* page;
+				bufMgr->readPage(file, levelPages[i], page, latchMode);
+				NonLeaf* node = (NonLeaf *) page;
+				lastLevel = node->level == 1;
+				int first = firstChildIndex(node, low);
+				int last = childIndex(node, high);
+				for(int j = first; j <= last; j++){
+					if(j > first){
+						T separator = separatorAt(node, j - 1);
+						if(low < separator && separator < high)
+							separators.push_back(separator);
+					}
+					children.push_back(childPageNo(node, j));
 				}
+				try{
+					bufMgr->unPinPage(file, levelPages[i], false, latchMode);
+				}catch (PageNotPinnedException e) {}
 			}
 
-			//Finish insert, release the temp page
-			try{
-				bufMgr->unPinPage(file, pageId, true);		
-			}catch (PageNotPinnedException e) {}
+			std::sort(separators.begin(), separators.end());
+			separators.erase(std::unique(separators.begin(), separators.end()), separators.end());
+			if(lastLevel || separators.size() >= maxSeparators)
+				return;
+			levelPages.swap(children);
 		}
+	}
 
-		//Handle LeafNodes
-		else{
-			Page* page;
-			bufMgr->readPage(file, pageId, page);
-			LeafNodeInt *node = (LeafNodeInt *) page;
-
-			//Find Appropriate position to insert
-			int targetPos;
-			for(targetPos = 0; targetPos < INTARRAYLEAFSIZE; targetPos++)
-				if(pair.key <= node->keyArray[targetPos] 
-						|| node->ridArray[targetPos].page_number ==0 )
-					break;
+	// -----------------------------------------------------------------------------
+	// IndexCursor::IndexCursor -- Constructor
+	// -----------------------------------------------------------------------------
 
-			//Find last Rid Entry
-			int currNodeSize = leafCheckFull(node);
-			if(currNodeSize > INTARRAYLEAFSIZE) std::cout<<"ERROR in LEAF_CHECK_FULL"<<std::endl;
+	IndexCursor::IndexCursor(BTreeIndex *indexIn)
+		: index(indexIn), scanExecuting(false), direction(ASCENDING)
+	{
+	}
 
-			//full, split required
-			if(currNodeSize == INTARRAYLEAFSIZE)
-				leafSplit(pair, node, newPushedUpKey, newSplitPageId, targetPos);
+	// -----------------------------------------------------------------------------
+	// IndexCursor::~IndexCursor -- destructor
+	// -----------------------------------------------------------------------------
 
-			//Not full, insert
-			else{
-				//Right shift all the element on the right of the targetPos in both arrays  
-				for(int j = currNodeSize; j > targetPos; j--){
-					node->keyArray[j] = node->keyArray[j -1]; //KeyArray
-					node->ridArray[j] = node->ridArray[j -1];//PageId
-				}
-				//Insert in target position
-				node->keyArray[targetPos] = pair.key;
-				node->ridArray[targetPos] = pair.rid;
-			}
-			try{
-				bufMgr->unPinPage(file, pageId, true);		
-			}catch (PageNotPinnedException e) {}
+	IndexCursor::~IndexCursor()
+	{
+		if(scanExecuting){
+			scanExecuting = false;
+			try {
+				index->bufMgr->unPinPage(index->file, currentPageNum, false);
+			} 
+			catch (HashNotFoundException e) {} 
+			catch (PageNotPinnedException e) {}
 		}
 	}
 
-
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::insertEntry
-	// Helper: findAndInsert()
-	// 	   createNewRoot()
+	// IndexCursor::startScan
 	// -----------------------------------------------------------------------------
 
-	const void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
+	const void IndexCursor::startScan(const void* lowValParm,
+			const Operator lowOpParm,
+			const void* highValParm,
+			const Operator highOpParm,
+			const ScanDirection directionParm)
 	{
-		//Setup the RidKeyPair
-		RIDKeyPair<int> pair;
-		pair.set(rid, *((int *) key));
-
-		PageId newPageId = 0;	//stores new PageId if split happens
-		int newChildKey; 		//stores new Key pushed up if split happens
+		//Validate scan
+		if((lowOpParm != GT && lowOpParm != GTE)||(highOpParm != LT && highOpParm != LTE))					
+			throw BadOpcodesException();
+		//End the scan that is still executing, releasing its leaf
+		if(scanExecuting)
+			endScan();
+		lowOp = lowOpParm;
+		highOp = highOpParm;
+		direction = directionParm;
+		(this->*index->keyOps->startScan)(lowValParm, highValParm);
+	}
 
-		//Begin insert by calling the recursive insert:
-		findAndInsert(pair,rootPageNum,false, newChildKey, newPageId);
+	// -----------------------------------------------------------------------------
+	// IndexCursor::lowVal, IndexCursor::highVal
+	// -----------------------------------------------------------------------------
 
-		//Handle newroot split
-		if(newPageId != 0)
-			createNewRoot(newPageId,newChildKey);
-	}
+	template <> int& IndexCursor::lowVal<int>() { return lowValInt; }
+	template <> int& IndexCursor::highVal<int>() { return highValInt; }
+	template <> double& IndexCursor::lowVal<double>() { return lowValDouble; }
+	template <> double& IndexCursor::highVal<double>() { return highValDouble; }
+	template <> std::string& IndexCursor::lowVal<std::string>() { return lowValString; }
+	template <> std::string& IndexCursor::highVal<std::string>() { return highValString; }
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::checkFull
-	// check whether the current node is full 
-	// @param newChildId: the PageId of the newly created child.
-	// @param newKey: the push up Key of the child, which will be the first key
-	// 	  of the new Root
-	// @return: the index of avaliable spot 
+	// IndexCursor::startScanOfType
 	// -----------------------------------------------------------------------------
-	void BTreeIndex::createNewRoot(PageId newChildId, int& newKey){
-		std::cout<<"New Root Created"<<std::endl;
 
-		//Alloc space for the new root
-		PageId newRootId, oldRootPageNum;
-		Page *page;
-		Page *oldRootPage;
-		bufMgr->allocPage(file, newRootId, page);
-		bufMgr->readPage(file, rootPageNum, oldRootPage);
-		NonLeafNodeInt *oldRoot = (NonLeafNodeInt *) oldRootPage;
-		NonLeafNodeInt* newRoot = (NonLeafNodeInt *) page;
+	template <class T, class NonLeaf>
+	void IndexCursor::startScanOfType(const void* lowValParm, const void* highValParm)
+	{
+		//Copy the value
+		readKey(lowValParm, lowVal<T>(), index->keySize);
+		readKey(highValParm, highVal<T>(), index->keySize);
+		if(lowVal<T>() > highVal<T>())
+			throw BadScanrangeException();
 
-		// the parent of leaves will be level 1, upper level will be 2,3,4...
-		newRoot->level = oldRoot->level + 1 ;
+		//Empty tree, the root has no leaf yet
+		//A scan starting at lowVal with GTE needs the first leaf holding it
+		PageId leafPageNum = direction == ASCENDING ? index->findLeaf<T, NonLeaf>(lowVal<T>(), lowOp == GT) : index->findLeaf<T, NonLeaf>(highVal<T>(), true);
+		if(leafPageNum == 0)
+			throw NoSuchKeyFoundException();
 
-		//CLEAR the PageNoArray[]
-		for(int i = 0; i < INTARRAYNONLEAFSIZE + 1; i++){
-			newRoot->pageNoArray[i] = 0;
-		}
-		//Setup newRoot
-		newRoot->keyArray[0] = newKey;
-		newRoot->pageNoArray[0] = rootPageNum;
-		newRoot->pageNoArray[1] = newChildId;
-		oldRootPageNum = rootPageNum;
-		rootPageNum = newRootId;
+		//Set page, it stays pinned until the scan moves past it or ends
+		currentPageNum = leafPageNum;
+		index->bufMgr->readPage(index->file, currentPageNum, currentPageData);
+		setLeafSlice<T>();
+		scanExecuting = true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexCursor::setLeafSlice
+	// Compute the slice [nextEntry, lastEntry) of the current leaf that lies
+	// inside the scan range
+	// -----------------------------------------------------------------------------
+	template <class T>
+	void IndexCursor::setLeafSlice()
+	{
+		typename NodeTypes<T>::Leaf* currNode = (typename NodeTypes<T>::Leaf *)currentPageData; 	
+		if(lowOp == GTE)
+			nextEntry = leafLowerBound(currNode, lowVal<T>());
+		else
+			nextEntry = leafUpperBound(currNode, lowVal<T>());
+		if(highOp == LTE)
+			lastEntry = leafUpperBound(currNode, highVal<T>());
+		else
+			lastEntry = leafLowerBound(currNode, highVal<T>());
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexCursor::moveToNextLeaf
+	// Release the current leaf and continue the scan on its right sibling, or on
+	// its left sibling for a DESCENDING scan
+	// @return: false if the bound the scan moves towards lies in the current leaf
+	//	    or there is no sibling, the scan is completed then
+	// -----------------------------------------------------------------------------
+	template <class T>
+	bool IndexCursor::moveToNextLeaf()
+	{
+		typename NodeTypes<T>::Leaf* currNode = (typename NodeTypes<T>::Leaf *)currentPageData; 	
+		PageId nextNum;
+		if(direction == ASCENDING){
+			if(lastEntry < currNode->numKeys || currNode->rightSibPageNo == 0)
+				return false;
+			nextNum = currNode->rightSibPageNo; 	
+		}
+		else{
+			if(nextEntry > 0 || currNode->leftSibPageNo == 0)
+				return false;
+			nextNum = currNode->leftSibPageNo; 	
+		}
 
-		//Release both pages
 		try{
-			bufMgr->unPinPage(file, newRootId, true);
-			bufMgr->unPinPage(file, oldRootPageNum, true);
-		}
-		catch (PageNotPinnedException e) {}	
+			index->bufMgr->unPinPage(index->file, currentPageNum, false);
+		}catch (PageNotPinnedException e){}
+		currentPageNum = nextNum;
+		index->bufMgr->readPage(index->file,currentPageNum,currentPageData);
+		setLeafSlice<T>();
+		return true;
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::checkFull
-	// check whether the current leaf node is full 
-	// @return: the index of avaliable spot 
+	// IndexCursor::copyLeafSlice
 	// -----------------------------------------------------------------------------
-	int BTreeIndex::leafCheckFull(LeafNodeInt *node)
+	template <class T>
+	void IndexCursor::copyLeafSlice()
 	{
-		for( int i = 0; i < INTARRAYLEAFSIZE; i++){
-			if(node->ridArray[i].page_number == 0){
-				return i;
-			}
-		}
-		return INTARRAYLEAFSIZE;
+		LeafNode<T>* currNode = (LeafNode<T> *)currentPageData;
+		setLeafSlice<T>();
+		if(direction == ASCENDING)
+			nextPageNum = lastEntry < currNode->numKeys ? 0 : currNode->rightSibPageNo;
+		else
+			nextPageNum = nextEntry > 0 ? 0 : currNode->leftSibPageNo;
+
+		int count = std::max(lastEntry - nextEntry, 0);
+		leafRids.assign(currNode->ridArray + nextEntry, currNode->ridArray + nextEntry + count);
+		nextEntry = 0;
+		lastEntry = count;
+		index->bufMgr->unlatchPage(currentPageData, LATCH_SHARED);
 	}
+
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::checkFull
-	// check whether the current nonLeaf node is full 
-	// @return: the index of avaliable spot 
+	// IndexCursor::moveToNextLeafConcurrent
 	// -----------------------------------------------------------------------------
-	int BTreeIndex:: nonLeafCheckFull(NonLeafNodeInt *node){
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++){
+	template <class T>
+	bool IndexCursor::moveToNextLeafConcurrent()
+	{
+		if(nextPageNum == 0)
+			return false;
 
-			if(node->pageNoArray[i + 1] == 0){
-				return i;
+		PageId prevPageNum = currentPageNum;
+		index->bufMgr->readPage(index->file, nextPageNum, currentPageData, LATCH_SHARED);
+		try{
+			index->bufMgr->unPinPage(index->file, prevPageNum, false);
+		}catch (PageNotPinnedException e){}
+		currentPageNum = nextPageNum;
 
+		//The left sibling may have split since its link was read, the leaf next
+		//to the previous one is then further right
+		if(direction == DESCENDING){
+			LeafNode<T>* currNode = (LeafNode<T> *)currentPageData;
+			while(currNode->rightSibPageNo != prevPageNum && currNode->rightSibPageNo != 0){
+				PageId rightPageNum = currNode->rightSibPageNo;
+				Page* rightPage;
+				index->bufMgr->readPage(index->file, rightPageNum, rightPage, LATCH_SHARED);
+				try{
+					index->bufMgr->unPinPage(index->file, currentPageNum, false, LATCH_SHARED);
+				}catch (PageNotPinnedException e){}
+				currentPageNum = rightPageNum;
+				currentPageData = rightPage;
+				currNode = (LeafNode<T> *)currentPageData;
 			}
 		}
-		return INTARRAYNONLEAFSIZE;
+		copyLeafSlice<T>();
+		return true;
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::initLeaf
-	// Create the very first leaf in the current B+ tree
-	// @param pair: <key, rid> pair to be added to the first leaf
-	// @param node: parent node
-	// @param pageId: the pageNo of the parent node
+	// IndexCursor::startScanConcurrent
 	// -----------------------------------------------------------------------------
-	void BTreeIndex::initLeaf(RIDKeyPair<int> pair,NonLeafNodeInt* node, PageId pageId)
+
+	template <class T>
+	void IndexCursor::startScanConcurrent(const void* lowValParm, const void* highValParm)
 	{
-		PageId newPageId;
-		Page* newPage;
+		readKey(lowValParm, lowVal<T>(), index->keySize);
+		readKey(highValParm, highVal<T>(), index->keySize);
+		if(lowVal<T>() > highVal<T>())
+			throw BadScanrangeException();
 
-		//Alloc new memory space for the new leaf
-		bufMgr->allocPage(file, newPageId, newPage);
-		LeafNodeInt *leaf = (LeafNodeInt *) newPage;
+		//An ascending scan starts on the leftmost leaf that can hold the low bound,
+		//a descending one on the rightmost leaf that can hold the high bound
+		bool ascending = direction == ASCENDING;
+		const T& key = ascending ? lowVal<T>() : highVal<T>();
+		PageId leafPageNum = index->descendConcurrent(key, !ascending, 0, NULL);
+		if(leafPageNum == 0)
+			throw NoSuchKeyFoundException();
 
-		//Init values
-		for(int i  = 0; i < INTARRAYLEAFSIZE; i++){
-			leaf->ridArray[i].page_number = 0;
-			if(i == 0){
-				leaf->keyArray[i] = pair.key;
-				leaf->ridArray[i] = pair.rid;
-			}
-			//Set up values in the parent node
-			node->pageNoArray[0] = newPageId;
+		//The leaf stays pinned, but not latched, until the scan moves past it or ends
+		currentPageNum = leafPageNum;
+		index->bufMgr->readPage(index->file, currentPageNum, currentPageData, LATCH_SHARED);
+		index->moveRight<LeafNode<T> >(currentPageNum, currentPageData, key, !ascending, LATCH_SHARED);
+		copyLeafSlice<T>();
+		scanExecuting = true;
+	}
 
-			//Set sigbling = 0 since it is the first leafAdded to the B+tree;
-			leaf->rightSibPageNo = 0;
+	// -----------------------------------------------------------------------------
+	// IndexCursor::tryScanNextConcurrent
+	// -----------------------------------------------------------------------------
 
-			//releas the temp page
-			try{
-				bufMgr->unPinPage(file, newPageId, true);
-				//Parent node should also be unpinned since the recursive call will return after initLeaf()
-				bufMgr->unPinPage(file, pageId, true);
-			}
-			catch (PageNotPinnedException e) {}		
+	template <class T>
+	bool IndexCursor::tryScanNextConcurrent(RecordId& outRid)
+	{
+		while(nextEntry >= lastEntry){
+			if(!moveToNextLeafConcurrent<T>())
+				return false;
 		}
+		outRid = direction == ASCENDING ? leafRids[nextEntry++] : leafRids[--lastEntry];
+		return true;
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::leafSplit
-	// Split the leafNode and return the newly created pageId and key
-	// @param pair: the <key, rid> pair that will be added to the B+ tree
-	// @param node: the current node that will be split
-	// @param newPushedUpKey:  return value for adding new key toparent KeyArraykey
-	// @param newSplitPageId:  return value for adding new page parent PageNoArray
-	// @param targetPos:	   Posiion in the current that will add the new key
+	// IndexCursor::scanNextBatchConcurrent
 	// -----------------------------------------------------------------------------
-	void BTreeIndex::leafSplit(RIDKeyPair<int> pair, 
-			LeafNodeInt* node,
-			int& newPushedUpKey,	 //return value for adding new key toparent KeyArraykey
-			PageId& newSplitPageId,  //return value for adding new page parent PageNoArray
-			int targetPos		 //Posiion in the current that will add the new key
-			){
-		//Establish a array to sort all keys
-		int sortedKey[INTARRAYLEAFSIZE + 1];
-		RecordId sortedRid[INTARRAYLEAFSIZE +1];
-
-		Page* newLeafPage;
-		bufMgr->allocPage(file, newSplitPageId, newLeafPage);
 
-		LeafNodeInt *newLeaf = (LeafNodeInt *) newLeafPage;		
-		//copy the original array into sorting array
-		for(int i = 1; i< INTARRAYLEAFSIZE+1; i++){
-			sortedRid[i] = node->ridArray[i - 1];
-			sortedKey[i] = node->keyArray[i - 1];
+	template <class T>
+	size_t IndexCursor::scanNextBatchConcurrent(RecordId* outRids, size_t maxRids)
+	{
+		size_t numRids = 0;
+		while(numRids < maxRids){
+			int count = std::min(lastEntry - nextEntry, (int) (maxRids - numRids));
+			if(count > 0 && direction == ASCENDING){
+				std::copy(leafRids.begin() + nextEntry, leafRids.begin() + nextEntry + count, outRids + numRids);
+				nextEntry += count;
+				numRids += count;
+			}
+			else if(count > 0){
+				std::reverse_copy(leafRids.begin() + lastEntry - count, leafRids.begin() + lastEntry, outRids + numRids);
+				lastEntry -= count;
+				numRids += count;
+			}
 
-			//Initialize the both leaf
-			node->ridArray[i - 1].page_number = 0;
-			newLeaf->ridArray[i - 1].page_number = 0;		
+			if(nextEntry < lastEntry || !moveToNextLeafConcurrent<T>())
+				break;
 		}
+		return numRids;
+	}
 
-		/*****SORTING ALGORITHM STARTS*****/
+	// -----------------------------------------------------------------------------
+	// IndexCursor::copyPostingSlice
+	// -----------------------------------------------------------------------------
 
-		//Add new key to the array and sort
-		for(int i = 0; i< targetPos; i++){
-			//LEFT SHIFT
-			sortedRid[i] = sortedRid[i + 1];
-			sortedKey[i] = sortedKey[i + 1];
-		}
-		//IF targetPos reaches, Insert 
-		sortedRid[targetPos] = pair.rid;
-		sortedKey[targetPos] = pair.key;
+	void IndexCursor::copyPostingSlice()
+	{
+		PostingLeafNode* currNode = (PostingLeafNode *)currentPageData;
+		int first = lowOp == GTE ? postingLowerBound(currNode, lowValInt) : postingUpperBound(currNode, lowValInt);
+		int last = highOp == LTE ? postingUpperBound(currNode, highValInt) : postingLowerBound(currNode, highValInt);
+		if(direction == ASCENDING)
+			nextPageNum = last < currNode->numKeys ? 0 : currNode->rightSibPageNo;
+		else
+			nextPageNum = first > 0 ? 0 : currNode->leftSibPageNo;
 
-		for(int i = 0; i< INTARRAYLEAFSIZE; i++){
-			node->ridArray[i].page_number = 0;
-			newLeaf->ridArray[i].page_number = 0;
+		leafRids.clear();
+		PostingList list;
+		for(int i = first; i < last; i++){
+			readPostingSlot(currNode, i, list);
+			index->readPostingList(list, leafRids);
 		}
+		nextEntry = 0;
+		lastEntry = leafRids.size();
+	}
 
-		//Finish sort, redistrubute keys and rids
-		int midVal = (INTARRAYLEAFSIZE + 1)/2;
-		for(int i = 0; i < INTARRAYLEAFSIZE + 1; i++){
-			if(i < midVal){
-				node->ridArray[i] = sortedRid[i];
-				node->keyArray[i] = sortedKey[i]; 
-
-			}
-			else if(i >= midVal){
-				newLeaf->ridArray[i - midVal] = sortedRid[i];
-				newLeaf->keyArray[i - midVal] = sortedKey[i];		
-			}
-		}
+	// -----------------------------------------------------------------------------
+	// IndexCursor::moveToNextPostingLeaf
+	// -----------------------------------------------------------------------------
 
-		//Setup return Value	
-		newPushedUpKey = newLeaf->keyArray[0];		
+	bool IndexCursor::moveToNextPostingLeaf()
+	{
+		if(nextPageNum == 0)
+			return false;
 
-		//Setup sibling (insert)
-		newLeaf->rightSibPageNo = node->rightSibPageNo;
-		node->rightSibPageNo = newSplitPageId;
 		try{
-			bufMgr->unPinPage(file, newSplitPageId, true);
-		}
-		catch (PageNotPinnedException e) {}		
+			index->bufMgr->unPinPage(index->file, currentPageNum, false);
+		}catch (PageNotPinnedException e){}
+		currentPageNum = nextPageNum;
+		index->bufMgr->readPage(index->file, currentPageNum, currentPageData);
+		copyPostingSlice();
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexCursor::startScanPosting
+	// -----------------------------------------------------------------------------
+
+	void IndexCursor::startScanPosting(const void* lowValParm, const void* highValParm)
+	{
+		readKey(lowValParm, lowValInt, index->keySize);
+		readKey(highValParm, highValInt, index->keySize);
+		if(lowValInt > highValInt)
+			throw BadScanrangeException();
 
+		PageId leafPageNum = direction == ASCENDING ? index->findLeaf(lowValInt, lowOp == GT) : index->findLeaf(highValInt, true);
+		if(leafPageNum == 0)
+			throw NoSuchKeyFoundException();
 
+		//The leaf stays pinned until the scan moves past it or ends
+		currentPageNum = leafPageNum;
+		index->bufMgr->readPage(index->file, currentPageNum, currentPageData);
+		copyPostingSlice();
+		scanExecuting = true;
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::nonLeafSplit
-	// Split the nonLeaf with the input of its created child's key and PageId.
-	// return the newly created pageId and key
-	// @param node: the current node that will be split
-	// @param newPushedUpKey:  return value for adding new key toparent KeyArraykey
-	// @param newSplitPageId:  return value for adding new page parent PageNoArray
-	// @param targetPos:	   Posiion in the current that will add the new key
-	// @param childKey:	   Parameter that contain the new created key in the child level
-	// @PageId childPageId:	   parameter indicate the new created node in the child level
-	// -----------------------------------------------------------------------------	
-	void BTreeIndex::nonLeafSplit(
-			NonLeafNodeInt* node, 	 //Current node
-			int& newPushedUpKey,	 //return value for adding new key toparent KeyArraykey
-			PageId& newSplitPageId,  //return value for adding new page parent PageNoArray
-			int targetPos,		 //potential index to add the new key
-			int& childKey,		 //Parameter that contain the new created key in the child level
-			PageId childPageId	 //parameter indicate the new created node in the child level
-			){
-		//Establish a array to sort all keys
-		//Temp arrays for insert and split
-		int sortedKey[INTARRAYNONLEAFSIZE + 1];	
-		PageId sortedPageNo[INTARRAYNONLEAFSIZE + 2];
-
-		//allocate new memory space for the new Nonleafnode
-		Page* newNonLeafPage;
-		bufMgr->allocPage(file, newSplitPageId, newNonLeafPage);
-		NonLeafNodeInt *newNonLeaf = (NonLeafNodeInt *) newNonLeafPage;	
+	// IndexCursor::tryScanNextPosting
+	// -----------------------------------------------------------------------------
 
-		//make a copy of the original arrays
-		for(int i = 1; i< INTARRAYNONLEAFSIZE+1; i++){	//i: 1-INRARRAYNONLEASIZE
-			sortedPageNo[i] = node->pageNoArray[i - 1];  
-			sortedKey[i] = node->keyArray[i - 1];
-		}
-		sortedPageNo[INTARRAYNONLEAFSIZE + 1] = node->pageNoArray[INTARRAYNONLEAFSIZE ]; 
-		//Init both nonleaves
-		for(int i = 0; i < INTARRAYNONLEAFSIZE + 1; i++){
-			node->pageNoArray[i] = 0;
-			newNonLeaf->pageNoArray[i] = 0;
+	bool IndexCursor::tryScanNextPosting(RecordId& outRid)
+	{
+		while(nextEntry >= lastEntry){
+			if(!moveToNextPostingLeaf())
+				return false;
 		}
+		outRid = direction == ASCENDING ? leafRids[nextEntry++] : leafRids[--lastEntry];
+		return true;
+	}
 
-		/*****SORTING ALGORITHM STARTS*****/
-		//Left shift 
-		for(int i = 0; i < targetPos; i++){
-			sortedKey[i] = sortedKey[i + 1];
-			sortedPageNo[i] = sortedPageNo[i + 1];
-		}
-		//IF targetPos reaches, insert 
-		sortedPageNo[targetPos] = childPageId ;
-		sortedKey[targetPos ] = childKey;
+	// -----------------------------------------------------------------------------
+	// IndexCursor::scanNextBatchPosting
+	// -----------------------------------------------------------------------------
 
-		//Redistribution
-		int midVal = (INTARRAYNONLEAFSIZE + 1) / 2;
-		for(int i = 0; i < INTARRAYNONLEAFSIZE ; i++){
-			if(i < midVal){    
-				node->keyArray[i] = sortedKey[i];
-				node->pageNoArray[i] = sortedPageNo[i];
-			}
-			else if(i == midVal){ 
-				node->pageNoArray[midVal] = sortedPageNo[midVal];
+	size_t IndexCursor::scanNextBatchPosting(RecordId* outRids, size_t maxRids)
+	{
+		size_t numRids = 0;
+		while(numRids < maxRids){
+			int count = std::min(lastEntry - nextEntry, (int) (maxRids - numRids));
+			if(count > 0 && direction == ASCENDING){
+				std::copy(leafRids.begin() + nextEntry, leafRids.begin() + nextEntry + count, outRids + numRids);
+				nextEntry += count;
+				numRids += count;
 			}
-			else if(i > midVal){
-				newNonLeaf->keyArray[i - 1 - midVal] = sortedKey[i]; 
-				newNonLeaf->pageNoArray[i - 1 - midVal] = sortedPageNo[i];
+			else if(count > 0){
+				std::reverse_copy(leafRids.begin() + lastEntry - count, leafRids.begin() + lastEntry, outRids + numRids);
+				lastEntry -= count;
+				numRids += count;
 			}
 
+			if(nextEntry < lastEntry || !moveToNextPostingLeaf())
+				break;
 		}
-		//Insert the last value in the PageNoArray
-		newNonLeaf->pageNoArray[midVal - 1] = sortedPageNo[INTARRAYNONLEAFSIZE + 1];
+		return numRids;
+	}
 
-		//Set up the return key for the new nonLeaf
-		newPushedUpKey = sortedKey[midVal];	//this key will be deleted from the leaf
-		newNonLeaf->level = node->level;
+	// -----------------------------------------------------------------------------
+	// IndexCursor::startScanBuffered
+	// -----------------------------------------------------------------------------
 
-		//Release the page
-		try{
-			bufMgr->unPinPage(file,newSplitPageId, true);
+	void IndexCursor::startScanBuffered(const void* lowValParm, const void* highValParm)
+	{
+		readKey(lowValParm, lowValInt, index->keySize);
+		readKey(highValParm, highValInt, index->keySize);
+		if(lowValInt > highValInt)
+			throw BadScanrangeException();
+
+		//The buffered inserts of the range, in key order, take the place of the delta slice.
+		//The tree is only read, the inserts stay in their buffers.
+		std::vector<BufferedMessage> messages;
+		index->bufferedRange(index->rootPageNum, lowValInt, highValInt, messages);
+		std::stable_sort(messages.begin(), messages.end(), messageLess);
+		deltaSliceInt.clear();
+		for(size_t i = 0; i < messages.size(); i++){
+			if((lowOp == GT && messages[i].key == lowValInt) || (highOp == LT && messages[i].key == highValInt))
+				continue;
+			RIDKeyPair<int> pair;
+			pair.set(messages[i].rid, messages[i].key);
+			deltaSliceInt.push_back(pair);
 		}
-		catch (PageNotPinnedException e) {}	
+		deltaNext = 0;
+		deltaLast = deltaSliceInt.size();
 
+		try{
+			startScanOfType<int, BufferedNonLeafNode>(lowValParm, highValParm);
+		}catch (NoSuchKeyFoundException e) {
+			if(deltaSliceInt.empty())
+				throw;
+			currentPageNum = 0;
+			scanExecuting = true;
+		}
 	}
 
+	// -----------------------------------------------------------------------------
+	// IndexCursor::deltaSlice
+	// -----------------------------------------------------------------------------
 
+	template <> std::vector<RIDKeyPair<int> >& IndexCursor::deltaSlice<int>() { return deltaSliceInt; }
+	template <> std::vector<RIDKeyPair<double> >& IndexCursor::deltaSlice<double>() { return deltaSliceDouble; }
+	template <> std::vector<RIDKeyPair<std::string> >& IndexCursor::deltaSlice<std::string>() { return deltaSliceString; }
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::startScan
+	// IndexCursor::startScanDelta
 	// -----------------------------------------------------------------------------
 
-	const void BTreeIndex::startScan(const void* lowValParm,
-			const Operator lowOpParm,
-			const void* highValParm,
-			const Operator highOpParm)
+	template <class T>
+	void IndexCursor::startScanDelta(const void* lowValParm, const void* highValParm)
 	{
-		//Validate scan
-		if((lowOpParm != GT && lowOpParm != GTE)||(highOpParm != LT && highOpParm != LTE))					
-			throw BadOpcodesException();
-		//Copy the value
-		lowValInt = *(int *)lowValParm;
-		highValInt = *(int *)highValParm;
-		lowOp = lowOpParm;
-		highOp = highOpParm;
-		scanExecuting = true;
-		if(lowValInt > highValInt)
+		readKey(lowValParm, lowVal<T>(), index->keySize);
+		readKey(highValParm, highVal<T>(), index->keySize);
+		if(lowVal<T>() > highVal<T>())
 			throw BadScanrangeException();
 
-		NonLeafNodeInt * currNode = findParentOfLeaf(lowValInt, rootPageNum);	
-
-		//currentPageNum now pointing to the parent node of the target leaf
-		//Get info of target leaf
-		int idx = 0;
-		while(idx < INTARRAYNONLEAFSIZE && currNode->keyArray[idx] <= lowValInt && currNode->pageNoArray[idx + 1]!=0){
-			idx++;
+		//Copy the entries of the delta inside the range
+		std::multimap<T, RecordId>& delta = index->delta<T>();
+		typename std::multimap<T, RecordId>::const_iterator it =
+			lowOp == GTE ? delta.lower_bound(lowVal<T>()) : delta.upper_bound(lowVal<T>());
+		std::vector<RIDKeyPair<T> >& slice = deltaSlice<T>();
+		slice.clear();
+		for(; it != delta.end() && (highOp == LTE ? !(highVal<T>() < it->first) : it->first < highVal<T>()); ++it){
+			RIDKeyPair<T> pair;
+			pair.set(it->second, it->first);
+			slice.push_back(pair);
 		}
-		try{
-			bufMgr->unPinPage(file,currentPageNum,false);
-		}catch (PageNotPinnedException e) {}
+		deltaNext = 0;
+		deltaLast = slice.size();
 
-		//Set page
-		currentPageNum = currNode->pageNoArray[idx];
-		bufMgr->readPage(file,currentPageNum, currentPageData);
+		//Pin the leaf the scan starts on, unless the tree has none
 		try{
-			bufMgr->unPinPage(file,currentPageNum,false);
-		}catch (PageNotPinnedException e) {}
-		nextEntry = 0;	
+			startScanOfType<T>(lowValParm, highValParm);
+		}catch (NoSuchKeyFoundException e) {
+			if(slice.empty())
+				throw;
+			currentPageNum = 0;
+			scanExecuting = true;
+		}
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::findParentOfLeaf
-	// Recursive call to find the parent node that contains the leaf which has the
-	// key greater than lowVal in its keyArray
-	// @param: lowVal: the lowValInt to be searched
-	// @param  currPage: the current Page to be handle
-	// @return: the child node that contains or its children contain the lowVal 
+	// IndexCursor::nextTreeKey
 	// -----------------------------------------------------------------------------
-	NonLeafNodeInt* BTreeIndex::findParentOfLeaf(int lowVal,PageId currPage){
 
-		//Read info of the currentPae
-		currentPageNum = currPage;
-		bufMgr->readPage(file, currentPageNum, currentPageData);
-		NonLeafNodeInt* currNode = (NonLeafNodeInt*) currentPageData;
+	template <class T>
+	bool IndexCursor::nextTreeKey(T& key)
+	{
+		if(currentPageNum == 0)
+			return false;
+		while(nextEntry >= lastEntry){
+			if(!moveToNextLeaf<T>())
+				return false;
+		}
+		typename NodeTypes<T>::Leaf* currNode = (typename NodeTypes<T>::Leaf *)currentPageData;
+		key = leafKey(currNode, direction == ASCENDING ? nextEntry : lastEntry - 1);
+		return true;
+	}
 
-		//Handle the data
-		if(currNode->level == 1)
-		{
+	// -----------------------------------------------------------------------------
+	// IndexCursor::tryScanNextDelta
+	// -----------------------------------------------------------------------------
 
-			return currNode;
-		}
-		//Paged = childPage;
-		int idx = 0;
-		while(idx < INTARRAYNONLEAFSIZE && currNode->keyArray[idx] <= lowVal && currNode->pageNoArray[idx + 1]!=0){
-			idx++;
+	template <class T>
+	bool IndexCursor::tryScanNextDelta(RecordId& outRid)
+	{
+		std::vector<RIDKeyPair<T> >& slice = deltaSlice<T>();
+		T treeKey;
+		bool fromTree = nextTreeKey(treeKey);
+		if(fromTree && deltaNext < deltaLast){
+			if(direction == ASCENDING)
+				fromTree = !(slice[deltaNext].key < treeKey);
+			else
+				fromTree = !(treeKey < slice[deltaLast - 1].key);
 		}
-		PageId childPage = currNode->pageNoArray[idx];
-		try{
-			bufMgr->unPinPage(file,currPage,false);
-		}catch (PageNotPinnedException e) {}
+		if(fromTree)
+			return tryScanNextOfType<T>(outRid);
+		if(deltaNext == deltaLast)
+			return false;
+		outRid = direction == ASCENDING ? slice[deltaNext++].rid : slice[--deltaLast].rid;
+		return true;
+	}
 
-		NonLeafNodeInt* retNode = findParentOfLeaf(lowVal,childPage); 
-		return retNode;	
+	// -----------------------------------------------------------------------------
+	// IndexCursor::scanNextBatchDelta
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	size_t IndexCursor::scanNextBatchDelta(RecordId* outRids, size_t maxRids)
+	{
+		size_t numRids = 0;
+		while(numRids < maxRids){
+			//Once the delta slice is used up the leaves are copied in slices
+			if(deltaNext == deltaLast){
+				if(currentPageNum != 0)
+					numRids += scanNextBatchOfType<T>(outRids + numRids, maxRids - numRids);
+				break;
+			}
+			if(!tryScanNextDelta<T>(outRids[numRids]))
+				break;
+			numRids++;
+		}
+		return numRids;
 	}
+
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::scanNext
+	// IndexCursor::tryScanNext
 	// -----------------------------------------------------------------------------
 
-	const void BTreeIndex::scanNext(RecordId& outRid) 
+	bool IndexCursor::tryScanNext(RecordId& outRid) 
 	{
 		if(!scanExecuting)	
 			throw ScanNotInitializedException();
-		while(1){
-			if (checkJumpPage()) continue; 
-			if(adjustEntry()) continue;
-			if(checkReachHigh()) continue;
+		return (this->*index->keyOps->tryScanNext)(outRid);
+	}
 
-			//Return the rid	 
-			LeafNodeInt* currNode = (LeafNodeInt *)currentPageData; 	
-			outRid = currNode->ridArray[nextEntry];
+	// -----------------------------------------------------------------------------
+	// IndexCursor::tryScanNextOfType
+	// -----------------------------------------------------------------------------
 
-			//Increment the pointer
-			nextEntry++;
-			return;
+	template <class T>
+	bool IndexCursor::tryScanNextOfType(RecordId& outRid) 
+	{
+		while(nextEntry >= lastEntry){
+			if(!moveToNextLeaf<T>())
+				return false;
 		}
-	}
 
-	bool BTreeIndex::checkJumpPage(){
-		LeafNodeInt* currNode = (LeafNodeInt *)currentPageData; 	
+		//Return the rid and move the pointer
+		typename NodeTypes<T>::Leaf* currNode = (typename NodeTypes<T>::Leaf *)currentPageData; 	
+		if(direction == ASCENDING)
+			outRid = leafRid(currNode, nextEntry++);
+		else
+			outRid = leafRid(currNode, --lastEntry);
+		return true;
+	}
 
-		//END OF ARRAY, jump to right sibling
-		if(currNode->ridArray[nextEntry].page_number == 0||nextEntry == INTARRAYLEAFSIZE ){
-			PageId nextNum = currNode->rightSibPageNo; 	
-			try{
-				bufMgr->unPinPage(file, currentPageNum, false);
-			}catch (PageNotPinnedException e){}
+	// -----------------------------------------------------------------------------
+	// IndexCursor::scanNext
+	// -----------------------------------------------------------------------------
 
-			//if exhauested all possible value
-			if(currNode->rightSibPageNo == 0)
-				throw IndexScanCompletedException();
+	const void IndexCursor::scanNext(RecordId& outRid) 
+	{
+		if(!tryScanNext(outRid))
+			throw IndexScanCompletedException();
+	}
 
-			//set the rightSibPageNo to next node to move to next node
-			currentPageNum = nextNum;
+	// -----------------------------------------------------------------------------
+	// IndexCursor::scanNextBatch
+	// -----------------------------------------------------------------------------
 
-			bufMgr->readPage(file,currentPageNum,currentPageData);
-			//			try{
-			//				bufMgr->unPinPage(file, currentPageNum, false);
-			//			}catch (PageNotPinnedException e){ }
-			nextEntry = 0;
-			return true;
-		}
-		return false;
+	size_t IndexCursor::scanNextBatch(RecordId* outRids, size_t maxRids)
+	{
+		if(!scanExecuting)	
+			throw ScanNotInitializedException();
+		return (this->*index->keyOps->scanNextBatch)(outRids, maxRids);
 	}
 
-	bool BTreeIndex::checkReachHigh(){
-		LeafNodeInt* currNode = (LeafNodeInt *)currentPageData; 	
-		if(highOp == LT && highValInt <= currNode->keyArray[nextEntry])
-			throw IndexScanCompletedException();
-		if(highOp == LTE && highValInt < currNode->keyArray[nextEntry])
-			throw IndexScanCompletedException();
-		return false;
-	}
+	// -----------------------------------------------------------------------------
+	// IndexCursor::scanNextBatchOfType
+	// -----------------------------------------------------------------------------
 
-	bool BTreeIndex::adjustEntry(){
-		LeafNodeInt* currNode = (LeafNodeInt *)currentPageData; 
-		//Skip records that does not need to be return 
-		if(lowOp == GT && lowValInt >= currNode->keyArray[nextEntry]){
-			nextEntry++;
-			return true;
-		}
-		if(lowOp == GTE && lowValInt > currNode->keyArray[nextEntry]){
-			nextEntry++;
-			return true;
+	template <class T>
+	size_t IndexCursor::scanNextBatchOfType(RecordId* outRids, size_t maxRids)
+	{
+		size_t numRids = 0;
+		while(numRids < maxRids){
+			//Copy as much of the current slice as fits
+			typename NodeTypes<T>::Leaf* currNode = (typename NodeTypes<T>::Leaf *)currentPageData; 	
+			int count = std::min(lastEntry - nextEntry, (int) (maxRids - numRids));
+			if(count > 0 && direction == ASCENDING){
+				copyRids(currNode, nextEntry, nextEntry + count, false, outRids + numRids);
+				nextEntry += count;
+				numRids += count;
+			}
+			else if(count > 0){
+				copyRids(currNode, lastEntry - count, lastEntry, true, outRids + numRids);
+				lastEntry -= count;
+				numRids += count;
+			}
+
+			//Stop when outRids is full or the scan is completed
+			if(nextEntry < lastEntry || !moveToNextLeaf<T>())
+				break;
 		}
-		return false;
+		return numRids;
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::endScan
+	// IndexCursor::endScan
 	// -----------------------------------------------------------------------------
 	//
-	const void BTreeIndex::endScan() 
+	const void IndexCursor::endScan() 
 	{
 		if(!scanExecuting)
 			throw ScanNotInitializedException();
 		scanExecuting = false;
 		try {
-			bufMgr->unPinPage(file, currentPageNum, false);
+			index->bufMgr->unPinPage(index->file, currentPageNum, false);
 		} catch (PageNotPinnedException e) {} 
 		catch(HashNotFoundException e){
 
 		}
 	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::keyTypeOps
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	const KeyTypeOps* BTreeIndex::keyTypeOps()
+	{
+		static const KeyTypeOps ops = {
+			&BTreeIndex::initRootOfType<T>,
+			&BTreeIndex::bulkLoadOfType<T>,
+			&BTreeIndex::insertRelationOfType<T>,
+			&BTreeIndex::insertEntryOfType<T>,
+			&BTreeIndex::deleteEntryOfType<T>,
+			&BTreeIndex::lookupOfType<T>,
+			&IndexCursor::startScanOfType<T>,
+			&IndexCursor::tryScanNextOfType<T>,
+			&IndexCursor::scanNextBatchOfType<T>,
+			&BTreeIndex::parallelScanOfType<T>,
+			&BTreeIndex::mergeDeltaOfType<T>
+		};
+		return &ops;
+	}
+
+	//The key types of the index
+	template const KeyTypeOps* BTreeIndex::keyTypeOps<int>();
+	template const KeyTypeOps* BTreeIndex::keyTypeOps<double>();
+	template const KeyTypeOps* BTreeIndex::keyTypeOps<std::string>();
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::concurrentKeyTypeOps
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	const KeyTypeOps* BTreeIndex::concurrentKeyTypeOps()
+	{
+		static const KeyTypeOps ops = {
+			&BTreeIndex::initRootOfType<T>,
+			&BTreeIndex::bulkLoadOfType<T>,
+			&BTreeIndex::insertRelationOfType<T>,
+			&BTreeIndex::insertEntryConcurrent<T>,
+			&BTreeIndex::deleteEntryConcurrent<T>,
+			&BTreeIndex::lookupConcurrent<T>,
+			&IndexCursor::startScanConcurrent<T>,
+			&IndexCursor::tryScanNextConcurrent<T>,
+			&IndexCursor::scanNextBatchConcurrent<T>,
+			&BTreeIndex::parallelScanOfType<T>,
+			&BTreeIndex::mergeDeltaOfType<T>
+		};
+		return &ops;
+	}
+
+	//The key types a concurrent index supports
+	template const KeyTypeOps* BTreeIndex::concurrentKeyTypeOps<int>();
+	template const KeyTypeOps* BTreeIndex::concurrentKeyTypeOps<double>();
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::postingKeyTypeOps
+	// -----------------------------------------------------------------------------
+
+	const KeyTypeOps* BTreeIndex::postingKeyTypeOps()
+	{
+		static const KeyTypeOps ops = {
+			&BTreeIndex::initRootOfType<int>,
+			&BTreeIndex::bulkLoadPosting,
+			&BTreeIndex::insertRelationOfType<int>,
+			&BTreeIndex::insertEntryPosting,
+			&BTreeIndex::deleteEntryPosting,
+			&BTreeIndex::lookupPosting,
+			&IndexCursor::startScanPosting,
+			&IndexCursor::tryScanNextPosting,
+			&IndexCursor::scanNextBatchPosting,
+			&BTreeIndex::parallelScanOfType<int>,
+			&BTreeIndex::mergeDeltaOfType<int>
+		};
+		return &ops;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::bufferedKeyTypeOps
+	// -----------------------------------------------------------------------------
+
+	const KeyTypeOps* BTreeIndex::bufferedKeyTypeOps()
+	{
+		static const KeyTypeOps ops = {
+			&BTreeIndex::initRootOfType<int, BufferedNonLeafNode>,
+			&BTreeIndex::bulkLoadOfType<int, BufferedNonLeafNode>,
+			&BTreeIndex::insertRelationOfType<int>,
+			&BTreeIndex::insertEntryBuffered,
+			&BTreeIndex::deleteEntryBuffered,
+			&BTreeIndex::lookupBuffered,
+			&IndexCursor::startScanBuffered,
+			&IndexCursor::tryScanNextDelta<int>,
+			&IndexCursor::scanNextBatchDelta<int>,
+			&BTreeIndex::parallelScanOfType<int, BufferedNonLeafNode>,
+			&BTreeIndex::mergeDeltaOfType<int>
+		};
+		return &ops;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deltaKeyTypeOps
+	// -----------------------------------------------------------------------------
+
+	template <class T>
+	const KeyTypeOps* BTreeIndex::deltaKeyTypeOps()
+	{
+		static const KeyTypeOps ops = {
+			&BTreeIndex::initRootOfType<T>,
+			&BTreeIndex::bulkLoadOfType<T>,
+			&BTreeIndex::insertRelationOfType<T>,
+			&BTreeIndex::insertEntryDelta<T>,
+			&BTreeIndex::deleteEntryDelta<T>,
+			&BTreeIndex::lookupDelta<T>,
+			&IndexCursor::startScanDelta<T>,
+			&IndexCursor::tryScanNextDelta<T>,
+			&IndexCursor::scanNextBatchDelta<T>,
+			&BTreeIndex::parallelScanOfType<T>,
+			&BTreeIndex::mergeDeltaOfType<T>
+		};
+		return &ops;
+	}
+
+	//The key types an index with a delta supports
+	template const KeyTypeOps* BTreeIndex::deltaKeyTypeOps<int>();
+	template const KeyTypeOps* BTreeIndex::deltaKeyTypeOps<double>();
+	template const KeyTypeOps* BTreeIndex::deltaKeyTypeOps<std::string>();
 }
@@ -11,6 +11,13 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <vector>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <atomic>
+#include <mutex>
+#include <functional>
 
 #include "types.h"
 #include "page.h"
@@ -27,7 +34,21 @@ enum Datatype
 {
 	INTEGER = 0,
 	DOUBLE = 1,
-	STRING = 2
+	STRING = 2,
+	COMPOSITE = 3	/* Several attributes, see KeyAttribute */
+};
+
+/**
+ * @brief Maximum number of attributes of a composite index.
+ */
+const int MAXKEYATTRIBUTES = 4;
+
+/**
+ * @brief One attribute of a composite index: its offset inside the records and its type, INTEGER, DOUBLE or STRING.
+ */
+struct KeyAttribute{
+	int byteOffset;
+	Datatype type;
 };
 
 /**
@@ -41,18 +62,167 @@ enum Operator
 	GT		/* Greater Than */
 };
 
+/**
+ * @brief Scan directions enumeration. Passed to BTreeIndex::startScan() method.
+ */
+enum ScanDirection
+{
+	ASCENDING,	/* From the low bound to the right */
+	DESCENDING	/* From the high bound to the left */
+};
+
+/**
+ * @brief Receives the RecordIds a worker of BTreeIndex::parallelScan() fetched: the number of the
+ * worker, from 0, and a batch of numRids RecordIds. Workers call it at the same time.
+ */
+typedef std::function<void(int worker, const RecordId* rids, size_t numRids)> ScanBatchCallback;
+
+/**
+ * @brief Maximum number of characters of a STRING attribute that make up its key. The key is the
+ * attribute up to its first zero byte, so keys vary in length and compare like std::string.
+ */
+const int STRINGSIZE = 64;
+
+/**
+ * @brief Longest key of a composite index in bytes: MAXKEYATTRIBUTES STRING values whose bytes are all escaped,
+ * each followed by its terminator. Keys of the other attribute types are shorter.
+ */
+const int COMPOSITEKEYSIZE = MAXKEYATTRIBUTES * ( 2 * STRINGSIZE + 2 );
+
+/**
+ * @brief Key of a composite index: the values of its attributes in order, encoded so that the keys
+ * compare byte by byte like the values do attribute by attribute. INTEGER and DOUBLE values are stored
+ * big-endian with the sign flipped, STRING values are followed by a terminator, and the bytes 0 and 1
+ * are escaped. The key is thus a char string the index stores like a STRING key, whole: it takes up
+ * at most COMPOSITEKEYSIZE bytes.
+ * A key with fewer values than the index has attributes is a prefix. It sorts before all keys that
+ * start with its values, and prefixEnd() sorts after all of them, so a scan over a leading prefix
+ * and a range of the next attribute is answered by the index alone.
+ */
+class CompositeKey{
+ public:
+	CompositeKey() {}
+
+  /**
+   * The key of a record of the relation. A STRING attribute is the characters up to its first zero byte, at most
+   * STRINGSIZE: its field in the record need not end with a zero byte.
+   * @param attributes	Attributes of the composite index
+   * @param record		The record, holding the attributes at their offsets
+   */
+	CompositeKey(const std::vector<KeyAttribute>& attributes, const char* record);
+
+  /**
+   * Append the value of the next attribute.
+   * @param value		INTEGER / DOUBLE value, or zero-terminated STRING value of at most STRINGSIZE characters
+   * @return				this key
+   * @throws  KeyTooLongException If the STRING value is longer than STRINGSIZE, or the key would be longer than
+   *						COMPOSITEKEYSIZE. The key is left as it was.
+   */
+	CompositeKey& add(int value);
+	CompositeKey& add(double value);
+	CompositeKey& add(const char* value);
+
+  /**
+   * @return				A key greater than every key starting with the values of this one. Use it as the
+   *						high value of a scan with LTE or as the low value with GT to compare the prefix only.
+   */
+	CompositeKey prefixEnd() const;
+
+  /**
+   * @return				The key as char string, to pass to the methods of BTreeIndex
+   */
+	const char* data() const { return bytes.c_str(); }
+
+ private:
+	std::string	bytes;
+
+	CompositeKey& addString(const char* value, size_t length);
+	void appendByte(unsigned char b);
+	void checkLength(size_t oldLength);
+};
+
+/**
+ * @brief RecordId as stored in the leaves of the INTEGER and DOUBLE indexes: page number and slot number
+ * packed into 6 bytes, without the padding of RecordId. Converts to and from RecordId, which is what the
+ * methods of BTreeIndex and BTreeIndexScan take and return.
+ */
+struct PackedRecordId{
+  /**
+   * Page number in the first 4 bytes, slot number in the last 2.
+   */
+	unsigned char bytes[ sizeof( PageId ) + sizeof( SlotId ) ];
+
+	PackedRecordId& operator=(const RecordId& rid)
+	{
+		memcpy(bytes, &rid.page_number, sizeof( PageId ));
+		memcpy(bytes + sizeof( PageId ), &rid.slot_number, sizeof( SlotId ));
+		return *this;
+	}
+
+	operator RecordId() const
+	{
+		RecordId rid;
+		memcpy(&rid.page_number, bytes, sizeof( PageId ));
+		memcpy(&rid.slot_number, bytes + sizeof( PageId ), sizeof( SlotId ));
+		return rid;
+	}
+};
+
+static_assert( sizeof( PackedRecordId ) == 6, "Packed RecordId must not be padded" );
+
+/**
+ * @brief Number of key slots in B+Tree leaf for keys of type T.
+ */
+//                                                                 numKeys        sibling ptrs       high key                key               rid
+//The arrays come first, numKeys and the fields after it take the bytes the entries leave over
+template <class T>
+constexpr int leafArraySize() { return ( Page::SIZE - sizeof( int ) - 2 * sizeof( PageId ) - sizeof( T ) ) / ( sizeof( T ) + sizeof( PackedRecordId ) ); }
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for keys of type T.
+ */
+//                                                                    level, numKeys  extra pageNo, right sib   high key                key       pageNo
+template <class T>
+constexpr int nonLeafArraySize() { return ( Page::SIZE - 2 * sizeof( int ) - 2 * sizeof( PageId ) - sizeof( T ) ) / ( sizeof( T ) + sizeof( PageId ) ); }
+
+/**
+ * @brief Number of INTEGER keys in a 64 byte cache line, the unit the directory of a NonLeafNodeInt is built on.
+ */
+const int LINEKEYS = 16;
+
+/**
+ * @brief Number of group separators of a NonLeafNodeInt, which fill its first cache line behind the other fields.
+ */
+const int INTNONLEAFGROUPS = 12;
+
+/**
+ * @brief Number of line separators of a NonLeafNodeInt, one per LINEKEYS keys.
+ */
+const int INTNONLEAFLINES = 64;
+
+//                                                            header              groups                             lines                             extra pageNo           key             pageNo
+template <>
+constexpr int nonLeafArraySize<int>() { return ( Page::SIZE - 4 * sizeof( int ) - INTNONLEAFGROUPS * sizeof( int ) - INTNONLEAFLINES * sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) ); }
 
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+const int INTARRAYLEAFSIZE = leafArraySize<int>();
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
  */
-//                                                     level     extra pageNo                  key       pageNo
-const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+const int INTARRAYNONLEAFSIZE = nonLeafArraySize<int>();
+
+/**
+ * @brief Number of key slots in B+Tree leaf for DOUBLE key.
+ */
+const int DOUBLEARRAYLEAFSIZE = leafArraySize<double>();
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for DOUBLE key.
+ */
+const int DOUBLEARRAYNONLEAFSIZE = nonLeafArraySize<double>();
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
@@ -86,6 +256,23 @@ public:
 	}
 };
 
+/**
+ * @brief One non-leaf node on the path of an insert: the node stays pinned in
+ * the buffer pool while a split from below could still reach it.
+*/
+class PathEntry{
+public:
+	PageId pageId;
+	Page* page;
+	int slot;		//index of the child the insert descended into
+	void set( PageId p, Page* pg, int s)
+	{
+		pageId = p;
+		page = pg;
+		slot = s;
+	}
+};
+
 /**
  * @brief Overloaded operator to compare the key values of two rid-key pairs
  * and if they are the same compares to see if the first pair has
@@ -128,202 +315,1172 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
-};
 
-/*
-Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
-These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of 
-node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes 
-at this level are just above the leaf nodes. Otherwise set to 0.
-*/
+  /**
+   * Number of hash functions of the Bloom filter, 0 if the index has none.
+   */
+	int bloomNumHashes;
 
-/**
- * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
-*/
-struct NonLeafNodeInt{
   /**
-   * Level of the node in the tree.
+   * First of the BloomFilterPage pages that hold the Bloom filter.
    */
-	int level;
+	PageId bloomPageNo;
 
   /**
-   * Stores keys.
+   * Number of pages of the Bloom filter.
    */
-	int keyArray[INTARRAYNONLEAFSIZE ];
+	int bloomNumPages;
 
   /**
-   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+   * 1 if the leaves hold posting lists, see PostingLeafNode.
    */
-	PageId pageNoArray[ INTARRAYNONLEAFSIZE + 1 ];
-};
+	int postingLists;
 
+  /**
+   * 1 if the non-leaves buffer inserts, see BufferedNonLeafNode.
+   */
+	int buffered;
 
-/**
- * @brief Structure for all leaf nodes when the key is of INTEGER type.
-*/
-struct LeafNodeInt{
   /**
-   * Stores keys.
+   * First of the DeltaPage pages that hold the entries of the delta the index could not merge when it was closed,
+   * 0 if there are none. Opening the index inserts them again.
    */
-	int keyArray[ INTARRAYLEAFSIZE ];
+	PageId deltaPageNo;
 
   /**
-   * Stores RecordIds.
+   * Number of attributes of a composite index, whose attrType is COMPOSITE, 0 for any other index.
    */
-	RecordId ridArray[ INTARRAYLEAFSIZE ];
+	int numAttributes;
 
   /**
-   * Page number of the leaf on the right side.
-	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   * Attributes of a composite index.
    */
-	PageId rightSibPageNo;
+	KeyAttribute attributes[MAXKEYATTRIBUTES];
 };
 
+/**
+ * @brief Bits of a new Bloom filter per record of the relation, about 1% false positives with BLOOMNUMHASHES.
+ */
+const int BLOOMBITSPERKEY = 10;
 
 /**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
-*/
-class BTreeIndex {
+ * @brief Number of hash functions of a new Bloom filter.
+ */
+const int BLOOMNUMHASHES = 7;
 
- private:
+/**
+ * @brief Bytes of the Bloom filter in one of its pages.
+ */
+const int BLOOMPAGEBYTES = Page::SIZE - sizeof( PageId );
 
+/**
+ * @brief Structure for the pages of the Bloom filter over the keys of an index. The filter is sized from the
+ * number of records of the relation when the index is created, and its pages are chained from IndexMetaInfo.
+ */
+struct BloomFilterPage{
   /**
-   * File object for the index file.
+   * Page number of the next page of the filter, 0 for the last one.
    */
-	File		*file;
+	PageId nextPageNo;
 
   /**
-   * Buffer Manager Instance.
+   * Bits of the filter.
    */
-	BufMgr	*bufMgr;
+	unsigned char bits[ BLOOMPAGEBYTES ];
+};
 
-  /**
-   * Page number of meta page.
-   */
-	PageId	headerPageNum;
+static_assert( sizeof( BloomFilterPage ) <= Page::SIZE, "Bloom filter page does not fit a page" );
+
+/**
+ * @brief Bytes of entries a DeltaPage holds.
+ */
+const int DELTAPAGEBYTES = Page::SIZE - sizeof( PageId ) - sizeof( int );
 
+/**
+ * @brief Structure for the pages that keep the entries of a delta the destructor could not merge into the tree.
+ * Each entry is the length of its key as unsigned short, the bytes of the key and the RecordId.
+ */
+struct DeltaPage{
   /**
-   * page number of root page of B+ tree inside index file.
+   * Page number of the next page, 0 for the last one.
    */
-	PageId	rootPageNum;
+	PageId nextPageNo;
 
   /**
-   * Datatype of attribute over which index is built.
+   * Bytes of entries in use.
    */
-	Datatype	attributeType;
+	int numBytes;
 
   /**
-   * Offset of attribute, over which index is built, inside records. 
+   * The entries.
    */
-	int 		attrByteOffset;
+	char entries[ DELTAPAGEBYTES ];
+};
+
+static_assert( sizeof( DeltaPage ) <= Page::SIZE, "Delta page does not fit a page" );
+
+/**
+ * @brief Default fraction of the entries a node keeps when it is split by an insert at its
+ * very end. Ascending keys then leave nearly full nodes behind instead of half empty ones.
+ */
+const double APPENDSPLITRATIO = 0.9;
+
+/**
+ * @brief Minimum number of threads a bulk load extracts and sorts the <key, rid> pairs of the relation
+ * with. Machines with more hardware threads use all of them.
+ */
+const unsigned int BUILDTHREADS = 4;
+
+/**
+ * @brief Number of RecordIds a worker of BTreeIndex::parallelScan() fetches per callback.
+ */
+const int PARALLELSCANBATCH = 512;
+
+/**
+ * @brief Fraction of the frames of the buffer pool an index may keep pinned for the non-leaf nodes
+ * its descents read, see BTreeIndex::getHotNodeMisses().
+ */
+const double HOTNODEFRACTION = 0.25;
+
+/*
+Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
+These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of 
+node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes 
+at this level are just above the leaf nodes, and grows by one for every level above that.
+Both structures start with the number of keys in use, so the valid entries are always
+keyArray[0, numKeys) and no sentinel values are needed in the unused slots.
+Every node also links to its right neighbour on the same level and keeps the high key, the
+separator between the two: a B-link tree. A thread that reaches a node after a concurrent
+split moved part of it away finds that part by following the right link while its key is
+beyond the high key, so descents never hold more than one node of a level at a time.
+*/
 
+/**
+ * @brief Structure for all non-leaf nodes, templated for the key type.
+*/
+template <class T>
+struct NonLeafNode{
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * Level of the node in the tree.
    */
-	int			leafOccupancy;
+	int level;
 
   /**
-   * Number of keys in non-leaf node, depending upon the type of key.
+   * Number of keys in use. The node has numKeys + 1 children, except for the
+   * root of an empty tree, whose pageNoArray[0] is still 0.
    */
-	int			nodeOccupancy;
-
-
-	// MEMBERS SPECIFIC TO SCANNING
+	int numKeys;
 
   /**
-   * True if an index scan has been started.
+   * Page number of the node on the right side on the same level, 0 for the last one.
    */
-	bool		scanExecuting;
+	PageId rightSibPageNo;
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * Separator between this node and the right one. All keys below this node are less than or
+   * equal to it, all keys below the right one greater than or equal. Unused if rightSibPageNo is 0.
    */
-	int			nextEntry;
+	T highKey;
 
   /**
-   * Page number of current page being scanned.
+   * Stores keys.
    */
-	PageId	currentPageNum;
+	T keyArray[ nonLeafArraySize<T>() ];
 
   /**
-   * Current Page being scanned.
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	Page		*currentPageData;
+	PageId pageNoArray[ nonLeafArraySize<T>() + 1 ];
+};
+
+/**
+ * @brief INTEGER non-leaf node laid out by 64 byte cache lines. A binary search over a flat array of about
+ * a thousand keys reads about ten lines. Here the sorted keys are cut into lines of LINEKEYS keys, lineKeys
+ * holds the last key of each full line and groupKeys the last key of each full group of LINEKEYS lines.
+ * A search compares the group separators, which share the first line with numKeys, then the LINEKEYS line
+ * separators of its group and then the keys of its line, each a single line in a frame of the buffer pool.
+ * The separators are written again by every change of keyArray.
+*/
+template <>
+struct NonLeafNode<int>{
+	int level;
+	int numKeys;
+	PageId rightSibPageNo;
+	int highKey;
 
   /**
-   * Low INTEGER value for scan.
+   * Last key of each full group of LINEKEYS * LINEKEYS keys.
    */
-	int			lowValInt;
+	int groupKeys[ INTNONLEAFGROUPS ];
 
   /**
-   * Low DOUBLE value for scan.
+   * Last key of each full line of LINEKEYS keys. The separators of a group fill one cache line.
    */
-	double	lowValDouble;
+	int lineKeys[ INTNONLEAFLINES ];
+
+	int keyArray[ nonLeafArraySize<int>() ];
+	PageId pageNoArray[ nonLeafArraySize<int>() + 1 ];
+};
+
+static_assert( offsetof( NonLeafNode<int>, lineKeys ) % ( LINEKEYS * sizeof( int ) ) == 0 && offsetof( NonLeafNode<int>, keyArray ) % ( LINEKEYS * sizeof( int ) ) == 0,
+		"The directory and the keys of an INTEGER non-leaf must start on a cache line" );
+static_assert( INTNONLEAFLINES * LINEKEYS >= nonLeafArraySize<int>() && INTNONLEAFGROUPS * LINEKEYS * LINEKEYS >= nonLeafArraySize<int>(),
+		"The directory of an INTEGER non-leaf must cover its keys" );
+
 
+/**
+ * @brief Structure for all leaf nodes, templated for the key type.
+*/
+template <class T>
+struct LeafNode{
   /**
-   * Low STRING value for scan.
+   * Stores keys. First in the node, so that they start on the cache line the frame starts on and the searches
+   * can load them aligned.
    */
-	std::string	lowValString;
+	T keyArray[ leafArraySize<T>() ];
 
   /**
-   * High INTEGER value for scan.
+   * Stores RecordIds, packed. Kept apart from keyArray so that the keys stay contiguous for the searches.
    */
-	int			highValInt;
+	PackedRecordId ridArray[ leafArraySize<T>() ];
 
   /**
-   * High DOUBLE value for scan.
+   * Number of <key, rid> entries in use.
    */
-	double	highValDouble;
+	int numKeys;
 
   /**
-   * High STRING value for scan.
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
-	std::string highValString;
-	
+	PageId rightSibPageNo;
+
   /**
-   * Low Operator. Can only be GT(>) or GTE(>=).
+   * Page number of the leaf on the left side, followed by descending scans.
    */
-	Operator	lowOp;
+	PageId leftSibPageNo;
 
   /**
-   * High Operator. Can only be LT(<) or LTE(<=).
+   * Separator between this leaf and the right one, as in NonLeafNode. Unused if rightSibPageNo is 0.
    */
-	Operator	highOp;
+	T highKey;
+};
 
-	
- public:
+typedef NonLeafNode<int> NonLeafNodeInt;
+typedef LeafNode<int> LeafNodeInt;
+typedef NonLeafNode<double> NonLeafNodeDouble;
+typedef LeafNode<double> LeafNodeDouble;
+
+static_assert( sizeof( NonLeafNodeInt ) <= Page::SIZE && sizeof( LeafNodeInt ) <= Page::SIZE, "INTEGER node does not fit a page" );
+static_assert( offsetof( LeafNodeInt, keyArray ) % CACHELINESIZE == 0 && offsetof( LeafNodeDouble, keyArray ) % CACHELINESIZE == 0,
+		"The keys of a leaf must start on a cache line" );
+static_assert( sizeof( NonLeafNodeDouble ) <= Page::SIZE && sizeof( LeafNodeDouble ) <= Page::SIZE, "DOUBLE node does not fit a page" );
+
+/*
+A buffered INTEGER index (a B-epsilon tree) gives its non-leaves few keys and uses the rest of the page
+for a buffer of inserts that have not reached their leaf yet. An insert only adds to the buffer of the
+root. A full buffer moves the inserts bound for the child that has most of them down in one batch: into
+that child's buffer, or, above the leaves, into the leaf with a single write. A buffered insert of a key
+always waits in a node on the path the descent for the key takes. Lookups collect them from there, and a
+scan collects those of its range from the nodes above its leaves and merges them with the leaves in memory,
+so neither changes the tree.
+*/
+
+/**
+ * @brief An insert waiting in the buffer of a BufferedNonLeafNode.
+*/
+struct BufferedMessage{
+	int key;
+	RecordId rid;
+};
+
+/**
+ * @brief Number of key slots in a BufferedNonLeafNode, about the square root of the entries of a leaf.
+ */
+const int BUFFEREDNONLEAFSIZE = 32;
+
+/**
+ * @brief Number of inserts the buffer of a BufferedNonLeafNode holds.
+ */
+//                            level, numKeys, high key, numMessages  right sib                       key                      pageNo
+const int BUFFERSIZE = ( Page::SIZE - 4 * sizeof( int ) - sizeof( PageId ) - BUFFEREDNONLEAFSIZE * sizeof( int ) - ( BUFFEREDNONLEAFSIZE + 1 ) * sizeof( PageId ) ) / sizeof( BufferedMessage );
+
+/**
+ * @brief Structure for the non-leaves of a buffered INTEGER index. The fields are those of NonLeafNode
+ * with fewer slots, the leaves are LeafNodeInt.
+*/
+struct BufferedNonLeafNode{
+	int level;
+	int numKeys;
+	PageId rightSibPageNo;
+	int highKey;
+	int keyArray[ BUFFEREDNONLEAFSIZE ];
+	PageId pageNoArray[ BUFFEREDNONLEAFSIZE + 1 ];
 
   /**
-   * BTreeIndex Constructor. 
-	 * Check to see if the corresponding index file exists. If so, open the file.
-	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
-   *
-   * @param relationName        Name of file.
-   * @param outIndexName        Return the name of index file.
-   * @param bufMgrIn						Buffer Manager Instance
-   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
-   * @param attrType						Datatype of attribute over which index is built
-   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * Number of inserts in the buffer.
    */
-	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
-	
+	int numMessages;
 
   /**
-   * BTreeIndex Destructor. 
-	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
-	 * and delete file instance thereby closing the index file.
-	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself. 
-	 * */
-	~BTreeIndex();
+   * Inserts bound for the children, in the order they arrived.
+   */
+	BufferedMessage messages[ BUFFERSIZE ];
+};
 
+static_assert( sizeof( BufferedNonLeafNode ) <= Page::SIZE, "Buffered node does not fit a page" );
 
-  /**
-	 * Insert a new entry using the pair <value,rid>. 
-	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
-	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
-	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
+/*
+STRING keys vary in length, so STRING nodes are slotted: an array of fixed size slots grows from the
+front of the page and the key bytes grow from its end. The prefix shared by all keys of a node is stored
+once, in the last prefixLength bytes of the page, and each slot points to the rest of its key. In non-leaf
+nodes the separators are cut to the shortest prefix that still tells the two leaves next to them apart.
+Key i of a node is the prefix followed by the slotArray[i].length bytes at offset slotArray[i].offset.
+*/
+
+/**
+ * @brief Slot of a STRING leaf.
+*/
+struct StringLeafSlot{
+	unsigned short offset;		//of the key bytes after the prefix, from the start of the page
+	unsigned short length;
+	RecordId rid;
+};
+
+/**
+ * @brief Slot of a STRING non-leaf.
+*/
+struct StringNonLeafSlot{
+	unsigned short offset;		//of the key bytes after the prefix, from the start of the page
+	unsigned short length;
+	PageId pageNo;			//child right of the key
+};
+
+/**
+ * @brief Maximum number of slots in B+Tree leaf for STRING key.
+ */
+//                                                         numKeys, prefixLength, heapBegin          sibling ptrs                        slot
+const int STRINGLEAFSLOTS = ( Page::SIZE - sizeof( int ) - 2 * sizeof( unsigned short ) - 2 * sizeof( PageId ) ) / sizeof( StringLeafSlot );
+
+/**
+ * @brief Maximum number of slots in B+Tree non-leaf for STRING key.
+ */
+//                                                            level, numKeys, prefixLength, heapBegin      firstPageNo                    slot
+const int STRINGNONLEAFSLOTS = ( Page::SIZE - 2 * sizeof( int ) - 2 * sizeof( unsigned short ) - sizeof( PageId ) ) / sizeof( StringNonLeafSlot );
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type.
+*/
+struct NonLeafNodeString{
+  /**
+   * Level of the node in the tree.
+   */
+	int level;
+
+  /**
+   * Number of keys in use.
+   */
+	int numKeys;
+
+  /**
+   * Length of the prefix shared by all keys, stored at the end of the page.
+   */
+	unsigned short prefixLength;
+
+  /**
+   * Offset of the first byte in use by the keys. The space between the slots and this offset is free.
+   */
+	unsigned short heapBegin;
+
+  /**
+   * Page number of the child left of the first key, 0 for the root of an empty tree.
+   */
+	PageId firstPageNo;
+
+  /**
+   * Slots of the keys in use, the rest of the page holds the key bytes.
+   */
+	StringNonLeafSlot slotArray[ STRINGNONLEAFSLOTS ];
+};
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+*/
+struct LeafNodeString{
+  /**
+   * Number of <key, rid> entries in use.
+   */
+	int numKeys;
+
+  /**
+   * Length of the prefix shared by all keys, stored at the end of the page.
+   */
+	unsigned short prefixLength;
+
+  /**
+   * Offset of the first byte in use by the keys. The space between the slots and this offset is free.
+   */
+	unsigned short heapBegin;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Slots of the entries in use, the rest of the page holds the key bytes.
+   */
+	StringLeafSlot slotArray[ STRINGLEAFSLOTS ];
+};
+
+static_assert( sizeof( NonLeafNodeString ) <= Page::SIZE && sizeof( LeafNodeString ) <= Page::SIZE, "STRING node does not fit a page" );
+
+/*
+An INTEGER index can keep posting lists in its leaves instead, for attributes with few distinct values.
+Each distinct key has one slot with the number of its entries and the list of their RecordIds, sorted by
+page and slot number. Each RecordId is stored as the varint of its distance from the one before it, both
+read as page_number << 16 | slot_number. A list of up to POSTINGINLINESIZE bytes lies in the heap at the
+end of the leaf, a longer one in a chain of overflow pages of its own. Each overflow page starts from 0
+again, so an append to a long list rewrites just its last page. All entries of a key are in one leaf, the
+separators of the non-leaves, which are those of any INTEGER index, always fall between distinct keys.
+*/
+
+/**
+ * @brief Slot of a posting list leaf.
+*/
+struct PostingSlot{
+	int key;
+	unsigned short offset;		//of the inline list, from the start of the page
+	unsigned short length;		//of the inline list, 0 if the list is in overflow pages
+	int numRids;
+	PageId overflowPageNo;		//first overflow page of the list, 0 if it is inline
+};
+
+/**
+ * @brief Maximum number of slots in a posting list leaf.
+ */
+//                                                          numKeys, heapBegin, unused          sibling ptrs                     slot
+const int POSTINGLEAFSLOTS = ( Page::SIZE - sizeof( int ) - 2 * sizeof( unsigned short ) - 2 * sizeof( PageId ) ) / sizeof( PostingSlot );
+
+/**
+ * @brief Size in bytes above which a posting list moves from its leaf to overflow pages, a quarter of a page so
+ * that a leaf always holds several lists.
+ */
+const int POSTINGINLINESIZE = Page::SIZE / 4;
+
+/**
+ * @brief Structure for the leaves of an INTEGER index with posting lists.
+*/
+struct PostingLeafNode{
+  /**
+   * Number of distinct keys in use.
+   */
+	int numKeys;
+
+  /**
+   * Offset of the first byte in use by the inline lists. The space between the slots and this offset is free.
+   */
+	unsigned short heapBegin;
+
+	unsigned short unused;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Slots of the keys in use, the rest of the page holds the inline lists.
+   */
+	PostingSlot slotArray[ POSTINGLEAFSLOTS ];
+};
+
+/**
+ * @brief Number of bytes of RecordIds an overflow page of a posting list holds.
+ */
+//                                                      lastRid                  nextPageNo, numRids, length
+const int POSTINGOVERFLOWSIZE = Page::SIZE - sizeof( unsigned long long ) - sizeof( PageId ) - 2 * sizeof( int );
+
+/**
+ * @brief Structure for an overflow page of a posting list.
+*/
+struct PostingOverflowPage{
+  /**
+   * The last RecordId on this page, as page_number << 16 | slot_number.
+   */
+	unsigned long long lastRid;
+
+  /**
+   * Page number of the next page of the list, 0 for the last one.
+   */
+	PageId nextPageNo;
+
+  /**
+   * Number of RecordIds and of their bytes on this page.
+   */
+	int numRids;
+	int length;
+
+	char bytes[ POSTINGOVERFLOWSIZE ];
+};
+
+static_assert( sizeof( PostingLeafNode ) <= Page::SIZE && sizeof( PostingOverflowPage ) <= Page::SIZE, "Posting list page does not fit a page" );
+
+/**
+ * @brief One posting list, to pass it to the functions that rewrite the posting list leaves: the key, the number of its
+ * RecordIds and either the encoded list or the first of its overflow pages.
+*/
+class PostingList{
+public:
+	int key;
+	int numRids;
+	PageId overflowPageNo;
+	std::string bytes;
+};
+
+/**
+ * @brief The node structures for keys of type T.
+*/
+template <class T>
+struct NodeTypes{
+	typedef LeafNode<T> Leaf;
+	typedef NonLeafNode<T> NonLeaf;
+};
+
+template <>
+struct NodeTypes<std::string>{
+	typedef LeafNodeString Leaf;
+	typedef NonLeafNodeString NonLeaf;
+};
+
+
+class BTreeIndex;
+class IndexCursor;
+
+/**
+ * @brief The operations of BTreeIndex and IndexCursor that depend on the key type. The index picks the
+ * table for its attribute type once, when it is opened, so no operation switches on the type again.
+*/
+struct KeyTypeOps{
+	void (BTreeIndex::*initRoot)(Page* rootPage);
+	void (BTreeIndex::*bulkLoad)(const std::string & relationName, double fillFactor);
+	void (BTreeIndex::*insertRelation)(const std::string & relationName);
+	void (BTreeIndex::*insertEntry)(const void* key, const RecordId rid);
+	bool (BTreeIndex::*deleteEntry)(const void* key, const RecordId rid);
+	bool (BTreeIndex::*lookup)(const void* key, std::vector<RecordId>& outRids);
+	void (IndexCursor::*startScan)(const void* lowVal, const void* highVal);
+	bool (IndexCursor::*tryScanNext)(RecordId& outRid);
+	size_t (IndexCursor::*scanNextBatch)(RecordId* outRids, size_t maxRids);
+	size_t (BTreeIndex::*parallelScan)(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			int numThreads, const ScanBatchCallback& callback);
+	void (BTreeIndex::*mergeDelta)();
+};
+
+/**
+ * @brief IndexCursor class. It holds the position of one scan over a BTreeIndex and keeps the leaf it is
+ * positioned on pinned. Any number of cursors can be open over the same index at the same time, e.g. for the
+ * inner and outer side of a nested-loop join. All cursors must be ended or destroyed before the index is.
+*/
+class IndexCursor {
+
+	friend class BTreeIndex;
+
+ private:
+
+  /**
+   * Index being scanned.
+   */
+	BTreeIndex	*index;
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * Index one past the last entry of the current leaf that lies inside the scan range.
+   */
+	int			lastEntry;
+
+  /**
+   * Page number of current page being scanned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current Page being scanned.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * Low DOUBLE value for scan.
+   */
+	double	lowValDouble;
+
+  /**
+   * Low STRING value for scan.
+   */
+	std::string	lowValString;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * High DOUBLE value for scan.
+   */
+	double	highValDouble;
+
+  /**
+   * High STRING value for scan.
+   */
+	std::string highValString;
+	
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+   * Direction of the scan. A DESCENDING scan consumes the slice from lastEntry down to nextEntry.
+   */
+	ScanDirection	direction;
+
+  /**
+   * Concurrent index only: the entries of the current leaf inside the scan range, copied while the
+   * leaf was latched. nextEntry and lastEntry index this instead of the leaf, which stays pinned
+   * but is not latched between calls. An index with posting lists decodes the lists into this.
+   */
+	std::vector<RecordId>	leafRids;
+
+  /**
+   * Concurrent index and posting lists only: leaf the scan continues on once leafRids is used up, read
+   * from the current leaf together with leafRids. 0 if the scan is completed then.
+   */
+	PageId	nextPageNum;
+
+  /**
+   * Index with a delta or buffers only: the entries of the delta, or the buffered inserts, inside the scan
+   * range of an INTEGER, DOUBLE or STRING key, copied when the scan started. The scan merges them with the
+   * entries of the leaves.
+   */
+	std::vector<RIDKeyPair<int> >	deltaSliceInt;
+	std::vector<RIDKeyPair<double> >	deltaSliceDouble;
+	std::vector<RIDKeyPair<std::string> >	deltaSliceString;
+
+  /**
+   * Index with a delta or buffers only: the part [deltaNext, deltaLast) of the delta slice not returned yet.
+   */
+	size_t	deltaNext;
+	size_t	deltaLast;
+
+// -----------------------------------------------------------------------------
+// IndexCursor::lowVal, IndexCursor::highVal
+// The scan bounds for keys of type T: lowValInt, lowValDouble or lowValString
+// and their high counterparts
+// -----------------------------------------------------------------------------
+	template <class T> T& lowVal();
+	template <class T> T& highVal();
+// -----------------------------------------------------------------------------
+// IndexCursor::startScanOfType
+// Copy the scan bounds and pin the leaf the scan starts on, the part of
+// startScan() that depends on the key type, and on the non-leaf type for a
+// buffered index
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	void startScanOfType(const void* lowValParm, const void* highValParm);
+// -----------------------------------------------------------------------------
+// IndexCursor::setLeafSlice
+// Compute the slice [nextEntry, lastEntry) of the current leaf that lies
+// inside the scan range
+// -----------------------------------------------------------------------------
+	template <class T>
+	void setLeafSlice();
+// -----------------------------------------------------------------------------
+// IndexCursor::moveToNextLeaf
+// Release the current leaf and continue the scan on its right sibling, or on
+// its left sibling for a DESCENDING scan
+// @return: false if the bound the scan moves towards lies in the current leaf
+//	    or there is no sibling, the scan is completed then
+// -----------------------------------------------------------------------------
+	template <class T>
+	bool moveToNextLeaf();
+// -----------------------------------------------------------------------------
+// IndexCursor::tryScanNextOfType, IndexCursor::scanNextBatchOfType
+// tryScanNext() and scanNextBatch() for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T>
+	bool tryScanNextOfType(RecordId& outRid);
+	template <class T>
+	size_t scanNextBatchOfType(RecordId* outRids, size_t maxRids);
+// -----------------------------------------------------------------------------
+// IndexCursor::copyLeafSlice
+// Concurrent index: copy the slice of the current leaf, which is latched
+// shared, to leafRids and note the leaf the scan continues on, then release
+// the latch
+// -----------------------------------------------------------------------------
+	template <class T>
+	void copyLeafSlice();
+// -----------------------------------------------------------------------------
+// IndexCursor::moveToNextLeafConcurrent
+// moveToNextLeaf() for a concurrent index
+// -----------------------------------------------------------------------------
+	template <class T>
+	bool moveToNextLeafConcurrent();
+// -----------------------------------------------------------------------------
+// IndexCursor::startScanConcurrent, IndexCursor::tryScanNextConcurrent,
+// IndexCursor::scanNextBatchConcurrent
+// The scan of a concurrent index, for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T>
+	void startScanConcurrent(const void* lowValParm, const void* highValParm);
+	template <class T>
+	bool tryScanNextConcurrent(RecordId& outRid);
+	template <class T>
+	size_t scanNextBatchConcurrent(RecordId* outRids, size_t maxRids);
+// -----------------------------------------------------------------------------
+// IndexCursor::copyPostingSlice
+// Posting lists: decode the lists of the current leaf inside the scan range
+// to leafRids and note the leaf the scan continues on, as copyLeafSlice()
+// -----------------------------------------------------------------------------
+	void copyPostingSlice();
+// -----------------------------------------------------------------------------
+// IndexCursor::moveToNextPostingLeaf
+// moveToNextLeaf() for posting list leaves
+// -----------------------------------------------------------------------------
+	bool moveToNextPostingLeaf();
+// -----------------------------------------------------------------------------
+// IndexCursor::startScanPosting, IndexCursor::tryScanNextPosting,
+// IndexCursor::scanNextBatchPosting
+// The scan of an index with posting lists
+// -----------------------------------------------------------------------------
+	void startScanPosting(const void* lowValParm, const void* highValParm);
+	bool tryScanNextPosting(RecordId& outRid);
+	size_t scanNextBatchPosting(RecordId* outRids, size_t maxRids);
+// -----------------------------------------------------------------------------
+// IndexCursor::startScanBuffered
+// startScan() of a buffered index: copy the buffered inserts of the range
+// into the delta slice, which tryScanNextDelta() and scanNextBatchDelta()
+// merge with the leaves
+// -----------------------------------------------------------------------------
+	void startScanBuffered(const void* lowValParm, const void* highValParm);
+// -----------------------------------------------------------------------------
+// IndexCursor::deltaSlice
+// The delta slice for keys of type T: deltaSliceInt, deltaSliceDouble or
+// deltaSliceString
+// -----------------------------------------------------------------------------
+	template <class T> std::vector<RIDKeyPair<T> >& deltaSlice();
+// -----------------------------------------------------------------------------
+// IndexCursor::nextTreeKey
+// Index with a delta or buffers: the key of the entry of the leaves the scan returns
+// next, moving on to the next leaf if the current one is used up
+// @return: false if the leaves hold no more entries of the scan
+// -----------------------------------------------------------------------------
+	template <class T>
+	bool nextTreeKey(T& key);
+// -----------------------------------------------------------------------------
+// IndexCursor::startScanDelta, IndexCursor::tryScanNextDelta,
+// IndexCursor::scanNextBatchDelta
+// The scan of an index with a delta, for keys of type T: the entries of the
+// leaves merged with the delta slice, an entry of the leaves first on equal
+// keys. currentPageNum is 0 if the tree has no leaf. A buffered index scans
+// with the last two as well.
+// -----------------------------------------------------------------------------
+	template <class T>
+	void startScanDelta(const void* lowValParm, const void* highValParm);
+	template <class T>
+	bool tryScanNextDelta(RecordId& outRid);
+	template <class T>
+	size_t scanNextBatchDelta(RecordId* outRids, size_t maxRids);
+
+ public:
+
+  /**
+   * IndexCursor Constructor. The cursor starts without a scan.
+   * @param indexIn		Index to be scanned
+   */
+	IndexCursor(BTreeIndex *indexIn);
+
+  /**
+   * IndexCursor Destructor. Ends the scan, if one is executing, releasing its leaf.
+   */
+	~IndexCursor();
+
+  /**
+	 * Begin a filtered scan of the index, see BTreeIndex::startScan().
+	 * If this cursor is already executing a scan, that scan is ended here.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @param direction	ASCENDING starts at the low bound and walks right, DESCENDING starts at the high bound and walks left
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+						const ScanDirection direction = ASCENDING);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @return				false if no more records, satisfying the scan criteria, are left to be scanned
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	bool tryScanNext(RecordId& outRid);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Fetch the record ids of up to maxRids next index entries that match the scan, see BTreeIndex::scanNextBatch().
+   * @param outRids	Array that receives the RecordIds, must have room for maxRids entries
+   * @param maxRids	Maximum number of RecordIds to return
+   * @return				Number of RecordIds stored in outRids, 0 once the scan is completed
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	size_t scanNextBatch(RecordId* outRids, size_t maxRids);
+
+  /**
+	 * Terminate the current scan. Unpin the leaf it is positioned on.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+};
+
+
+/**
+ * @brief How a new BTreeIndex is built and which variant of the tree it is. Passed to the BTreeIndex
+ * constructors, every field starts at its default and is set by name, e.g.
+ * IndexOptions options; options.bulkLoad = true; options.fillFactor = 0.7;
+*/
+struct IndexOptions{
+  /**
+   * If true, a new index is built bottom-up from the sorted <key, rid> pairs of the relation instead of one insertEntry per pair.
+   */
+	bool bulkLoad;
+
+  /**
+   * Fraction of the key slots filled in each node written by the bulk load, clamped to (0, 1].
+   */
+	double fillFactor;
+
+  /**
+   * If true, a new index keeps a Bloom filter over its keys for lookup(), sized from the number of records of the relation.
+   * An existing index keeps whatever it was created with.
+   */
+	bool useBloomFilter;
+
+  /**
+   * Fraction of the entries a node keeps when an insert at its end splits it, clamped to [0.5, 0.99]. Other splits divide the node evenly.
+   */
+	double appendSplitRatio;
+
+  /**
+   * If true, the index may be used by several threads at once, see the BTreeIndex class. INTEGER and DOUBLE keys only.
+   */
+	bool concurrent;
+
+  /**
+   * If true, the leaves keep one posting list per distinct key, see PostingLeafNode. INTEGER keys only, not concurrent.
+   */
+	bool postingLists;
+
+  /**
+   * If true, inserts collect in buffers in the non-leaves and reach the leaves in batches, see BufferedNonLeafNode.
+   * INTEGER keys only, not concurrent and without posting lists.
+   */
+	bool buffered;
+
+  /**
+   * If not 0, inserts go to a sorted in-memory delta first, which is merged into the tree in key order once its entries
+   * take deltaMemory bytes, by mergeDelta() or by the destructor. Lookups, deletes and scans see the delta and the tree
+   * together. Not for a concurrent or buffered index or one with posting lists. Entries the destructor cannot merge
+   * are kept in pages of the index file, and the next open of the index inserts them again.
+   */
+	size_t deltaMemory;
+
+	IndexOptions()
+		: bulkLoad(false), fillFactor(1.0), useBloomFilter(true), appendSplitRatio(APPENDSPLITRATIO),
+		concurrent(false), postingLists(false), buffered(false), deltaMemory(0)
+	{
+	}
+};
+
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation, or on several as a composite index whose keys are CompositeKey objects. The startScan()/scanNext()/endScan() methods drive one built-in scan;
+ * more scans can run at the same time through IndexCursor objects.
+ * A concurrent index may be used by several threads at once: insertEntry(), deleteEntry(), lookup()
+ * and the scans of IndexCursor objects, one per thread, latch a node only while they change it or
+ * read a leaf, as in a B-link tree. The non-leaves are read optimistically, checking a version
+ * instead of taking a latch. The built-in scan remains for a single thread.
+*/
+class BTreeIndex {
+
+	friend class IndexCursor;
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+   * Read without a latch by the descents of a concurrent index, changed only by the thread that holds the old root latched.
+   */
+	std::atomic<PageId>	rootPageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records. 
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Attributes of a composite index, whose attributeType is COMPOSITE. Empty for any other index.
+   */
+	std::vector<KeyAttribute>	keyAttributes;
+
+  /**
+   * Longest char string key in bytes: COMPOSITEKEYSIZE for a composite index, STRINGSIZE for any other.
+   */
+	int			keySize;
+
+  /**
+   * Operations for the key type of the index, chosen when the index is opened.
+   */
+	const KeyTypeOps	*keyOps;
+
+  /**
+   * Number of keys in leaf node, depending upon the type of key. For STRING keys the number of slots, an upper bound.
+   */
+	int			leafOccupancy;
+
+  /**
+   * Number of keys in non-leaf node, depending upon the type of key. For STRING keys the number of slots, an upper bound.
+   */
+	int			nodeOccupancy;
+
+  /**
+   * Page number of the rightmost leaf, 0 if not known yet. An insert of a key not below
+   * the last key of this leaf goes straight to it without descending the tree.
+   */
+	PageId	rightmostLeafPageNum;
+
+  /**
+   * Fraction of the entries a node keeps when the entry causing the split goes at its end.
+   */
+	double	appendSplitRatio;
+
+  /**
+   * True if the index may be used by several threads at once. Its operations then latch the nodes they
+   * visit and deletes leave nodes under-full instead of merging them.
+   */
+	bool		concurrent;
+
+  /**
+   * True if the leaves hold posting lists, see PostingLeafNode.
+   */
+	bool		postingLists;
+
+  /**
+   * True if the non-leaves buffer inserts, see BufferedNonLeafNode.
+   */
+	bool		buffered;
+
+
+	// MEMBERS SPECIFIC TO THE DELTA
+
+  /**
+   * Bytes of memory the delta may take before it is merged into the tree, 0 if the index has no delta.
+   */
+	size_t	deltaMemory;
+
+  /**
+   * Bytes of memory the entries in the delta take, counted as in deltaEntrySize().
+   */
+	size_t	deltaBytes;
+
+  /**
+   * Entries inserted but not merged into the tree yet, sorted by key, of an INTEGER, DOUBLE or STRING key.
+   * Entries of equal keys stay in the order they were inserted.
+   */
+	std::multimap<int, RecordId>	deltaInt;
+	std::multimap<double, RecordId>	deltaDouble;
+	std::multimap<std::string, RecordId>	deltaString;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * Cursor behind startScan(), scanNext() and endScan(). Other scans run next to it through their own IndexCursor.
+   */
+	IndexCursor	scanCursor;
+
+
+	// MEMBERS SPECIFIC TO POINT LOOKUPS
+
+  /**
+   * In-memory copy of the Bloom filter, empty if the index has none.
+   * Written back to its pages by the destructor.
+   */
+	std::vector<unsigned char>	bloomFilter;
+
+  /**
+   * First page of the Bloom filter.
+   */
+	PageId		bloomPageNum;
+
+  /**
+   * Number of hash functions of the Bloom filter.
+   */
+	int			bloomNumHashes;
+
+  /**
+   * Number of lookups answered by the Bloom filter without descending the tree.
+   */
+	std::atomic<int>	bloomFilterSkips;
+
+
+	// MEMBERS SPECIFIC TO THE HOT NODES
+
+  /**
+   * Non-leaf nodes read on the way down to a leaf, kept pinned in the buffer pool until the index is closed so that
+   * the clock never evicts them. Each takes a frame reserved with BufMgr::reserveFrame(), so that the hot nodes of
+   * all indexes on the buffer pool take at most HOTNODEFRACTION of it.
+   */
+	std::map<PageId, Page*>	hotNodes;
+
+  /**
+   * Hot nodes changed by inserts and deletes since they were pinned, written back when the index is closed.
+   */
+	std::set<PageId>	dirtyHotNodes;
+
+  /**
+   * Set once a node could not join the hot nodes, no node joins them after that. A node pinned outside of them
+   * is then never taken for a hot node when it is released.
+   */
+	bool	hotNodesFull;
+
+  /**
+   * Guards hotNodes against concurrent descents and the workers of parallelScan(). Hits only share it.
+   */
+	Latch	hotNodeLatch;
+
+  /**
+   * Number of non-leaf reads that found the node among the hot nodes, that did not and kept it, and that did not
+   * and could not keep it because the hot nodes were full.
+   */
+	std::atomic<int>	hotNodeHits;
+	std::atomic<int>	hotNodeMisses;
+	std::atomic<int>	hotNodeCapMisses;
+
+	
+ public:
+
+  /**
+   * BTreeIndex Constructor. 
+	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * If not, create it and insert entries for every tuple in the base relation, in key order. The pages of the
+	 * relation are read and their pairs sorted by several threads, see extractPairs().
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @param options							How a new index is built and which variant it is, see IndexOptions
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type, posting lists, buffers etc.) do not match with values received through constructor parameters, or a concurrent index, posting lists, buffers or a delta are asked for on an attribute type or an index that does not support them.
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const IndexOptions& options = IndexOptions());
+
+
+  /**
+   * BTreeIndex Constructor for an index on several attributes, named after the relation and the offsets of the attributes.
+	 * The keys of a composite index are passed to its methods as CompositeKey::data(). An index on a single attribute
+	 * is the same as one made by the constructor above.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attributes					Attributes the keys are made of, in order, at most MAXKEYATTRIBUTES
+   * @param options							As for the constructor above. A composite index cannot be concurrent, buffered or have posting lists.
+   * @throws  BadIndexInfoException     If the index file already exists but its metapage does not match the parameters, if
+	 *						there are no or too many attributes, a concurrent index is asked for on other than a single INTEGER or DOUBLE attribute,
+	 *						posting lists or buffers on other than a single INTEGER attribute, or a delta for a concurrent, buffered or posting list index.
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const std::vector<KeyAttribute>& attributes,
+						const IndexOptions& options = IndexOptions());
+	
+
+  /**
+   * BTreeIndex Destructor. 
+	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+	 * and delete file instance thereby closing the index file. A delta that cannot be merged, e.g. for lack of
+	 * frames, is written to DeltaPage pages instead; only if that fails too are its entries lost, which is
+	 * reported on std::cerr.
+	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself. 
+	 * */
+	~BTreeIndex();
+
+
+  /**
+	 * Insert a new entry using the pair <value,rid>. 
+	 * Start from root to find out the leaf to insert the entry in, keeping the nodes a split can reach pinned. The insertion may cause splitting of leaf node.
+	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
+	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
 	 * Make sure to unpin pages as soon as you can.
    * @param key			Key to insert, pointer to integer/double/char string
    * @param rid			Record ID of a record whose entry is getting inserted into the index.
@@ -331,6 +1488,69 @@ class BTreeIndex {
 	const void insertEntry(const void* key, const RecordId rid);
 
 
+  /**
+	 * Delete the entry <key, rid>.
+	 * Start from root to find the leaf holding the entry, keeping the nodes on the way pinned. A node left less than
+	 * half full merges with a sibling, or takes entries over from it if both do not fit one node. This may continue all
+	 * the way up to the root, and a root left with a single child hands over to it. Freed pages are reused by later splits.
+	 * Must not be called while a scan of the index or of any IndexCursor is executing.
+	 * A concurrent index only removes the entry from its leaf, so that it can run next to other threads.
+   * @param key			Key of the entry, pointer to integer/double/char string
+   * @param rid			Record ID of the entry
+   * @return				false if there is no such entry
+	**/
+	const bool deleteEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Find all entries with the given key, without starting a scan.
+	 * If the index has a Bloom filter, a key that was never inserted is usually rejected
+	 * by the filter without reading a single node of the tree.
+	 * The scan of the index and of any IndexCursor is not disturbed.
+   * @param key			Key to look up, pointer to integer/double/char string
+   * @param outRids	RecordIds of the matching entries are appended to this
+   * @return				true if at least one entry was found
+	**/
+	const bool lookup(const void* key, std::vector<RecordId>& outRids);
+
+
+  /**
+	 * Number of lookup() calls answered by the Bloom filter alone since the index was opened.
+	**/
+	const int getBloomFilterSkips() const { return bloomFilterSkips; }
+
+
+  /**
+	 * Number of non-leaf nodes read on the way down to a leaf by lookups, scans, inserts and deletes that were
+	 * already pinned among the hot nodes, since the index was opened.
+	**/
+	const int getHotNodeHits() const { return hotNodeHits; }
+
+
+  /**
+	 * Number of non-leaf nodes read on the way down to a leaf that were not among the hot nodes yet. Each
+	 * node misses once, unless the hot nodes of all indexes fill HOTNODEFRACTION of the buffer pool.
+	**/
+	const int getHotNodeMisses() const { return hotNodeMisses; }
+
+
+  /**
+	 * Number of non-leaf nodes read on the way down to a leaf that were not among the hot nodes and did not
+	 * join them, because the hot nodes of all indexes already filled HOTNODEFRACTION of the buffer pool. These are read
+	 * from the pool on every descent.
+	**/
+	const int getHotNodeCapMisses() const { return hotNodeCapMisses; }
+
+
+  /**
+	 * Merge the entries of the delta into the tree in key order, as one sorted batch. The batch is
+	 * bulk loaded if the tree is empty, otherwise consecutive inserts meet the same leaves and keys
+	 * past the last leaf take the append path. Does nothing for an index without a delta.
+	 * Must not be called while a scan of the index or of any IndexCursor is executing.
+	**/
+	void mergeDelta();
+
+
   /**
 	 * Begin a filtered scan of the index.  For instance, if the method is called 
 	 * using ("a",GT,"d",LTE) then we should seek all entries with a value 
@@ -338,20 +1558,33 @@ class BTreeIndex {
 	 * If another scan is already executing, that needs to be ended here.
 	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
 	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+	 * A DESCENDING scan starts from the leaf holding the high bound instead and returns the entries from the highest key down.
    * @param lowVal	Low value of range, pointer to integer / double / char string
    * @param lowOp		Low operator (GT/GTE)
    * @param highVal	High value of range, pointer to integer / double / char string
    * @param highOp	High operator (LT/LTE)
+   * @param direction	ASCENDING or DESCENDING
    * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
    * @throws  BadScanrangeException If lowVal > highval
 	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
 	**/
-	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+						const ScanDirection direction = ASCENDING);
 
 
   /**
 	 * Fetch the record id of the next index entry that matches the scan.
 	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @return				false if no more records, satisfying the scan criteria, are left to be scanned
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	bool tryScanNext(RecordId& outRid);
+
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+	 * Same as tryScanNext(), reporting the end of the scan with an exception.
    * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
@@ -359,13 +1592,469 @@ class BTreeIndex {
 	const void scanNext(RecordId& outRid);  // returned record id
 
 
+  /**
+	 * Fetch the record ids of up to maxRids next index entries that match the scan.
+	 * The qualifying slice of each leaf is computed once from the scan bounds and copied out in one go,
+	 * moving on to the right sibling while there is room left in outRids and the high bound has not been reached.
+   * @param outRids	Array that receives the RecordIds, must have room for maxRids entries
+   * @param maxRids	Maximum number of RecordIds to return
+   * @return				Number of RecordIds stored in outRids, 0 once the scan is completed
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	size_t scanNextBatch(RecordId* outRids, size_t maxRids);
+
+
   /**
 	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	**/
 	const void endScan();
 
+
+  /**
+	 * Scan a range with several threads. The separators of the upper index levels split [lowVal, highVal]
+	 * into up to numThreads disjoint sub-ranges, and each worker thread scans one of them, in ascending order,
+	 * with its own IndexCursor. The built-in scan is not affected. For a concurrent index the workers may run
+	 * alongside other threads; for any other index no thread may change it meanwhile.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @param numThreads	Maximum number of worker threads
+   * @param callback	Receives each batch a worker fetches, must not throw
+   * @return				Number of RecordIds passed to callback
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	size_t parallelScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			int numThreads, const ScanBatchCallback& callback);
+
 //Helper Methods:
+// -----------------------------------------------------------------------------
+// BTreeIndex::keyTypeOps
+// The table of the operations for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T>
+	static const KeyTypeOps* keyTypeOps();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::concurrentKeyTypeOps
+// The table of the operations of a concurrent index for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T>
+	static const KeyTypeOps* concurrentKeyTypeOps();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::postingKeyTypeOps
+// The table of the operations of an index with posting lists
+// -----------------------------------------------------------------------------
+	static const KeyTypeOps* postingKeyTypeOps();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bufferedKeyTypeOps
+// The table of the operations of a buffered index
+// -----------------------------------------------------------------------------
+	static const KeyTypeOps* bufferedKeyTypeOps();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deltaKeyTypeOps
+// The table of the operations of an index with a delta for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T>
+	static const KeyTypeOps* deltaKeyTypeOps();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::recordKey
+// The key of a record as pointer to integer / double / char string: its attribute,
+// or the encoded attributes of a composite index, which are built in composite
+// -----------------------------------------------------------------------------
+	const void* recordKey(const std::string& record, CompositeKey& composite) const;
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::initRootOfType
+// Set up the root page of a new index as an empty level 1 node
+// @param rootPage: the root page, pinned
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	void initRootOfType(Page* rootPage);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bulkLoadOfType
+// Build the tree bottom-up: extract all <key, rid> pairs of the relation, sort
+// them and write leaves, then each non-leaf level, from left to right.
+// No node is ever split. The top level is written into the root page.
+// @param relationName: the base relation to be indexed
+// @param fillFactor:   fraction of the key slots used in every written node
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	void bulkLoadOfType(const std::string & relationName, double fillFactor);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::loadSortedPairs
+// The part of the bulk load after the extraction: write the leaves and the
+// non-leaf levels of an empty tree from sorted pairs
+// @param pairs:      the pairs, sorted by key
+// @param fillFactor: fraction of the key slots used in every written node
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	void loadSortedPairs(const std::vector<RIDKeyPair<T> >& pairs, double fillFactor);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::buildNonLeafLevels
+// The part of the bulk load above the leaves: write each non-leaf level from
+// left to right until a single node is left, which goes into the root page
+// @param level: <first key, pageNo> of each leaf, used up
+// @param fillFactor: fraction of the key slots used in every written node
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	void buildNonLeafLevels(std::vector<PageKeyPair<T> >& level, double fillFactor);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertRelationOfType
+// Build the index without the bulk load: insert the pairs extractPairs()
+// collects one by one, in key order
+// @param relationName: the base relation to be indexed
+// -----------------------------------------------------------------------------
+	template <class T>
+	void insertRelationOfType(const std::string & relationName);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::extractPairs
+// Collect the sorted <key, rid> pairs of all records of the relation for the
+// bulk load or insertRelationOfType(), adding their keys to the Bloom filter. The pages of the relation
+// are split among BUILDTHREADS or more threads that each extract and sort the
+// pairs of their pages, the sorted runs are then merged.
+// @param relationName: the base relation to be indexed
+// @param pairs:        receives the pairs
+// -----------------------------------------------------------------------------
+	template <class T>
+	void extractPairs(const std::string & relationName, std::vector<RIDKeyPair<T> >& pairs);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntryOfType, BTreeIndex::lookupOfType
+// insertEntry() and lookup() for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T>
+	void insertEntryOfType(const void* key, const RecordId rid);
+	template <class T>
+	bool lookupOfType(const void* key, std::vector<RecordId>& outRids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntryOfType
+// deleteEntry() for keys of type T. Shrinks the tree from the root after the
+// entry is gone.
+// -----------------------------------------------------------------------------
+	template <class T>
+	bool deleteEntryOfType(const void* key, const RecordId rid);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteFromSubtree
+// Delete the entry <key, rid> below a non-leaf node. Duplicates of the key may
+// lie in any child from the first one that can hold it to the one the descent
+// for key takes, these are tried from left to right.
+// @param pageId: the pageNo of the node
+// @return: false if the entry is not in the subtree
+// -----------------------------------------------------------------------------
+	template <class T>
+	bool deleteFromSubtree(PageId pageId, const T& key, const RecordId& rid);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::rebalanceChild
+// After a delete below child idx of node: if the child is less than half full,
+// merge it with its left sibling (the right one for the first child), or move
+// entries over from the sibling if both do not fit one node
+// @param node: the parent, pinned
+// @param idx: index of the child
+// -----------------------------------------------------------------------------
+	template <class T>
+	void rebalanceChild(typename NodeTypes<T>::NonLeaf* node, int idx);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntryConcurrent, BTreeIndex::deleteEntryConcurrent,
+// BTreeIndex::lookupConcurrent
+// insertEntry(), deleteEntry() and lookup() of a concurrent index
+// -----------------------------------------------------------------------------
+	template <class T>
+	void insertEntryConcurrent(const void* key, const RecordId rid);
+	template <class T>
+	bool deleteEntryConcurrent(const void* key, const RecordId rid);
+	template <class T>
+	bool lookupConcurrent(const void* key, std::vector<RecordId>& outRids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertIntoParents
+// Absorb the split of a child into the pinned parents of an insert path,
+// bottom-up, splitting them in turn and growing a new root if needed.
+// Releases the nodes of the path.
+// @param path: the pinned nodes, root side first, the last one the parent
+// @param newPageId: the new right node of the split, 0 if there was none
+// @param newChildKey: its separator
+// -----------------------------------------------------------------------------
+	template <class T>
+	void insertIntoParents(std::vector<PathEntry>& path, PageId newPageId, T& newChildKey);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bulkLoadPosting, BTreeIndex::insertEntryPosting,
+// BTreeIndex::deleteEntryPosting, BTreeIndex::lookupPosting
+// bulkLoad, insertEntry(), deleteEntry() and lookup() of an index with posting
+// lists. Deletes leave the leaves under-full instead of merging them.
+// -----------------------------------------------------------------------------
+	void bulkLoadPosting(const std::string & relationName, double fillFactor);
+	void insertEntryPosting(const void* key, const RecordId rid);
+	bool deleteEntryPosting(const void* key, const RecordId rid);
+	bool lookupPosting(const void* key, std::vector<RecordId>& outRids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readPostingList
+// Append the RecordIds of a posting list, reading its overflow pages if any
+// -----------------------------------------------------------------------------
+	void readPostingList(const PostingList& list, std::vector<RecordId>& rids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::setPostingList
+// Replace the RecordIds of a posting list. The list stays inline up to
+// POSTINGINLINESIZE bytes; once in overflow pages it stays there, so that a
+// delete never grows a leaf, until it is empty.
+// @param rids: the RecordIds, sorted
+// -----------------------------------------------------------------------------
+	void setPostingList(PostingList& list, const std::vector<RecordId>& rids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::addToPostingList
+// Add a RecordId to a posting list. A RecordId past the end of a list in
+// overflow pages is appended to its last page, any other rewrites the list.
+// -----------------------------------------------------------------------------
+	void addToPostingList(PostingList& list, const RecordId& rid);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::writeOverflowPages
+// Write the RecordIds of a list to its chain of overflow pages, reusing the
+// pages it has, allocating more or freeing the rest
+// -----------------------------------------------------------------------------
+	void writeOverflowPages(PostingList& list, const std::vector<RecordId>& rids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::freeOverflowPages
+// Free a chain of overflow pages
+// @param pageNo: the first page, 0 for none
+// -----------------------------------------------------------------------------
+	void freeOverflowPages(PageId pageNo);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::postingLeafSplit
+// Split a posting list leaf that its lists do not fit anymore, by their bytes
+// @param leaf: the current node that will be split
+// @param pageId: the pageNo of the current node, for the sibling links
+// @param lists: all lists of the node, the changed one included
+// @param append: whether the changed list is a new one at the end of the node
+// @param newPushedUpKey:  return value for adding new key to parent, the first key of the new leaf
+// @param newSplitPageId:  return value for adding new page to parent
+// -----------------------------------------------------------------------------
+	void postingLeafSplit(PostingLeafNode* leaf,
+				   PageId pageId,
+				   const std::vector<PostingList>& lists,
+				   bool append,
+				   int& newPushedUpKey,
+				   PageId& newSplitPageId);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntryBuffered, BTreeIndex::deleteEntryBuffered,
+// BTreeIndex::lookupBuffered
+// insertEntry(), deleteEntry() and lookup() of a buffered index. A delete
+// takes a buffered insert back or removes the entry from its leaf, which is
+// left under-full instead of being merged.
+// -----------------------------------------------------------------------------
+	void insertEntryBuffered(const void* key, const RecordId rid);
+	bool deleteEntryBuffered(const void* key, const RecordId rid);
+	bool lookupBuffered(const void* key, std::vector<RecordId>& outRids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bufferMessages
+// Add inserts to the buffer of a non-leaf. While the buffer holds more than
+// BUFFERSIZE, the inserts bound for the child with most of them move down.
+// @param pageId, page: the non-leaf, pinned, the caller releases it
+// @param incoming: the inserts to add
+// @param splits: receives <separator, pageNo> of the nodes the non-leaf split
+//	  off to its right, for its parent
+// @return: whether the non-leaf changed
+// -----------------------------------------------------------------------------
+	bool bufferMessages(PageId pageId, Page* page, const std::vector<BufferedMessage>& incoming,
+			std::vector<PageKeyPair<int> >& splits);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::pushToChild
+// Move a batch of inserts into child c of a non-leaf, given as its keys and
+// children, adding the children the child split into
+// @param level: the level of the non-leaf
+// @return: whether the non-leaf changed
+// -----------------------------------------------------------------------------
+	bool pushToChild(int level, std::vector<int>& keys, std::vector<PageId>& children, int c,
+			const std::vector<BufferedMessage>& batch);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::applyToLeaf
+// Insert a batch of buffered inserts into a leaf with one write, splitting it
+// into as many leaves as needed
+// @param splits: receives <first key, pageNo> of the new leaves
+// -----------------------------------------------------------------------------
+	void applyToLeaf(PageId pageId, std::vector<BufferedMessage> batch, std::vector<PageKeyPair<int> >& splits);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::storeBufferedNode
+// Write a non-leaf back from its keys, children and buffer, splitting it into
+// as many nodes as its children need
+// @param splits: receives <separator, pageNo> of the nodes split off
+// -----------------------------------------------------------------------------
+	void storeBufferedNode(PageId pageId, BufferedNonLeafNode* node, const std::vector<int>& keys,
+			const std::vector<PageId>& children, const std::vector<BufferedMessage>& messages, std::vector<PageKeyPair<int> >& splits);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::growBufferedRoot
+// Put a new root with an empty buffer above a root that split
+// @param level: the level of the old root
+// @param splits: <separator, pageNo> of the nodes the old root split off
+// -----------------------------------------------------------------------------
+	void growBufferedRoot(int level, const std::vector<PageKeyPair<int> >& splits);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bufferedRange
+// Collect the buffered inserts of [low, high] in a non-leaf and the non-leaves
+// below it, without changing them
+// @param pageId: the non-leaf
+// @param messages: receives the inserts, in no particular order
+// -----------------------------------------------------------------------------
+	void bufferedRange(PageId pageId, int low, int high, std::vector<BufferedMessage>& messages);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bufferedLeaf
+// Descend a buffered index to a leaf without changing it
+// @param upper: if true, the leaf the descent for key takes, otherwise the
+//	  leftmost one that can hold key
+// @return: the pageNo of the leaf, 0 if the tree is empty
+// -----------------------------------------------------------------------------
+	PageId bufferedLeaf(int key, bool upper);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::delta
+// The delta for keys of type T: deltaInt, deltaDouble or deltaString
+// -----------------------------------------------------------------------------
+	template <class T> std::multimap<T, RecordId>& delta();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntryDelta, BTreeIndex::deleteEntryDelta,
+// BTreeIndex::lookupDelta
+// insertEntry(), deleteEntry() and lookup() of an index with a delta, for keys
+// of type T. An insert that fills the delta merges it into the tree.
+// -----------------------------------------------------------------------------
+	template <class T>
+	void insertEntryDelta(const void* key, const RecordId rid);
+	template <class T>
+	bool deleteEntryDelta(const void* key, const RecordId rid);
+	template <class T>
+	bool lookupDelta(const void* key, std::vector<RecordId>& outRids);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::mergeDeltaOfType
+// mergeDelta() for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T>
+	void mergeDeltaOfType();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::parallelScanOfType
+// parallelScan() for keys of type T
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	size_t parallelScanOfType(const void* lowValParm, const Operator lowOp, const void* highValParm, const Operator highOp,
+			int numThreads, const ScanBatchCallback& callback);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::rangeSeparators
+// Collect the separators strictly between low and high, level by level from
+// the root down, until there are maxSeparators of them or the level above the
+// leaves is reached
+// @param separators: receives the separators, sorted and without duplicates
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	void rangeSeparators(const T& low, const T& high, size_t maxSeparators, std::vector<T>& separators);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::descendConcurrent
+// Descend from the root to the node on the given level whose range holds key.
+// The non-leaves are read through the hot nodes without a latch and their
+// version is validated afterwards, a node that changed meanwhile restarts the
+// descent at the root.
+// @param key: the key searched for
+// @param upper: if true, the rightmost node that can hold key, the one an
+//	  insert goes to. Otherwise the leftmost one, where its duplicates start.
+// @param level: 0 for a leaf, 1 for the non-leaves above the leaves and so on
+// @param path: if not NULL, receives the pageNo of the node passed on each
+//	  level above, root first
+// @return: the pageNo of the node, which is neither pinned nor latched. It may
+//	  have split since, moveRight() finds the right node once it is latched.
+//	  0 if the tree has no leaf yet.
+// -----------------------------------------------------------------------------
+	template <class T>
+	PageId descendConcurrent(const T& key, bool upper, int level, std::vector<PageId>* path);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::moveRight
+// Follow the right links from a latched node while key lies beyond the high
+// key, latching the right node before the one left of it is released
+// @param pageId, page: the latched node, replaced by the node key belongs to
+// @param upper: whether a key equal to the high key belongs to the right
+// @param latchMode: the latch held on the nodes
+// @return: the node key belongs to
+// -----------------------------------------------------------------------------
+	template <class Node, class T>
+	Node* moveRight(PageId& pageId, Page*& page, const T& key, bool upper, LatchMode latchMode);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::createBloomFilter
+// Allocate the pages of a new Bloom filter with BLOOMBITSPERKEY bits per
+// record of the relation
+// -----------------------------------------------------------------------------
+	void createBloomFilter(const std::string & relationName);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readBloomFilter, BTreeIndex::writeBloomFilter
+// Copy the Bloom filter from its pages into memory and back
+// -----------------------------------------------------------------------------
+	void readBloomFilter(int numPages);
+	void writeBloomFilter();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::writeDelta
+// Write the entries of the delta to new DeltaPage pages
+// @return: the first of the pages, 0 if the delta is empty
+// -----------------------------------------------------------------------------
+	PageId writeDelta();
+	template <class T>
+	PageId writeDeltaOfType();
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readDelta
+// Insert the entries of the DeltaPage pages written by a destructor that could
+// not merge its delta, then dispose of the pages
+// @param pageNo: the first of the pages
+// -----------------------------------------------------------------------------
+	void readDelta(PageId pageNo);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bloomFilterAdd
+// Set the bits of a key in the Bloom filter, if the index has one
+// @param hash: keyHash() of the key
+// -----------------------------------------------------------------------------
+	void bloomFilterAdd(unsigned int hash);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bloomFilterMayContain
+// @param hash: keyHash() of the key
+// @return: false if the key was certainly never inserted, true if it may have
+//	    been or the index has no Bloom filter
+// -----------------------------------------------------------------------------
+	bool bloomFilterMayContain(unsigned int hash);
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::leafSplit
 // Split the leafNode and return the newly created pageId and key
@@ -374,11 +2063,14 @@ class BTreeIndex {
 // @param newPushedUpKey:  return value for adding new key toparent KeyArraykey
 // @param newSplitPageId:  return value for adding new page parent PageNoArray
 // @param targetPos:	   Posiion in the current that will add the new key
+// @param pageId:	   the pageNo of the current node, for the sibling links
 // -----------------------------------------------------------------------------
 
-	void leafSplit(RIDKeyPair<int> pair, 
-				   LeafNodeInt* node,
-				   int& newPushedUpKey,		//return value for adding new key toparent KeyArraykey
+	template <class T>
+	void leafSplit(RIDKeyPair<T> pair, 
+				   LeafNode<T>* node,
+				   PageId pageId,
+				   T& newPushedUpKey,		//return value for adding new key toparent KeyArraykey
 				   PageId& newSplitPageId,	//return value for adding new page parent PageNoArray
 				   int targetPos); 		//Posiion in the current that will add the new key
 	
@@ -394,49 +2086,96 @@ class BTreeIndex {
 // @PageId childPageId:	   parameter indicate the new created node in the child level
 // -----------------------------------------------------------------------------	
 	
+	template <class T>
 	void nonLeafSplit(
-				   NonLeafNodeInt* node, 	
-				   int& newPushedUpKey,	 	
+				   NonLeafNode<T>* node, 	
+				   T& newPushedUpKey,	 	
 				   PageId& newSplitPageId,	
 				   int targetPos,		
-				   int& childKey,		
+				   T& childKey,		
 				   PageId childPageId);	
 // -----------------------------------------------------------------------------
+// BTreeIndex::stringLeafSplit
+// Split a STRING leaf that its entries do not fit anymore. The separator
+// pushed up is the shortest prefix of the first key of the new leaf that is
+// greater than the last key left behind.
+// @param node: the current node that will be split
+// @param pageId: the pageNo of the current node, for the sibling links
+// @param entries: all entries of the node, the new one included
+// @param append: whether the new entry went at the end of the node
+// @param newPushedUpKey:  return value for adding new key to parent
+// @param newSplitPageId:  return value for adding new page to parent
+// -----------------------------------------------------------------------------
+	void stringLeafSplit(LeafNodeString* node,
+				   PageId pageId,
+				   std::vector<RIDKeyPair<std::string> >& entries,
+				   bool append,
+				   std::string& newPushedUpKey,
+				   PageId& newSplitPageId);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::stringNonLeafSplit
+// Split a STRING non-leaf that its keys do not fit anymore
+// @param node: the current node that will be split
+// @param entries: <key, child right of the key> of the node, the new one included
+// @param append: whether the new key went at the end of the node
+// @param newPushedUpKey:  return value for adding new key to parent
+// @param newSplitPageId:  return value for adding new page to parent
+// -----------------------------------------------------------------------------
+	void stringNonLeafSplit(NonLeafNodeString* node,
+				   std::vector<PageKeyPair<std::string> >& entries,
+				   bool append,
+				   std::string& newPushedUpKey,
+				   PageId& newSplitPageId);
+
+// -----------------------------------------------------------------------------
 // BTreeIndex::initLeaf
 // Create the very first leaf in the current B+ tree
 // @param pair: <key, rid> pair to be added to the first leaf
 // @param node: parent node
 // @param pageId: the pageNo of the parent node
 // -----------------------------------------------------------------------------
-	void initLeaf(RIDKeyPair<int> pair,NonLeafNodeInt* node, PageId pageId);
+	template <class T>
+	void initLeaf(RIDKeyPair<T> pair,NonLeafNode<T>* node, PageId pageId);
 // -----------------------------------------------------------------------------
-// BTreeIndex::findAndInsert
-// Recursive method to traverse down the B+tree to insert the given <key, rid> pair
-// check whether the current leaf node is full 
-// @param pair: <key, rid> pair to be added to the first leaf
-// @param pageId: the pageNo of the parent node
-// @param newChildKey:  return value for adding new key toparent KeyArraykey
-// @param newPageId:  return value for adding new page parent PageNoArray
-// @return: the index of avaliable spot 
+// BTreeIndex::appendToRightmostLeaf
+// Fast path of insertEntry for a key not below any key in the tree
+// @return: false if the rightmost leaf is unknown, full or the key belongs
+//	    further left, then nothing was inserted
+// -----------------------------------------------------------------------------
+	template <class T>
+	bool appendToRightmostLeaf(RIDKeyPair<T> pair);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::splitPoint
+// Number of entries the node keeps out of total when it is split
+// @param total: entries of the full node plus the new one
+// @param append: whether the new entry goes at the end of the node
+// @param maxKeep: upper bound for the result, the new node needs the rest
 // -----------------------------------------------------------------------------
-	void findAndInsert(RIDKeyPair<int> pair,
-				 PageId pageId, 
-				 bool isLeaf, 
-				 int& newChildKey,   	//return value for adding new key to parent KeyArraykey
-				 PageId& newPageId);	//return value for adding new page to parent KeyArraykey
+	int splitPoint(int total, bool append, int maxKeep);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::unpinPath
+// Release the nodes of an insert path, none of which was modified, and empty it
+// @param path: the pinned nodes, root side first
+// -----------------------------------------------------------------------------
+	void unpinPath(std::vector<PathEntry>& path);
 	
 // -----------------------------------------------------------------------------
 // BTreeIndex::checkFull
-// check whether the current leaf node is full 
+// check whether the current leaf node is full, read from the node header
 // @return: the index of avaliable spot 
 // -----------------------------------------------------------------------------
-	int leafCheckFull(LeafNodeInt *node);
+	template <class T>
+	int leafCheckFull(LeafNode<T> *node);
 // -----------------------------------------------------------------------------
 // BTreeIndex::checkFull
-// check whether the current nonLeaf node is full 
+// check whether the current nonLeaf node is full, read from the node header
 // @return: the index of avaliable spot 
 // -----------------------------------------------------------------------------
-	int nonLeafCheckFull(NonLeafNodeInt *node);
+	template <class T>
+	int nonLeafCheckFull(NonLeafNode<T> *node);
 
 // -----------------------------------------------------------------------------
 // BTreeIndex::checkFull
@@ -446,39 +2185,67 @@ class BTreeIndex {
 // 	  of the new Root
 // @return: the index of avaliable spot 
 // -----------------------------------------------------------------------------
-	void createNewRoot(PageId newChildId, int& newKey);
+	template <class T>
+	void createNewRoot(PageId newChildId, T& newKey);
 
 // -----------------------------------------------------------------------------
 // BTreeIndex::findParentOfLeaf
 // Recursive call to find the parent node that contains the leaf which has the
 // key greater than lowVal in its keyArray
 // @param: lowVal: the lowValInt to be searched
+// @param  upper: descend to the last child that may hold lowVal, else to the first
 // @param  currPage: the current Page to be handle
+// @param  parentPageNum: return value for the pageNo of the returned node,
+//	   which is left pinned, release it with unpinHotNode()
 // @return: the child node that contains or its children contain the lowVal 
 // -----------------------------------------------------------------------------
-	NonLeafNodeInt* findParentOfLeaf(int lowVal,PageId currPage);
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	NonLeaf* findParentOfLeaf(const T& lowVal, bool upper, PageId currPage, PageId& parentPageNum);
+// -----------------------------------------------------------------------------
+// BTreeIndex::findLeaf
+// Find the leaf the scan for lowVal starts on. No page is left pinned.
+// @param: lowVal: the lowValInt to be searched
+// @param: upper: true for the last leaf that may hold lowVal, false for the first
+// @return: the pageNo of the leaf, 0 if the tree is empty
+// -----------------------------------------------------------------------------
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	PageId findLeaf(const T& lowVal, bool upper);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::findLeafBound
+// Find the leaf an insert of key goes to. No page is left pinned.
+// @param bound: receives the separator right of the leaf, the smallest key that goes to a leaf further right
+// @param bounded: set to false if there is none, the leaf is the rightmost one
+// @return: the pageNo of the leaf
 // -----------------------------------------------------------------------------
-// BTreeIndex::checkReachHigh
-// check whether the key on the nextEntry is greater than the HighValInt
-// @return: true to continue the main while loop
-// @throw: IndexScanCompletedException()
+	template <class T, class NonLeaf = typename NodeTypes<T>::NonLeaf>
+	PageId findLeafBound(const T& key, T& bound, bool& bounded);
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::pinHotNode
+// Read a non-leaf node on the way down. The first read of a node pins it for
+// good while the hot nodes of all indexes take less than HOTNODEFRACTION of the
+// buffer pool. A hit takes no lock, a miss reads the node without holding one.
+// @param  pageNo: the node to read
+// @return: the node, release it with unpinHotNode()
 // -----------------------------------------------------------------------------
-	bool checkReachHigh();
+	Page* pinHotNode(PageId pageNo);
+
 // -----------------------------------------------------------------------------
-// BTreeIndex::adjustEntry
-// check whether the key on the current nextEntry satisfy the lowVal, 
-// if not increment the nextEntry
-// @return: true to continue the main while loop
+// BTreeIndex::unpinHotNode
+// Release a node read by pinHotNode(). Only a node that did not fit into the hot
+// nodes is unpinned, a hot node that was changed is written back on close.
+// @param  pageNo: the node to release
+// @param  dirty: whether the node was changed
 // -----------------------------------------------------------------------------
-	bool adjustEntry();
+	void unpinHotNode(PageId pageNo, bool dirty = false);
+
 // -----------------------------------------------------------------------------
-// BTreeIndex::checkJumpPage
-// check whether the current page is full, and it is needed to move to the right
-// sibling to continue the sertch
-// @return: true to continue the main while loop
-// @throw: IndexScanCompletedException()
+// BTreeIndex::dropHotNode
+// Forget a node that is about to be disposed. disposePage() clears its frame
+// whatever its pin count.
 // -----------------------------------------------------------------------------
-	bool checkJumpPage();
+	void dropHotNode(PageId pageNo);
 
 	
 };
@@ -96,6 +96,17 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the hash table), without throwing when it is not.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only set if the entry is found
+   * @return  			True if the page entry is found in the hash table
+	 */
+  bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo);
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -6,6 +6,8 @@
  */
 
 #include <memory>
+#include <new>
+#include <cstdlib>
 #include <iostream>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
@@ -21,7 +23,7 @@ namespace badgerdb {
 //----------------------------------------
 
 BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
+	: numBufs(bufs), reservedFrames(0) {
 	bufDescTable = new BufDesc[bufs];
 
   for (FrameId i = 0; i < bufs; i++) 
@@ -30,7 +32,13 @@ BufMgr::BufMgr(std::uint32_t bufs)
   	bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
+  //Frames start on a cache line, so that nodes laid out by cache lines stay on them
+  void* pool;
+  if(posix_memalign(&pool, CACHELINESIZE, bufs * sizeof(Page)) != 0)
+    throw std::bad_alloc();
+  bufPool = (Page*) pool;
+  for (FrameId i = 0; i < bufs; i++)
+    new (&bufPool[i]) Page();
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
@@ -51,14 +59,14 @@ BufMgr::~BufMgr() {
   }
 
   delete [] bufDescTable;
-  delete [] bufPool;
+  free(bufPool);
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::allocBuf(FrameId & frame, std::unique_lock<std::mutex>& lock) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
+  // Called with bufMutex held, no other thread changes the frame table
   std::uint32_t numScanned = 0;
   bool found = 0;
 
@@ -74,6 +82,12 @@ void BufMgr::allocBuf(FrameId & frame)
       break;
     }
 
+    // another thread reads the page in or writes it back
+    if (bufDescTable[clockHand].ioInProgress)
+    {
+      continue;
+    }
+
     // is valid, check referenced bit
     if (! bufDescTable[clockHand].refbit)
     {
@@ -81,8 +95,6 @@ void BufMgr::allocBuf(FrameId & frame)
       if (bufDescTable[clockHand].pinCnt == 0)
       {
         // hasn't been referenced and is not pinned, use it
-        // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
         found = true;
         break;
       }
@@ -101,62 +113,147 @@ void BufMgr::allocBuf(FrameId & frame)
     throw BufferExceededException();
   }
   
+  // other threads move the clock while the lock is released
+  frame = clockHand;
+  BufDesc* tmpbuf = &bufDescTable[frame];
+
   // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
+  // The page stays in the hash table meanwhile, so that a thread reading it waits
+  // for the write instead of reading the old page from the file
+  if (tmpbuf->valid && tmpbuf->dirty)
   {
     bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    tmpbuf->ioInProgress = true;
+    lock.unlock();
+    try
+    {
+      tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[frame]);
+    }
+    catch (...)
+    {
+      // the page stays in its frame, still dirty
+      lock.lock();
+      tmpbuf->ioInProgress = false;
+      ioDone.notify_all();
+      throw;
+    }
+    lock.lock();
   }
 
-	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
+  // remove previous entry from hash table
+  if (tmpbuf->valid)
+  {
+    hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+  }
 
-  // return new frame number
-  frame = clockHand;
+	//Reset all the BufDesc entry for the frame before returning the frame
+  bool wasWritten = tmpbuf->ioInProgress;
+  tmpbuf->Clear();
+  if (wasWritten)
+  {
+    ioDone.notify_all();
+  }
 } // end allocBuf
 
 	
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+void BufMgr::latchFrame(const FrameId frameNo, const LatchMode latchMode)
 {
-  // check to see if it is already in the buffer pool
-  // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
-  FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
+  if (latchMode == LATCH_SHARED)
+    bufDescTable[frameNo].latch.lockShared();
+  else if (latchMode == LATCH_EXCLUSIVE)
+    bufDescTable[frameNo].latch.lockExclusive();
+}
 
-    // set the referenced bit
-    bufDescTable[frameNo].refbit = true;
-    bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
-  }
-  catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
+void BufMgr::unlatchFrame(const FrameId frameNo, const LatchMode latchMode)
+{
+  if (latchMode == LATCH_SHARED)
+    bufDescTable[frameNo].latch.unlockShared();
+  else if (latchMode == LATCH_EXCLUSIVE)
+    bufDescTable[frameNo].latch.unlockExclusive();
+}
+
+	
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, const LatchMode latchMode)
+{
+  FrameId frameNo = 0;
   {
-    // alloc a new frame
-    allocBuf(frameNo);
+    std::unique_lock<std::mutex> lock(bufMutex);
+
+    while (1)
+    {
+      // check to see if it is already in the buffer pool
+      // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
+      if (hashTable->tryLookup(file, pageNo, frameNo))
+      {
+        // being read in or written back, look again once that is done
+        if (bufDescTable[frameNo].ioInProgress)
+        {
+          ioDone.wait(lock);
+          continue;
+        }
+
+        // set the referenced bit
+        bufDescTable[frameNo].refbit = true;
+        bufDescTable[frameNo].pinCnt++;
+        page = &bufPool[frameNo];
+        break;
+      }
+
+      //not in the buffer pool, must allocate a new page
+      // alloc a new frame
+      allocBuf(frameNo, lock);
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+      // another thread may have read the page in while a write-back released the lock,
+      // the new frame stays free then
+      FrameId otherFrameNo;
+      if (hashTable->tryLookup(file, pageNo, otherFrameNo))
+      {
+        continue;
+      }
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+      // set up the entry properly and insert in the hash table, pinned
+      // so that the clock passes it while the page is read without the lock
+      bufDescTable[frameNo].Set(file, pageNo);
+      bufDescTable[frameNo].ioInProgress = true;
+      hashTable->insert(file, pageNo, frameNo);
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+      // read the page into the new frame
+      bufStats.diskreads++;
+      lock.unlock();
+      try
+      {
+        bufPool[frameNo] = file->readPage(pageNo);
+      }
+      catch (...)
+      {
+        lock.lock();
+        hashTable->remove(file, pageNo);
+        bufDescTable[frameNo].Clear();
+        ioDone.notify_all();
+        throw;
+      }
+      lock.lock();
+      bufDescTable[frameNo].ioInProgress = false;
+      ioDone.notify_all();
+      page = &bufPool[frameNo];
+      break;
+    }
   }
+
+  // the pin keeps the page in its frame while the latch is waited for
+  latchFrame(frameNo, latchMode);
 }
 
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, 
-			     const bool dirty) 
+			     const bool dirty, const LatchMode latchMode) 
 {
+  std::lock_guard<std::mutex> guard(bufMutex);
+
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
+  unlatchFrame(frameNo, latchMode);
 
   if (dirty == true) bufDescTable[frameNo].dirty = dirty;
 
@@ -168,11 +265,46 @@ void BufMgr::unPinPage(File* file, const PageId pageNo,
   else bufDescTable[frameNo].pinCnt--;
 }
 
+void BufMgr::unlatchPage(const Page* page, const LatchMode latchMode)
+{
+  unlatchFrame(page - bufPool, latchMode);
+}
+
+unsigned int BufMgr::readVersion(const Page* page) const
+{
+  return bufDescTable[page - bufPool].latch.readVersion();
+}
+
+bool BufMgr::reserveFrame(const std::uint32_t limit)
+{
+  std::uint32_t reserved = reservedFrames.load(std::memory_order_relaxed);
+  while (reserved < limit)
+  {
+    if (reservedFrames.compare_exchange_weak(reserved, reserved + 1))
+      return true;
+  }
+  return false;
+}
+
+void BufMgr::releaseFrames(const std::uint32_t count)
+{
+  reservedFrames.fetch_sub(count);
+}
+
+bool BufMgr::validateVersion(const Page* page, const unsigned int version) const
+{
+  return bufDescTable[page - bufPool].latch.validate(version);
+}
+
 void BufMgr::flushFile(const File* file) 
 {
+  std::unique_lock<std::mutex> lock(bufMutex);
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
+    // a page of the file that is written back leaves the frame afterwards
+    while (tmpbuf->ioInProgress && tmpbuf->file == file)
+      ioDone.wait(lock);
   	if(tmpbuf->valid == true && tmpbuf->file == file)
 		{
 	    if (tmpbuf->pinCnt > 0)
@@ -195,9 +327,14 @@ void BufMgr::flushFile(const File* file)
 
 void BufMgr::disposePage(File* file, const PageId pageNo) 
 {
+  std::unique_lock<std::mutex> lock(bufMutex);
+
 	//Deallocate from file altogether
   //See if it is in the buffer pool
   FrameId frameNo = 0;
+  // a page that is written back leaves the buffer pool afterwards
+  while (hashTable->tryLookup(file, pageNo, frameNo) && bufDescTable[frameNo].ioInProgress)
+    ioDone.wait(lock);
   hashTable->lookup(file, pageNo, frameNo);
 
 	// clear the page
@@ -212,10 +349,11 @@ void BufMgr::disposePage(File* file, const PageId pageNo)
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  std::unique_lock<std::mutex> lock(bufMutex);
   FrameId frameNo;
 
   // alloc a new frame
-  allocBuf(frameNo);
+  allocBuf(frameNo, lock);
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
@@ -231,6 +369,7 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
 void BufMgr::printSelf(void) 
 {
+  std::lock_guard<std::mutex> guard(bufMutex);
   BufDesc* tmpbuf;
 	int validFrames = 0;
   
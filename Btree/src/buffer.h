@@ -9,7 +9,10 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "latch.h"
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
 
 namespace badgerdb {
 
@@ -18,6 +21,21 @@ namespace badgerdb {
 */
 class BufMgr;
 
+/**
+* @brief Alignment of the frames of the buffer pool in bytes, the size of a cache line.
+*/
+const std::size_t CACHELINESIZE = 64;
+
+/**
+* @brief Latch taken on a page together with its pin. Passed to BufMgr::readPage() and BufMgr::unPinPage().
+*/
+enum LatchMode
+{
+	LATCH_NONE,				/* Pin only */
+	LATCH_SHARED,			/* Pin and read the page, other readers may hold it too */
+	LATCH_EXCLUSIVE		/* Pin and change the page, no other thread holds it */
+};
+
 /**
 * @brief Class for maintaining information about buffer pool frames
 */
@@ -61,6 +79,17 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * True while the page of the frame is read from its file, or written back before the frame is reused,
+   * without bufMutex held. Other threads neither pin nor reuse the frame until BufMgr::ioDone is signalled.
+	 */
+  bool ioInProgress;
+
+	/**
+   * Latch of the page in the frame. Only held while the page is pinned.
+	 */
+  Latch latch;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -72,6 +101,7 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+    ioInProgress = false;
   };
 
 	/**
@@ -187,12 +217,40 @@ class BufMgr
   BufStats bufStats;
 
 	/**
-	 * Allocate a free frame.  
+   * Held by every call that looks at or changes the frame table or the hash table, so that several
+   * threads can share the buffer manager. Page latches are taken outside of it, and so are the file
+   * reads of readPage() and the write-backs of allocBuf(), see BufDesc::ioInProgress.
+	 */
+  std::mutex bufMutex;
+
+	/**
+   * Signalled whenever a frame stops being read in or written back.
+	 */
+  std::condition_variable ioDone;
+
+	/**
+	 * Frames reserved with reserveFrame() by all users of the buffer pool.
+	 */
+  std::atomic<std::uint32_t> reservedFrames;
+
+	/**
+	 * Allocate a free frame. Called with bufMutex held through lock, which is released while a dirty
+	 * page in the chosen frame is written back.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param lock   	Lock held on bufMutex
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocBuf(FrameId & frame, std::unique_lock<std::mutex>& lock);
+
+	/**
+	 * Take or release the latch of a frame.
+	 *
+	 * @param frameNo		Frame of the page
+	 * @param latchMode	Latch to take or release, nothing happens for LATCH_NONE
+	 */
+  void latchFrame(const FrameId frameNo, const LatchMode latchMode);
+  void unlatchFrame(const FrameId frameNo, const LatchMode latchMode);
 
 	/**
    * Advance clock to next frame in the buffer pool
@@ -227,8 +285,9 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param latchMode	Latch taken on the page once it is pinned, waiting for other threads to release theirs
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  void readPage(File* file, const PageId PageNo, Page*& page, const LatchMode latchMode = LATCH_NONE);
 
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
@@ -236,9 +295,52 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number
 	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
+	 * @param latchMode	Latch held on the page, released before the page is unpinned
    * @throws  PageNotPinnedException If the page is not already pinned
 	 */
-  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+  void unPinPage(File* file, const PageId PageNo, const bool dirty, const LatchMode latchMode = LATCH_NONE);
+
+	/**
+	 * Release the latch on a page that stays pinned.
+	 *
+	 * @param page  	Page returned by readPage()
+	 * @param latchMode	Latch held on the page
+	 */
+  void unlatchPage(const Page* page, const LatchMode latchMode);
+
+	/**
+	 * Start an optimistic read of a pinned page that is not latched.
+	 *
+	 * @param page  	Page returned by readPage()
+	 * @return	Version of the page, waits while a writer holds its latch
+	 */
+  unsigned int readVersion(const Page* page) const;
+
+	/**
+	 * End an optimistic read of a pinned page.
+	 *
+	 * @param page  	Page returned by readPage()
+	 * @param version	Version returned by readVersion() before the page was read
+	 * @return	true if no writer latched the page since, the reads were consistent then
+	 */
+  bool validateVersion(const Page* page, const unsigned int version) const;
+
+	/**
+	 * Reserve a frame for a page that stays pinned for long, such as a hot node of an index. The
+	 * reservations of all users of the buffer pool together stay within limit frames, so that
+	 * several indexes cannot pin the whole pool between them.
+	 *
+	 * @param limit	Frames all reservations may take together
+	 * @return	true if the frame was reserved, give it back with releaseFrames()
+	 */
+  bool reserveFrame(const std::uint32_t limit);
+
+	/**
+	 * Give back frames reserved with reserveFrame().
+	 *
+	 * @param count	Number of frames given back
+	 */
+  void releaseFrames(const std::uint32_t count);
 
 	/**
 	 * Allocates a new, empty page in the file and returns the Page object.
@@ -275,6 +377,14 @@ class BufMgr
 	 */
   void  printSelf();
 
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
 	/**
    * Get buffer pool usage statistics
 	 */
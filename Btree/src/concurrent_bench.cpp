@@ -0,0 +1,120 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Throughput benchmark for a concurrent index. Fills an empty INTEGER index from
+ * 1 to 32 threads, then runs point lookups and short range scans, reporting
+ * operations per second for each thread count.
+ * Usage: concurrent_bench [frames]. A pool of fewer frames than the few hundred
+ * pages of the index makes the threads read and write pages of the file.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "btree.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const std::string relationName = "relBench";
+const int numKeys = 200000;
+const int numScans = 20000;
+const int scanLength = 100;
+std::vector<int> keys;
+int numFrames = 4000;
+
+// -----------------------------------------------------------------------------
+// runThreads
+// Run op(t) on numThreads threads, t = 0..numThreads-1
+// @return: the seconds until the last thread finished
+// -----------------------------------------------------------------------------
+template <class Op>
+double runThreads(int numThreads, Op op)
+{
+	std::vector<std::thread> threads;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(int t = 0; t < numThreads; t++)
+		threads.push_back(std::thread(op, t));
+	for(int t = 0; t < numThreads; t++)
+		threads[t].join();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void runBench(int numThreads)
+{
+	std::string indexName;
+	BufMgr *bufMgr = new BufMgr(numFrames);
+	{
+		IndexOptions options;
+		options.concurrent = true;
+		BTreeIndex index(relationName, indexName, bufMgr, 0, INTEGER, options);
+
+		double insertSecs = runThreads(numThreads, [&](int t)
+		{
+			for(int i = t; i < numKeys; i += numThreads)
+				index.insertEntry(&keys[i], RecordId());
+		});
+
+		double lookupSecs = runThreads(numThreads, [&](int t)
+		{
+			std::vector<RecordId> rids;
+			for(int i = t; i < numKeys; i += numThreads){
+				rids.clear();
+				index.lookup(&keys[(i * 7) % numKeys], rids);
+			}
+		});
+
+		double scanSecs = runThreads(numThreads, [&](int t)
+		{
+			IndexCursor cursor(&index);
+			RecordId rids[scanLength];
+			for(int i = t; i < numScans; i += numThreads){
+				int low = keys[i], high = keys[i] + scanLength;
+				cursor.startScan(&low, GTE, &high, LT);
+				cursor.scanNextBatch(rids, scanLength);
+				cursor.endScan();
+			}
+		});
+
+		std::cout << numThreads << " threads: " << numKeys / insertSecs << " inserts/s, "
+			<< numKeys / lookupSecs << " lookups/s, " << numScans / scanSecs << " scans/s" << std::endl;
+	}
+	File::remove(indexName);
+	delete bufMgr;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 1)
+		numFrames = atoi(argv[1]);
+
+	//The index is filled by the threads, the relation stays empty
+	try{
+		File::remove(relationName);
+	}catch(FileNotFoundException e){}
+	{
+		PageFile::create(relationName);
+	}
+
+	for(int i = 0; i < numKeys; i++)
+		keys.push_back(i);
+	std::random_shuffle(keys.begin(), keys.end());
+
+	std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", frames: " << numFrames << std::endl;
+	for(int numThreads = 1; numThreads <= 32; numThreads *= 2)
+		runBench(numThreads);
+
+	File::remove(relationName);
+	return 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "key_too_long_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+KeyTooLongException::KeyTooLongException(const std::size_t length, const std::size_t maxLength)
+    : BadgerDbException(""), length_(length), maxLength_(maxLength) {
+  std::stringstream ss;
+  ss << "Key of " << length_ << " bytes is longer than " << maxLength_ << " bytes";
+  message_.assign(ss.str());
+}
+
+}
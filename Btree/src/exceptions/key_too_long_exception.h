@@ -0,0 +1,52 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a key or a value of a key is longer
+ *        than the index can store whole.
+ */
+class KeyTooLongException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a key too long exception.
+   *
+   * @param length     Length of the key or value, or a lower bound of it.
+   * @param maxLength  Longest key or value that can be stored.
+   */
+  explicit KeyTooLongException(const std::size_t length, const std::size_t maxLength);
+
+  /**
+   * Returns the length of the key or value that caused this exception.
+   */
+  virtual std::size_t length() const { return length_; }
+
+  /**
+   * Returns the longest key or value that can be stored.
+   */
+  virtual std::size_t maxLength() const { return maxLength_; }
+
+ protected:
+  /**
+   * Length of the key or value that caused this exception.
+   */
+  const std::size_t length_;
+
+  /**
+   * Longest key or value that can be stored.
+   */
+  const std::size_t maxLength_;
+};
+
+}
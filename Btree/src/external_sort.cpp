@@ -0,0 +1,349 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "external_sort.h"
+#include "exceptions/file_exists_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/page_not_pinned_exception.h"
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// ExternalSort::ExternalSort -- Constructor
+// -----------------------------------------------------------------------------
+
+ExternalSort::ExternalSort(BufMgr* bufMgr, const std::string& tempName, const LessThan& lessThan,
+		int memoryFrames, int fanIn)
+	: bufMgr(bufMgr), tempName(tempName), lessThan(lessThan), recordBytes(0),
+	numRunsWritten(0), finished(false), nextRecord(0)
+{
+	//A merge pins one page per input and one for its output
+	memoryFrames = std::max(memoryFrames, 3);
+	this->memoryBytes = (size_t) memoryFrames * Page::SIZE;
+	this->fanIn = std::min(std::max(fanIn, 2), memoryFrames - 1);
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::~ExternalSort -- destructor
+// -----------------------------------------------------------------------------
+
+ExternalSort::~ExternalSort()
+{
+	for(size_t i = 0; i < inputs.size(); i++)
+		closeReader(inputs[i]);
+	for(size_t i = 0; i < runs.size(); i++)
+		removeRun(runs[i]);
+}
+
+// -----------------------------------------------------------------------------
+// heapBytes
+// Bytes of the heap block of a string: none if the string keeps its characters
+// inside itself, else its capacity and terminator in chunks of the allocator,
+// which adds a size word and hands out multiples of two words
+// -----------------------------------------------------------------------------
+
+static size_t heapBytes(const std::string& s)
+{
+	const char* data = s.data();
+	if(data >= (const char*) &s && data < (const char*) (&s + 1))
+		return 0;
+	const size_t chunk = 2 * sizeof(size_t);
+	return (s.capacity() + 1 + sizeof(size_t) + chunk - 1) / chunk * chunk;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::add
+// -----------------------------------------------------------------------------
+
+void ExternalSort::add(const std::string& record)
+{
+	//A record takes a string in the vector, which doubles when it is full, and its heap block
+	std::string copy(record);
+	size_t size = heapBytes(copy);
+	size_t slots = records.size() < records.capacity() ? records.capacity() : std::max((size_t) 1, 2 * records.capacity());
+	if(recordBytes + size + slots * sizeof(std::string) > memoryBytes && !records.empty())
+		spill();
+	records.push_back(std::move(copy));
+	recordBytes += size;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::finish
+// -----------------------------------------------------------------------------
+
+void ExternalSort::finish()
+{
+	finished = true;
+	//Everything fit in memory, next() reads the sorted records
+	if(runs.empty()){
+		std::stable_sort(records.begin(), records.end(), lessThan);
+		return;
+	}
+	if(!records.empty())
+		spill();
+
+	//Each pass merges groups of fanIn neighbouring runs, keeping older records first
+	while(runs.size() > (size_t) fanIn){
+		std::vector<Run*> merged;
+		for(size_t begin = 0; begin < runs.size(); begin += fanIn){
+			size_t count = std::min((size_t) fanIn, runs.size() - begin);
+			merged.push_back(count == 1 ? runs[begin] : mergeRuns(begin, count));
+		}
+		runs.swap(merged);
+	}
+	openMerge(0, runs.size());
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::next
+// -----------------------------------------------------------------------------
+
+bool ExternalSort::next(std::string& record)
+{
+	if(runs.empty()){
+		if(nextRecord == records.size())
+			return false;
+		record.swap(records[nextRecord++]);
+		return true;
+	}
+
+	RunReader& winner = inputs[tree[0]];
+	if(winner.exhausted)
+		return false;
+	record.swap(winner.record);
+	readRecord(winner);
+	adjust(tree[0]);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::spill
+// -----------------------------------------------------------------------------
+
+void ExternalSort::spill()
+{
+	std::stable_sort(records.begin(), records.end(), lessThan);
+	Run* run = createRun();
+	RunWriter writer = { run, Page::SIZE, NULL };
+	for(size_t i = 0; i < records.size(); i++)
+		writeRecord(writer, records[i]);
+	closeWriter(writer);
+	runs.push_back(run);
+
+	records.clear();
+	recordBytes = 0;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::mergeRuns
+// -----------------------------------------------------------------------------
+
+ExternalSort::Run* ExternalSort::mergeRuns(size_t begin, size_t count)
+{
+	Run* run = createRun();
+	RunWriter writer = { run, Page::SIZE, NULL };
+	openMerge(begin, count);
+	while(!inputs[tree[0]].exhausted){
+		RunReader& winner = inputs[tree[0]];
+		writeRecord(writer, winner.record);
+		readRecord(winner);
+		adjust(tree[0]);
+	}
+	closeWriter(writer);
+
+	for(size_t i = 0; i < inputs.size(); i++)
+		closeReader(inputs[i]);
+	inputs.clear();
+	for(size_t i = begin; i < begin + count; i++)
+		removeRun(runs[i]);
+	return run;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::createRun
+// -----------------------------------------------------------------------------
+
+ExternalSort::Run* ExternalSort::createRun()
+{
+	Run* run = new Run();
+	run->numRecords = 0;
+	std::ostringstream name;
+	name << tempName << ".run" << numRunsWritten++;
+	run->name = name.str();
+
+	//A run file left behind by a crashed sort is overwritten
+	try{
+		File::remove(run->name);
+	}catch(FileNotFoundException e) {}
+	run->file = new BlobFile(run->name, true);
+	return run;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::removeRun
+// -----------------------------------------------------------------------------
+
+void ExternalSort::removeRun(Run* run)
+{
+	//The frames of the file must not outlive its File object
+	bufMgr->flushFile(run->file);
+	delete run->file;
+	File::remove(run->name);
+	delete run;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::writeBytes
+// -----------------------------------------------------------------------------
+
+void ExternalSort::writeBytes(RunWriter& writer, const char* bytes, size_t length)
+{
+	while(length > 0){
+		if(writer.offset == Page::SIZE){
+			closeWriter(writer);
+			PageId pageNo;
+			bufMgr->allocPage(writer.run->file, pageNo, writer.page);
+			writer.run->pageNos.push_back(pageNo);
+			writer.offset = 0;
+		}
+		size_t count = std::min(length, Page::SIZE - writer.offset);
+		memcpy((char *) writer.page + writer.offset, bytes, count);
+		writer.offset += count;
+		bytes += count;
+		length -= count;
+	}
+}
+
+void ExternalSort::writeRecord(RunWriter& writer, const std::string& record)
+{
+	int length = record.size();
+	writeBytes(writer, (const char *) &length, sizeof(int));
+	writeBytes(writer, record.data(), record.size());
+	writer.run->numRecords++;
+}
+
+void ExternalSort::closeWriter(RunWriter& writer)
+{
+	if(writer.page == NULL)
+		return;
+	try{
+		bufMgr->unPinPage(writer.run->file, writer.run->pageNos.back(), true);
+	}catch(PageNotPinnedException e) {}
+	writer.page = NULL;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::readBytes
+// -----------------------------------------------------------------------------
+
+bool ExternalSort::readBytes(RunReader& reader, char* bytes, size_t length)
+{
+	while(length > 0){
+		if(reader.offset == Page::SIZE){
+			closeReader(reader);
+			if(++reader.pageIdx == reader.run->pageNos.size())
+				return false;
+			bufMgr->readPage(reader.run->file, reader.run->pageNos[reader.pageIdx], reader.page);
+			reader.offset = 0;
+		}
+		size_t count = std::min(length, Page::SIZE - reader.offset);
+		memcpy(bytes, (const char *) reader.page + reader.offset, count);
+		reader.offset += count;
+		bytes += count;
+		length -= count;
+	}
+	return true;
+}
+
+bool ExternalSort::readRecord(RunReader& reader)
+{
+	//The last page of a run ends with unused bytes, the record count tells where
+	if(reader.exhausted || reader.numRead == reader.run->numRecords){
+		reader.exhausted = true;
+		closeReader(reader);
+		return false;
+	}
+	int length;
+	readBytes(reader, (char *) &length, sizeof(int));
+	reader.numRead++;
+	reader.record.resize(length);
+	if(length > 0)
+		readBytes(reader, &reader.record[0], length);
+	return true;
+}
+
+void ExternalSort::closeReader(RunReader& reader)
+{
+	if(reader.page == NULL)
+		return;
+	try{
+		bufMgr->unPinPage(reader.run->file, reader.run->pageNos[reader.pageIdx], false);
+	}catch(PageNotPinnedException e) {}
+	reader.page = NULL;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::openMerge
+// -----------------------------------------------------------------------------
+
+void ExternalSort::openMerge(size_t begin, size_t count)
+{
+	inputs.clear();
+	for(size_t i = 0; i < count; i++){
+		//pageIdx starts before the first page, the first read moves onto it
+		RunReader reader = { runs[begin + i], (size_t) -1, Page::SIZE, NULL, 0, false, std::string() };
+		inputs.push_back(reader);
+	}
+	for(size_t i = 0; i < count; i++)
+		readRecord(inputs[i]);
+
+	//Every match starts against the virtual input count, which beats all others. Playing
+	//each input up the tree from the last one pushes these out and leaves the real losers.
+	tree.assign(count, count);
+	for(int i = count - 1; i >= 0; i--)
+		adjust(i);
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::adjust
+// -----------------------------------------------------------------------------
+
+void ExternalSort::adjust(int input)
+{
+	int k = inputs.size();
+	int winner = input;
+	for(int t = (input + k) / 2; t > 0; t /= 2){
+		//The loser stays in the node, the winner plays on
+		if(beats(tree[t], winner))
+			std::swap(winner, tree[t]);
+	}
+	tree[0] = winner;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSort::beats
+// -----------------------------------------------------------------------------
+
+bool ExternalSort::beats(int a, int b)
+{
+	int k = inputs.size();
+	if(a == k || b == k)
+		return a == k;
+	if(inputs[a].exhausted || inputs[b].exhausted)
+		return !inputs[a].exhausted && inputs[b].exhausted;
+	if(lessThan(inputs[a].record, inputs[b].record))
+		return true;
+	if(lessThan(inputs[b].record, inputs[a].record))
+		return false;
+	return a < b;
+}
+
+}
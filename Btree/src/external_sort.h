@@ -0,0 +1,214 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Default number of pages worth of records an ExternalSort holds in memory before it spills a run.
+ */
+const int SORTMEMORYFRAMES = 16;
+
+/**
+ * @brief Default number of runs an ExternalSort merges at once.
+ */
+const int SORTFANIN = 8;
+
+/**
+ * @brief Sorts records that need not fit in memory. Records are collected until they fill the memory
+ * budget, then sorted and written as a run to a temporary BlobFile through the buffer manager. Once all
+ * records are added, merge passes with a loser tree combine groups of fanIn neighbouring runs until at
+ * most fanIn are left, and the last merge is read record by record with next(). Nothing is spilled if
+ * all records fit in memory.
+ */
+class ExternalSort
+{
+ public:
+	/**
+	 * Order of the records: true if the first record sorts before the second.
+	 */
+	typedef std::function<bool(const std::string& a, const std::string& b)> LessThan;
+
+	/**
+	 * ExternalSort Constructor.
+	 *
+	 * @param bufMgr		Buffer manager the runs are written and read through
+	 * @param tempName	Prefix of the names of the temporary run files
+	 * @param lessThan	Order of the records, equal records keep the order they were added in
+	 * @param memoryFrames	Memory budget in pages: records that take that much memory, their strings and heap
+	 *				blocks counted, are sorted in memory, and a merge pins at most that many frames. At least 3.
+	 * @param fanIn		Maximum number of runs merged at once, at most memoryFrames - 1
+	 */
+	ExternalSort(BufMgr* bufMgr, const std::string& tempName, const LessThan& lessThan,
+			int memoryFrames = SORTMEMORYFRAMES, int fanIn = SORTFANIN);
+
+	/**
+	 * ExternalSort Destructor. Releases the pages still pinned and removes the run files.
+	 */
+	~ExternalSort();
+
+	/**
+	 * Add a record to the sort.
+	 *
+	 * @param record	The record, any length
+	 */
+	void add(const std::string& record);
+
+	/**
+	 * End the input and merge the runs down to at most fanIn, ready for next().
+	 */
+	void finish();
+
+	/**
+	 * Fetch the next record in sorted order, after finish().
+	 *
+	 * @param record	Receives the record
+	 * @return	false once all records were returned
+	 */
+	bool next(std::string& record);
+
+	/**
+	 * @return	Number of runs written to run files so far, including the runs of merge passes
+	 */
+	int getNumRunsWritten() const { return numRunsWritten; }
+
+ private:
+	/**
+	 * A sorted run in a temporary BlobFile: its records, each a 4-byte length followed by its bytes,
+	 * fill the listed pages back to back.
+	 */
+	struct Run {
+		std::string	name;
+		BlobFile	*file;
+		std::vector<PageId>	pageNos;
+		size_t	numRecords;
+	};
+
+	/**
+	 * Position of one input of a merge in its run. The page being read stays pinned.
+	 */
+	struct RunReader {
+		Run		*run;
+		size_t	pageIdx;
+		size_t	offset;
+		Page	*page;
+		size_t	numRead;
+		bool	exhausted;
+		std::string	record;
+	};
+
+	/**
+	 * Position of the output of a merge or of an in-memory sort in its run. The page being written stays pinned.
+	 */
+	struct RunWriter {
+		Run		*run;
+		size_t	offset;
+		Page	*page;
+	};
+
+	BufMgr	*bufMgr;
+	std::string	tempName;
+	LessThan	lessThan;
+
+	/**
+	 * Total size of the records held in memory before a run is spilled.
+	 */
+	size_t	memoryBytes;
+
+	/**
+	 * Maximum number of runs merged at once.
+	 */
+	int		fanIn;
+
+	/**
+	 * Records added since the last spill, and the bytes of their heap blocks. These and the slots of the
+	 * vector are held within memoryBytes.
+	 */
+	std::vector<std::string>	records;
+	size_t	recordBytes;
+
+	/**
+	 * Runs not merged yet, oldest first.
+	 */
+	std::vector<Run*>	runs;
+	int		numRunsWritten;
+
+	/**
+	 * True once finish() was called.
+	 */
+	bool	finished;
+
+	/**
+	 * Next record of the in-memory sort, if nothing was spilled.
+	 */
+	size_t	nextRecord;
+
+	/**
+	 * Inputs of the final merge and the loser tree over them: tree[0] is the input with the smallest
+	 * record, tree[1..k-1] hold the losers of the matches.
+	 */
+	std::vector<RunReader>	inputs;
+	std::vector<int>	tree;
+
+// -----------------------------------------------------------------------------
+// ExternalSort::spill
+// Sort the records in memory and write them as a new run
+// -----------------------------------------------------------------------------
+	void spill();
+
+// -----------------------------------------------------------------------------
+// ExternalSort::mergeRuns
+// Merge runs[begin, begin + count) into a new run and remove them
+// @return: the new run
+// -----------------------------------------------------------------------------
+	Run* mergeRuns(size_t begin, size_t count);
+
+// -----------------------------------------------------------------------------
+// ExternalSort::createRun, ExternalSort::removeRun
+// Create an empty run file, or flush and remove the file of a run
+// -----------------------------------------------------------------------------
+	Run* createRun();
+	void removeRun(Run* run);
+
+// -----------------------------------------------------------------------------
+// ExternalSort::writeBytes, ExternalSort::writeRecord, ExternalSort::closeWriter
+// Append to a run, allocating its pages as they fill up, and release its last page
+// -----------------------------------------------------------------------------
+	void writeBytes(RunWriter& writer, const char* bytes, size_t length);
+	void writeRecord(RunWriter& writer, const std::string& record);
+	void closeWriter(RunWriter& writer);
+
+// -----------------------------------------------------------------------------
+// ExternalSort::readBytes, ExternalSort::readRecord, ExternalSort::closeReader
+// Read from a run page by page, and release the page being read
+// @return: readRecord() returns false at the end of the run
+// -----------------------------------------------------------------------------
+	bool readBytes(RunReader& reader, char* bytes, size_t length);
+	bool readRecord(RunReader& reader);
+	void closeReader(RunReader& reader);
+
+// -----------------------------------------------------------------------------
+// ExternalSort::openMerge, ExternalSort::adjust, ExternalSort::beats
+// Open the inputs of a merge of runs[begin, begin + count) and build the loser tree over
+// them, replay the matches of one input after its record changed, and decide
+// a match: exhausted inputs lose, equal records go to the older run
+// -----------------------------------------------------------------------------
+	void openMerge(size_t begin, size_t count);
+	void adjust(int input);
+	bool beats(int a, int b);
+};
+
+}
@@ -24,6 +24,7 @@
 namespace badgerdb {
 
 File::StreamMap File::open_streams_;
+File::MutexMap File::stream_mutexes_;
 File::CountMap File::open_counts_;
 
 void File::remove(const std::string& filename) {
@@ -79,6 +80,7 @@ void File::openIfNeeded(const bool create_new) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    stream_mutex_ = stream_mutexes_[filename_];
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -98,6 +100,8 @@ void File::openIfNeeded(const bool create_new) {
     }
     stream_.reset(new std::fstream(filename_, mode));
     open_streams_[filename_] = stream_;
+    stream_mutex_.reset(new std::mutex);
+    stream_mutexes_[filename_] = stream_mutex_;
     open_counts_[filename_] = 1;
   }
 }
@@ -107,22 +111,26 @@ void File::close() {
   	--open_counts_[filename_];
 
   stream_.reset();
+  stream_mutex_.reset();
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
     open_streams_.erase(filename_);
+    stream_mutexes_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
 FileHeader File::readHeader() const {
   FileHeader header;
+  std::lock_guard<std::mutex> guard(*stream_mutex_);
   stream_->seekg(0 /* pos */, std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
+  std::lock_guard<std::mutex> guard(*stream_mutex_);
   stream_->seekp(0 /* pos */, std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
   stream_->flush();
@@ -247,9 +255,12 @@ Page PageFile::readPage(const PageId page_number) const {
 
 Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  {
+    std::lock_guard<std::mutex> guard(*stream_mutex_);
+    stream_->seekg(pagePosition(page_number), std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
+    stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  }
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -315,6 +326,7 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
+  std::lock_guard<std::mutex> guard(*stream_mutex_);
   stream_->seekp(pagePosition(page_number), std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
   stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
@@ -324,6 +336,7 @@ void PageFile::writePage(const PageId page_number, const PageHeader& header,
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
   PageHeader header;
+  std::lock_guard<std::mutex> guard(*stream_mutex_);
   stream_->seekg(pagePosition(page_number), std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
   return header;
@@ -365,13 +378,21 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
   FileHeader header = readHeader();
 	Page new_page;
 
-	new_page_number = header.num_pages;
+	if (header.num_free_pages > 0) {
+		// Reuse the head of the free list, which stores the next free page.
+		new_page_number = header.first_free_page;
+		Page free_page = readPage(new_page_number);
+		header.first_free_page = free_page.header_.next_page_number;
+		--header.num_free_pages;
+	} else {
+		new_page_number = header.num_pages;
 
-	if (header.first_used_page == Page::INVALID_NUMBER) {
-		header.first_used_page = header.num_pages;
-	}
+		if (header.first_used_page == Page::INVALID_NUMBER) {
+			header.first_used_page = header.num_pages;
+		}
 
-	++header.num_pages;
+		++header.num_pages;
+	}
 
 	writePage(new_page_number, new_page);
 	writeHeader(header);
@@ -381,20 +402,31 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
+	std::lock_guard<std::mutex> guard(*stream_mutex_);
 	stream_->seekg(pagePosition(page_number), std::ios::beg);
 	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
 	return page;
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
+	std::lock_guard<std::mutex> guard(*stream_mutex_);
 	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
 	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
 	stream_->flush();
 }
 
-//delePage should not be called for a blob_file, not supported
 void BlobFile::deletePage(const PageId page_number) {
-	throw InvalidPageException(page_number, filename_);
+	FileHeader header = readHeader();
+
+	// Blob pages have no header of their own, so a free page is overwritten with
+	// an empty page that links to the rest of the free list.
+	Page free_page;
+	free_page.header_.next_page_number = header.first_free_page;
+	header.first_free_page = page_number;
+	++header.num_free_pages;
+
+	writePage(page_number, free_page);
+	writeHeader(header);
 }
 
 }
@@ -11,6 +11,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include "page.h"
 
@@ -211,6 +212,7 @@ class File {
   void writeHeader(const FileHeader& header);
 
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
+  typedef std::map<std::string, std::shared_ptr<std::mutex> > MutexMap;
   typedef std::map<std::string, int> CountMap;
 
   /**
@@ -218,6 +220,11 @@ class File {
    */
   static StreamMap open_streams_;
 
+  /**
+   * Mutexes of the streams for opened files.
+   */
+  static MutexMap stream_mutexes_;
+
   /**
    * Counts for opened files.
    */
@@ -233,6 +240,13 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Held while the position of <stream_> is set and the stream read or written,
+   * shared by all File objects of the file. The buffer manager reads and writes
+   * pages of the same file on several threads at once.
+   */
+  std::shared_ptr<std::mutex> stream_mutex_;
+
   friend class FileIterator;
 };
 
@@ -442,7 +456,7 @@ class BlobFile : public File {
   ~BlobFile();
 
   /**
-   * Allocates a new page in the file.
+   * Allocates a new page in the file, reusing a deleted page if there is one.
    *
    * @return The new page.
    */
@@ -468,7 +482,8 @@ class BlobFile : public File {
   void writePage(const PageId page_number, const Page& new_page);
 
   /**
-   * Deletes a page from the file.
+   * Deletes a page from the file. The page goes on the free list of the file
+   * header, from which allocatePage() takes pages before growing the file.
    *
    * @param page_number   Number of page to delete.
    */
@@ -0,0 +1,127 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+namespace badgerdb
+{
+
+/**
+ * @brief Reader-writer latch of a buffer frame. Latches are held only for the few
+ * instructions that read or change a page, so waiting threads spin and then yield
+ * instead of sleeping. A waiting writer keeps new readers out, so a steady stream
+ * of scans cannot starve an insert.
+ * The latch also keeps a version that is odd while a writer holds it. An optimistic
+ * reader takes no latch: it notes the version, reads the page and then validates
+ * that the version did not change in between.
+ */
+class Latch
+{
+ private:
+	/**
+	 * Set while a writer holds the latch.
+	 */
+	static const int WRITER = 1 << 30;
+
+	/**
+	 * Set while a writer waits for the latch.
+	 */
+	static const int WAITING = 1 << 29;
+
+	/**
+	 * Number of readers holding the latch, plus the WRITER and WAITING bits.
+	 */
+	std::atomic<int> state;
+
+	/**
+	 * Bumped when a writer takes the latch and again when it releases it.
+	 */
+	std::atomic<unsigned int> version;
+
+	/**
+	 * Wait a little before trying again.
+	 */
+	static void backoff(int spins)
+	{
+		if(spins >= 16)
+			std::this_thread::yield();
+	}
+
+ public:
+	Latch() : state(0), version(0) {}
+
+	/**
+	 * Wait until no writer holds or waits for the latch, then hold it shared.
+	 */
+	void lockShared()
+	{
+		for(int spins = 0;; spins++){
+			int s = state.load(std::memory_order_relaxed);
+			if(!(s & (WRITER | WAITING)) && state.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+				return;
+			backoff(spins);
+		}
+	}
+
+	void unlockShared()
+	{
+		state.fetch_sub(1, std::memory_order_release);
+	}
+
+	/**
+	 * Wait until no reader or writer holds the latch, then hold it exclusively.
+	 */
+	void lockExclusive()
+	{
+		for(int spins = 0;; spins++){
+			int s = state.load(std::memory_order_relaxed);
+			if((s & ~WAITING) == 0 && state.compare_exchange_weak(s, WRITER, std::memory_order_acquire)){
+				//Optimistic readers must see the odd version before any change to the page: the
+				//acquire half keeps the writes to the page from moving before the increment
+				version.fetch_add(1, std::memory_order_acq_rel);
+				return;
+			}
+			if(!(s & WAITING))
+				state.fetch_or(WAITING, std::memory_order_relaxed);
+			backoff(spins);
+		}
+	}
+
+	void unlockExclusive()
+	{
+		version.fetch_add(1, std::memory_order_release);
+		state.fetch_and(~WRITER, std::memory_order_release);
+	}
+
+	/**
+	 * Wait until no writer holds the latch, then return the version to validate against.
+	 */
+	unsigned int readVersion() const
+	{
+		for(int spins = 0;; spins++){
+			unsigned int v = version.load(std::memory_order_acquire);
+			if(!(v & 1))
+				return v;
+			backoff(spins);
+		}
+	}
+
+	/**
+	 * @return true if no writer took the latch since readVersion() returned v, the
+	 *	   reads of the page in between are consistent then.
+	 */
+	bool validate(unsigned int v) const
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return version.load(std::memory_order_relaxed) == v;
+	}
+};
+
+}
@@ -6,7 +6,12 @@
  */
 
 #include <vector>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <atomic>
 #include "btree.h"
+#include "external_sort.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
@@ -19,6 +24,9 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/key_too_long_exception.h"
+#include "exceptions/buffer_exceeded_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -44,6 +52,9 @@ const std::string relationName = "relA";
 //If the relation size is changed then the second parameter 2 chechPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
 int	relationSize = 5000;
 std::string intIndexName, doubleIndexName, stringIndexName;
+//Options of the test indices: some tests build them bottom-up from the sorted relation instead of
+//inserting record by record, or change the fraction of the entries kept by a node split at its end.
+IndexOptions indexOptions;
 
 // This is the structure for tuples in the base relation
 
@@ -67,11 +78,34 @@ BufMgr * bufMgr = new BufMgr(100);
 void createRelationForward();
 void createRelationBackward();
 void createRelationRandom();
+void createRelationGrouped();
 void intTests();
 void largeIntTests();
+void doubleTests();
+void stringTests();
+int doubleScan(BTreeIndex *index, double lowVal, Operator lowOp, double highVal, Operator highOp);
+int stringScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int stringCount(BTreeIndex *index, const char *lowVal, Operator lowOp, const char *highVal, Operator highOp);
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intScanBatch(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanDirection direction = ASCENDING);
+int intTopN(BTreeIndex *index, int lowVal, int highVal, int limit);
+int intLookup(BTreeIndex *index, int firstKey, int numKeys);
+int intJoin(BTreeIndex *index, int lowVal, int highVal);
+int intParallelScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numThreads);
+int compositeScan(BTreeIndex *index, const CompositeKey& lowVal, Operator lowOp, const CompositeKey& highVal, Operator highOp);
+int deleteKeys(BTreeIndex *index, Datatype type, int firstKey, int lastKey);
+int insertKeys(BTreeIndex *index, int attrByteOffset, int firstKey, int lastKey);
+long indexFileSize(const std::string & indexName);
 void indexTests();
 void largeIndexTests();
+void deleteTests();
+void concurrentTests();
+void sortTests();
+void compositeTests();
+void postingTests();
+void bufferedTests();
+void deltaTests();
+void hotNodeTests();
 void test1();
 void test2();
 void test3();
@@ -81,6 +115,15 @@ void test6();
 void test7();
 void test8();
 void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
 void errorTests();
 void deleteRelation();
 
@@ -152,6 +195,17 @@ int main(int argc, char **argv)
 	test5();
 	test6();
 	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
 	
 	errorTests();
 	std::cout<<"ALL TEST PASSED"<<std::endl;
@@ -238,6 +292,142 @@ void test7()
 	std::cout << "TEST 7 PASSED" << std::endl;
 	relationSize = 5000;
 }
+
+void test8()
+{
+	relationSize = 600000;
+	indexOptions.bulkLoad = true;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom With relationSize = 600000, bulk loaded index" << std::endl;
+	std::cout << "LOADING..." << std::endl;
+	createRelationRandom();
+	largeIndexTests();
+	deleteRelation();
+	std::cout << "TEST 8 PASSED" << std::endl;
+	indexOptions = IndexOptions();
+	relationSize = 5000;
+}
+
+void test9()
+{
+	indexOptions.bulkLoad = true;
+	indexOptions.fillFactor = 0.7;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom, bulk loaded index with fill factor 0.7" << std::endl;
+	createRelationRandom();
+	indexTests();
+	deleteRelation();
+	std::cout << "TEST 9 PASSED" << std::endl;
+	indexOptions = IndexOptions();
+}
+
+void test10()
+{
+	indexOptions.appendSplitRatio = 0.5;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationForward, even splits at the right end of the index" << std::endl;
+	createRelationForward();
+	indexTests();
+	deleteRelation();
+	std::cout << "TEST 10 PASSED" << std::endl;
+	indexOptions = IndexOptions();
+}
+
+void test11()
+{
+	//Sparse bulk loaded nodes, so that deletes merge and rebalance the non-leaf levels too
+	relationSize = 20000;
+	indexOptions.bulkLoad = true;
+	indexOptions.fillFactor = 0.1;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom, entries deleted and inserted again" << std::endl;
+	createRelationRandom();
+	deleteTests();
+	deleteRelation();
+	std::cout << "TEST 11 PASSED" << std::endl;
+	indexOptions = IndexOptions();
+	relationSize = 5000;
+}
+
+void test12()
+{
+	relationSize = 20000;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom, concurrent inserts, lookups, scans and deletes" << std::endl;
+	createRelationRandom();
+	concurrentTests();
+	deleteRelation();
+	std::cout << "TEST 12 PASSED" << std::endl;
+	relationSize = 5000;
+}
+
+void test13()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom, external sort of the records" << std::endl;
+	createRelationRandom();
+	sortTests();
+	deleteRelation();
+	std::cout << "TEST 13 PASSED" << std::endl;
+}
+
+void test14()
+{
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationGrouped, composite indexes" << std::endl;
+	createRelationGrouped();
+	compositeTests();
+	deleteRelation();
+	std::cout << "TEST 14 PASSED" << std::endl;
+}
+
+void test15()
+{
+	relationSize = 20000;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationGrouped, posting lists" << std::endl;
+	createRelationGrouped();
+	postingTests();
+	deleteRelation();
+	std::cout << "TEST 15 PASSED" << std::endl;
+	relationSize = 5000;
+}
+
+void test16()
+{
+	relationSize = 20000;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom, buffered index" << std::endl;
+	createRelationRandom();
+	bufferedTests();
+	deleteRelation();
+	std::cout << "TEST 16 PASSED" << std::endl;
+	relationSize = 5000;
+}
+
+void test17()
+{
+	relationSize = 20000;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom, in-memory delta in front of the index" << std::endl;
+	createRelationRandom();
+	deltaTests();
+	deleteRelation();
+	std::cout << "TEST 17 PASSED" << std::endl;
+	relationSize = 5000;
+}
+
+void test18()
+{
+	relationSize = 100000;
+	std::cout << "--------------------" << std::endl;
+	std::cout << "createRelationRandom, hot non-leaf nodes" << std::endl;
+	createRelationRandom();
+	hotNodeTests();
+	deleteRelation();
+	std::cout << "TEST 18 PASSED" << std::endl;
+	relationSize = 5000;
+}
 // -----------------------------------------------------------------------------
 // createRelationForward
 // -----------------------------------------------------------------------------
@@ -400,6 +590,53 @@ void createRelationRandom()
 	file1->writePage(new_page_number, new_page);
 }
 
+// -----------------------------------------------------------------------------
+// createRelationGrouped
+// -----------------------------------------------------------------------------
+
+void createRelationGrouped()
+{
+  // destroy any old copies of relation file
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+  file1 = new PageFile(relationName, true);
+
+  // initialize all of record1.s to keep purify happy
+  memset(record1.s, ' ', sizeof(record1.s));
+	PageId new_page_number;
+  Page new_page = file1->allocatePage(new_page_number);
+
+  // i repeats every 50 records, d is unique and half of it negative
+  for(int n = 0; n < relationSize; n++ )
+	{
+    sprintf(record1.s, "%05d string record", n);
+    record1.i = n % 50;
+    record1.d = n - relationSize / 2;
+    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
+
+		while(1)
+		{
+			try
+			{
+    		new_page.insertRecord(new_data);
+				break;
+			}
+			catch(InsufficientSpaceException e)
+			{
+				file1->writePage(new_page_number, new_page);
+  			new_page = file1->allocatePage(new_page_number);
+			}
+		}
+  }
+
+	file1->writePage(new_page_number, new_page);
+}
+
 // -----------------------------------------------------------------------------
 // indexTests
 // -----------------------------------------------------------------------------
@@ -416,6 +653,22 @@ void indexTests()
   	catch(FileNotFoundException e)
   	{
   	}
+    doubleTests();
+		try
+		{
+			File::remove(doubleIndexName);
+		}
+  	catch(FileNotFoundException e)
+  	{
+  	}
+    stringTests();
+		try
+		{
+			File::remove(stringIndexName);
+		}
+  	catch(FileNotFoundException e)
+  	{
+  	}
   }
 }
 void largeIndexTests()
@@ -433,115 +686,1696 @@ void largeIndexTests()
   }
 }
 // -----------------------------------------------------------------------------
-// intTests
+// deleteTests
 // -----------------------------------------------------------------------------
 
-void intTests()
-{
-  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-	
-	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 14)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
-	checkPassFail(intScan(&index,100,GT,1000,LTE), 900)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,300,GT,400,LT), 99)
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
-}
-void largeIntTests()
+void deleteTests()
 {
-  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-	
-	// run some tests
-	checkPassFail(intScan(&index,25000,GT,40000,LT), 14999)
-	checkPassFail(intScan(&index,-100,GT,1000,LT), 1000)
-}
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
-{
-  RecordId scanRid;
-	Page *curPage;
-
-  std::cout << "Scan for ";
-  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
-  std::cout << lowVal << "," << highVal;
-  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
-  std::cout << std::endl;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions);
+
+		checkPassFail(deleteKeys(&index,INTEGER,1000,3000), 2000)
+		checkPassFail(deleteKeys(&index,INTEGER,1000,3000), 0)
+		checkPassFail(intScan(&index,900,GT,3100,LT), 199)
+		checkPassFail(intScanBatch(&index,900,GT,3100,LT,DESCENDING), 199)
+		checkPassFail(intScanBatch(&index,-3,GT,relationSize,LTE), relationSize - 2000)
+		checkPassFail(intLookup(&index,990,20), 10)
+		checkPassFail(insertKeys(&index,offsetof(tuple,i),1000,3000), 2000)
+		checkPassFail(intScanBatch(&index,-3,GT,relationSize,LTE), relationSize)
+
+		//Emptying and filling the index again reuses the freed pages
+		checkPassFail(deleteKeys(&index,INTEGER,0,relationSize), relationSize)
+		checkPassFail(intScan(&index,-3,GT,relationSize,LT), 0)
+		checkPassFail(insertKeys(&index,offsetof(tuple,i),0,relationSize), relationSize)
+		long fileSize = indexFileSize(intIndexName);
+		for(int round = 0; round < 2; round++)
+		{
+			checkPassFail(deleteKeys(&index,INTEGER,0,relationSize), relationSize)
+			checkPassFail(insertKeys(&index,offsetof(tuple,i),0,relationSize), relationSize)
+		}
+		checkPassFail(indexFileSize(intIndexName), fileSize)
+		checkPassFail(intScanBatch(&index,-3,GT,relationSize,LTE), relationSize)
+		checkPassFail(intScanBatch(&index,-3,GT,relationSize,LTE,DESCENDING), relationSize)
+
+		//The leaves pack the rids, every bit of page and slot number must come back
+		int key = -10;
+		std::vector<RecordId> packedRids(3);
+		packedRids[0].page_number = 0xFFFFFFFF;
+		packedRids[0].slot_number = 0xFFFF;
+		packedRids[1].page_number = 0x12345678;
+		packedRids[1].slot_number = 0xABCD;
+		packedRids[2].page_number = 1;
+		packedRids[2].slot_number = 0;
+		for(size_t i = 0; i < packedRids.size(); i++)
+			index.insertEntry(&key, packedRids[i]);
+		std::vector<RecordId> rids;
+		checkPassFail(index.lookup(&key, rids), true)
+		checkPassFail((rids.size() == packedRids.size() && std::is_permutation(rids.begin(), rids.end(), packedRids.begin())), true)
+		for(size_t i = 0; i < packedRids.size(); i++)
+			checkPassFail(index.deleteEntry(&key, packedRids[i]), true)
+		checkPassFail(intScan(&index,-11,GT,relationSize,LT), relationSize)
+	}
+	File::remove(intIndexName);
 
-  int numResults = 0;
-	
-	try
 	{
-  	index->startScan(&lowVal, lowOp, &highVal, highOp);
-	//SCHEN-Test
-	std::cout<<"Start testing Scan"<<std::endl;
+		std::cout << "Create a B+ Tree index on the double field" << std::endl;
+		BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, indexOptions);
+
+		checkPassFail(deleteKeys(&index,DOUBLE,0,relationSize / 2), relationSize / 2)
+		checkPassFail(doubleScan(&index,-3,GT,relationSize,LT), relationSize / 2)
 	}
-	catch(NoSuchKeyFoundException e)
+	File::remove(doubleIndexName);
+
 	{
-    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
-		return 0;
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, indexOptions);
+
+		checkPassFail(deleteKeys(&index,STRING,1000,3000), 2000)
+		checkPassFail(stringScan(&index,900,GT,3100,LT), 199)
+		checkPassFail(insertKeys(&index,offsetof(tuple,s),1000,3000), 2000)
+		checkPassFail(stringScan(&index,900,GT,3100,LT), 2199)
+		checkPassFail(deleteKeys(&index,STRING,0,relationSize), relationSize)
+		checkPassFail(stringScan(&index,-3,GT,relationSize,LT), 0)
 	}
+	File::remove(stringIndexName);
+}
 
-	while(1)
+// -----------------------------------------------------------------------------
+// concurrentTests
+// -----------------------------------------------------------------------------
+
+void concurrentTests()
+{
+	const int numThreads = 8;
+
+	//The (key, rid) pairs of the relation
+	std::vector<int> keys;
+	std::vector<RecordId> rids;
 	{
+		FileScan fscan(relationName, bufMgr);
 		try
 		{
-			index->scanNext(scanRid);
-			bufMgr->readPage(file1, scanRid.page_number, curPage);
-			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
-			bufMgr->unPinPage(file1, scanRid.page_number, false);
-
-			if( numResults < 5 )
-			{
-				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
-				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
-			}
-			else if( numResults == 5 )
+			RecordId scanRid;
+			while(1)
 			{
-				std::cout << "..." << std::endl;
+				fscan.scanNext(scanRid);
+				std::string record = fscan.getRecord();
+				keys.push_back(reinterpret_cast<const RECORD*>(record.data())->i);
+				rids.push_back(scanRid);
 			}
 		}
-		catch(IndexScanCompletedException e)
+		catch(EndOfFileException e)
 		{
-			break;
 		}
+	}
 
-		numResults++;
+	{
+		std::cout << "Create a concurrent B+ Tree index on the integer field" << std::endl;
+		IndexOptions options;
+		options.concurrent = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+		//Insert every entry a second time while readers look up and scan the index.
+		//Lookups must find the first copy, scans all first copies and no entry twice.
+		std::atomic<bool> inserting(true);
+		std::atomic<int> failures(0);
+		std::vector<std::thread> writers, readers;
+		for(int t = 0; t < numThreads; t++)
+		{
+			writers.push_back(std::thread([&, t]()
+			{
+				for(size_t i = t; i < keys.size(); i += numThreads)
+					index.insertEntry(&keys[i], rids[i]);
+			}));
+		}
+		for(int t = 0; t < 2; t++)
+		{
+			readers.push_back(std::thread([&, t]()
+			{
+				IndexCursor cursor(&index);
+				for(size_t i = t;; i = (i + 97) % keys.size())
+				{
+					bool last = !inserting;
+					std::vector<RecordId> found;
+					if(!index.lookup(&keys[i], found))
+						failures++;
+
+					int low = -1, high = relationSize, count = 0;
+					cursor.startScan(&low, GT, &high, LT, t == 0 ? ASCENDING : DESCENDING);
+					RecordId scanRid;
+					while(cursor.tryScanNext(scanRid))
+						count++;
+					cursor.endScan();
+					if(count < relationSize || count > 2 * relationSize)
+						failures++;
+					if(last)
+						break;
+				}
+			}));
+		}
+		for(int t = 0; t < numThreads; t++)
+			writers[t].join();
+		inserting = false;
+		for(int t = 0; t < 2; t++)
+			readers[t].join();
+		checkPassFail(failures.load(), 0)
+		//Every descent of the inserts reaches at least the root through the hot nodes
+		checkPassFail((index.getHotNodeHits() >= relationSize), true)
+		checkPassFail(intScan(&index,-1,GT,relationSize,LT), 2 * relationSize)
+		checkPassFail(intScanBatch(&index,-1,GT,relationSize,LT,DESCENDING), 2 * relationSize)
+		checkPassFail(intLookup(&index,1000,20), 20)
+
+		//Delete one copy of every entry
+		std::atomic<int> numDeleted(0);
+		std::vector<std::thread> deleters;
+		for(int t = 0; t < numThreads; t++)
+		{
+			deleters.push_back(std::thread([&, t]()
+			{
+				for(size_t i = t; i < keys.size(); i += numThreads)
+					numDeleted += index.deleteEntry(&keys[i], rids[i]);
+			}));
+		}
+		for(int t = 0; t < numThreads; t++)
+			deleters[t].join();
+		checkPassFail(numDeleted.load(), relationSize)
+		checkPassFail(intScan(&index,-1,GT,relationSize,LT), relationSize)
 	}
+	File::remove(intIndexName);
 
-  if( numResults >= 5 )
-  {
-    std::cout << "Number of results: " << numResults << std::endl;
-  }
-  index->endScan();
-  std::cout << std::endl;
+	{
+		//A pool much smaller than the index, the threads read pages in and write them back at once
+		std::cout << "Create a concurrent B+ Tree index in a small buffer pool" << std::endl;
+		BufMgr smallBufMgr(32);
+		IndexOptions options;
+		options.concurrent = true;
+		BTreeIndex index(relationName, intIndexName, &smallBufMgr, offsetof(tuple,i), INTEGER, options);
+		smallBufMgr.clearBufStats();
+		std::atomic<int> failures(0);
+		std::vector<std::thread> threads;
+		for(int t = 0; t < numThreads; t++)
+		{
+			threads.push_back(std::thread([&, t]()
+			{
+				std::vector<RecordId> found;
+				for(size_t i = t; i < keys.size(); i += numThreads)
+				{
+					index.insertEntry(&keys[i], rids[i]);
+					found.clear();
+					if(!index.lookup(&keys[(i * 7) % keys.size()], found))
+						failures++;
+				}
+			}));
+		}
+		for(int t = 0; t < numThreads; t++)
+			threads[t].join();
+		checkPassFail(failures.load(), 0)
+		checkPassFail((smallBufMgr.getBufStats().diskreads > 0), true)
+		checkPassFail((smallBufMgr.getBufStats().diskwrites > 0), true)
+		checkPassFail(intScan(&index,-1,GT,relationSize,LT), 2 * relationSize)
+		checkPassFail(intLookup(&index,1000,20), 20)
+	}
+	File::remove(intIndexName);
 
-	return numResults;
+	//STRING nodes have no high keys to move right by
+	bool thrown = false;
+	try
+	{
+		IndexOptions options;
+		options.concurrent = true;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
 }
 
-
 // -----------------------------------------------------------------------------
-// errorTests
+// sortTests
 // -----------------------------------------------------------------------------
 
-void errorTests()
+void sortTests()
 {
-	std::cout << "Error handling tests" << std::endl;
-	std::cout << "--------------------" << std::endl;
-	// Given error test
-
-	try
+	//Sort the records by i % 100, so that many are equal and must keep the relation order
+	std::vector<std::string> records;
 	{
-		File::remove(relationName);
+		FileScan fscan(relationName, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				fscan.scanNext(scanRid);
+				records.push_back(fscan.getRecord());
+			}
+		}
+		catch(EndOfFileException e)
+		{
+		}
 	}
-	catch(FileNotFoundException e)
+	std::vector<int> position(relationSize);
+	for(size_t i = 0; i < records.size(); i++)
+		position[reinterpret_cast<const RECORD*>(records[i].data())->i] = i;
+	ExternalSort::LessThan lessThan = [](const std::string& a, const std::string& b)
 	{
-	}
+		return reinterpret_cast<const RECORD*>(a.data())->i % 100 < reinterpret_cast<const RECORD*>(b.data())->i % 100;
+	};
+	const std::string sortName = relationName + ".sort";
 
-  file1 = new PageFile(relationName, true);
-	
+	//A budget of 4 pages spills many runs, merging 3 at a time takes several passes
+	{
+		std::cout << "Sort the relation with a small memory budget" << std::endl;
+		ExternalSort sort(bufMgr, sortName, lessThan, 4, 3);
+		for(size_t i = 0; i < records.size(); i++)
+			sort.add(records[i]);
+		sort.finish();
+		checkPassFail((sort.getNumRunsWritten() > 3), true)
+
+		int count = 0, failures = 0;
+		std::string record, previous;
+		while(sort.next(record))
+		{
+			if(count > 0 && (lessThan(record, previous) || (!lessThan(previous, record) &&
+				position[reinterpret_cast<const RECORD*>(record.data())->i] < position[reinterpret_cast<const RECORD*>(previous.data())->i])))
+				failures++;
+			previous.swap(record);
+			count++;
+		}
+		checkPassFail(count, relationSize)
+		checkPassFail(failures, 0)
+	}
+	checkPassFail(File::exists(sortName + ".run0"), false)
+
+	//Records that fit in the budget are sorted in memory
+	{
+		std::cout << "Sort part of the relation in memory" << std::endl;
+		ExternalSort sort(bufMgr, sortName, lessThan);
+		for(size_t i = 0; i < 1000; i++)
+			sort.add(records[i]);
+		sort.finish();
+		checkPassFail(sort.getNumRunsWritten(), 0)
+
+		int count = 0, failures = 0;
+		std::string record, previous;
+		while(sort.next(record))
+		{
+			if(count > 0 && lessThan(record, previous))
+				failures++;
+			previous.swap(record);
+			count++;
+		}
+		checkPassFail(count, 1000)
+		checkPassFail(failures, 0)
+	}
+
+	//Short records take little room for their characters but a whole string each, which the budget must count
+	{
+		std::cout << "Sort short records with a small memory budget" << std::endl;
+		ExternalSort sort(bufMgr, sortName, std::less<std::string>(), 4);
+		char key[12];
+		for(int i = 0; i < 2000; i++)
+		{
+			sprintf(key, "%08d", (i * 7919) % 2000);
+			sort.add(key);
+		}
+		sort.finish();
+		checkPassFail((sort.getNumRunsWritten() > 0), true)
+
+		int count = 0, failures = 0;
+		std::string record;
+		while(sort.next(record))
+		{
+			sprintf(key, "%08d", count);
+			if(record != key)
+				failures++;
+			count++;
+		}
+		checkPassFail(count, 2000)
+		checkPassFail(failures, 0)
+	}
+
+	{
+		ExternalSort sort(bufMgr, sortName, lessThan);
+		sort.finish();
+		std::string record;
+		checkPassFail(sort.next(record), false)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// compositeTests
+// -----------------------------------------------------------------------------
+
+void compositeTests()
+{
+	std::string compositeIndexName;
+	std::vector<KeyAttribute> attributes = { { offsetof(tuple,i), INTEGER }, { offsetof(tuple,d), DOUBLE } };
+	{
+		std::cout << "Create a composite B+ Tree index on the integer and double fields" << std::endl;
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, attributes, indexOptions);
+
+		//Equality on i and a range on d
+		checkPassFail(compositeScan(&index, CompositeKey().add(7).add(-100.0), GTE, CompositeKey().add(7).add(100.0), LT), 4)
+		checkPassFail(compositeScan(&index, CompositeKey().add(7).add(2400.0), GT, CompositeKey().add(7).prefixEnd(), LTE), 2)
+		//Ranges on i alone
+		checkPassFail(compositeScan(&index, CompositeKey().add(10), GTE, CompositeKey().add(20).prefixEnd(), LTE), 1100)
+		checkPassFail(compositeScan(&index, CompositeKey().add(45).prefixEnd(), GT, CompositeKey().add(48), LT), 200)
+		checkPassFail(compositeScan(&index, CompositeKey().add(-3), GT, CompositeKey().add(50), LT), relationSize)
+
+		std::vector<RecordId> rids;
+		checkPassFail(index.lookup(CompositeKey().add(3).add(53.0 - relationSize / 2).data(), rids), true)
+		checkPassFail(index.lookup(CompositeKey().add(3).add(54.0 - relationSize / 2).data(), rids), false)
+		checkPassFail((int) rids.size(), 1)
+
+		CompositeKey low = CompositeKey().add(0), high = CompositeKey().add(49).prefixEnd();
+		checkPassFail((int) index.parallelScan(low.data(), GTE, high.data(), LTE, 4, [](int, const RecordId*, size_t) {}), relationSize)
+	}
+
+	//The attributes of the existing index file must match
+	bool thrown = false;
+	try
+	{
+		std::vector<KeyAttribute> other = { { offsetof(tuple,i), INTEGER }, { offsetof(tuple,d), INTEGER } };
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, other);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	File::remove(compositeIndexName);
+
+	//A STRING attribute first, bulk loaded
+	{
+		std::cout << "Create a composite B+ Tree index on the string and integer fields" << std::endl;
+		std::vector<KeyAttribute> stringFirst = { { offsetof(tuple,s), STRING }, { offsetof(tuple,i), INTEGER } };
+		IndexOptions options;
+		options.bulkLoad = true;
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, stringFirst, options);
+		checkPassFail(compositeScan(&index, CompositeKey().add("00100 string record"), GTE, CompositeKey().add("00200 string record"), LT), 100)
+		checkPassFail(compositeScan(&index, CompositeKey().add("00100 string record").add(0), GTE, CompositeKey().add("00100 string record").add(0), LTE), 1)
+
+		//A STRING value of STRINGSIZE escaped bytes is twice as long encoded, the INTEGER after it still counts
+		char longString[STRINGSIZE + 1];
+		memset(longString, '\1', STRINGSIZE);
+		longString[STRINGSIZE] = 0;
+		for(int n = 0; n < 100; n++)
+		{
+			RecordId rid;
+			rid.page_number = 100000 + n;
+			rid.slot_number = 0;
+			index.insertEntry(CompositeKey().add(longString).add(n).data(), rid);
+		}
+		int numFound = 0;
+		for(int n = 0; n < 100; n++)
+		{
+			std::vector<RecordId> rids;
+			if(index.lookup(CompositeKey().add(longString).add(n).data(), rids) && rids.size() == 1 && rids[0].page_number == (PageId) (100000 + n))
+				numFound++;
+		}
+		checkPassFail(numFound, 100)
+		CompositeKey low = CompositeKey().add(longString), high = low.prefixEnd();
+		checkPassFail((int) index.parallelScan(low.data(), GTE, high.data(), LTE, 2, [](int, const RecordId*, size_t) {}), 100)
+		low = CompositeKey().add(longString).add(90);
+		checkPassFail((int) index.parallelScan(low.data(), GTE, high.data(), LTE, 2, [](int, const RecordId*, size_t) {}), 10)
+
+		//A record whose STRING field is full has no zero byte, its key is the whole field and the INTEGER after it
+		RECORD record;
+		memset(record.s, 'z', sizeof(record.s));
+		record.i = 7;
+		std::string recordString(STRINGSIZE, 'z');
+		CompositeKey recordKey(stringFirst, (const char *) &record);
+		checkPassFail((strcmp(recordKey.data(), CompositeKey().add(recordString.c_str()).add(7).data()) == 0), true)
+		RecordId rid;
+		rid.page_number = 200000;
+		rid.slot_number = 0;
+		index.insertEntry(recordKey.data(), rid);
+		std::vector<RecordId> rids;
+		checkPassFail(index.lookup(CompositeKey().add(recordString.c_str()).add(7).data(), rids), true)
+		checkPassFail(index.lookup(CompositeKey().add(recordString.c_str()).add(8).data(), rids), false)
+		checkPassFail((int) rids.size(), 1)
+
+		//Values and keys the index cannot keep whole are refused, the key keeps the values added before
+		recordString += 'z';
+		CompositeKey key;
+		thrown = false;
+		try
+		{
+			key.add(1).add(recordString.c_str());
+		}
+		catch(KeyTooLongException e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		checkPassFail((strcmp(key.data(), CompositeKey().add(1).data()) == 0), true)
+		thrown = false;
+		try
+		{
+			key = CompositeKey();
+			for(int n = 0; n <= MAXKEYATTRIBUTES; n++)
+				key.add(longString);
+		}
+		catch(KeyTooLongException e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		checkPassFail((int) strlen(key.data()), MAXKEYATTRIBUTES * (2 * STRINGSIZE + 2))
+	}
+	File::remove(compositeIndexName);
+
+	thrown = false;
+	try
+	{
+		std::vector<KeyAttribute> tooMany(MAXKEYATTRIBUTES + 1, attributes[0]);
+		BTreeIndex index(relationName, compositeIndexName, bufMgr, tooMany);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// -----------------------------------------------------------------------------
+// postingTests
+// -----------------------------------------------------------------------------
+
+void postingTests()
+{
+	//Every key of i has relationSize / 50 entries. The two indexes whose files are compared go without a
+	//Bloom filter, which takes the same pages in both
+	long plainSize;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		IndexOptions options = indexOptions;
+		options.useBloomFilter = false;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intScan(&index,9,GT,12,LTE), 1200)
+
+		//Splits leave copies of a separator in the leaf left of it, scans starting at the key must find them
+		checkPassFail(intScan(&index,10,GTE,10,LTE), relationSize / 50)
+		checkPassFail(intScanBatch(&index,0,GTE,49,LTE), relationSize)
+		checkPassFail(intParallelScan(&index,0,GTE,49,LTE,8), relationSize)
+		checkPassFail(intParallelScan(&index,10,GTE,30,LT,4), relationSize * 2 / 5)
+		checkPassFail(intParallelScan(&index,10,GT,30,LTE,3), relationSize * 2 / 5)
+		plainSize = indexFileSize(intIndexName);
+	}
+	File::remove(intIndexName);
+
+	{
+		std::cout << "Create a B+ Tree index with posting lists on the integer field" << std::endl;
+		IndexOptions options;
+		options.useBloomFilter = false;
+		options.postingLists = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail((indexFileSize(intIndexName) * 3 < plainSize), true)
+		checkPassFail(intScan(&index,9,GT,12,LTE), 1200)
+		checkPassFail(intScan(&index,-5,GTE,100,LT), relationSize)
+		checkPassFail(intScanBatch(&index,10,GT,20,LT), 3600)
+		checkPassFail(intScanBatch(&index,0,GTE,49,LTE,DESCENDING), relationSize)
+		checkPassFail(intLookup(&index,0,60), 50)
+		int low = 0, high = 49;
+		checkPassFail((int) index.parallelScan(&low, GTE, &high, LTE, 4, [](int, const RecordId*, size_t) {}), relationSize)
+
+		//Remove whole lists, and every second entry of another
+		checkPassFail(deleteKeys(&index, INTEGER, 10, 20), relationSize / 5)
+		checkPassFail(intScan(&index,0,GTE,49,LTE), relationSize * 4 / 5)
+		int key = 30;
+		std::vector<RecordId> rids;
+		index.lookup(&key, rids);
+		int numDeleted = 0;
+		for(size_t i = 0; i < rids.size(); i += 2)
+			numDeleted += index.deleteEntry(&key, rids[i]);
+		checkPassFail(numDeleted, relationSize / 100)
+		checkPassFail(index.deleteEntry(&key, rids[0]), false)
+		checkPassFail(intScan(&index,30,GTE,30,LTE), relationSize / 100)
+		for(size_t i = 0; i < rids.size(); i += 2)
+			index.insertEntry(&key, rids[i]);
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 10, 20), relationSize / 5)
+		checkPassFail(intScanBatch(&index,0,GTE,49,LTE), relationSize)
+
+		//A hot key whose list spans several overflow pages, appended to and then filled in between
+		key = 1000;
+		std::vector<RecordId> hotRids;
+		for(int n = 0; n < 6000; n++)
+		{
+			RecordId rid;
+			rid.page_number = 100000 + n;
+			rid.slot_number = n % 2;
+			hotRids.push_back(rid);
+			if(n % 2 == 0)
+				index.insertEntry(&key, rid);
+		}
+		for(int n = 5999; n > 0; n -= 2)
+			index.insertEntry(&key, hotRids[n]);
+		rids.clear();
+		checkPassFail(index.lookup(&key, rids), true)
+		checkPassFail((rids.size() == hotRids.size() && std::equal(rids.begin(), rids.end(), hotRids.begin())), true)
+		numDeleted = 0;
+		for(size_t i = 0; i < hotRids.size(); i++)
+			numDeleted += index.deleteEntry(&key, hotRids[i]);
+		checkPassFail(numDeleted, 6000)
+		rids.clear();
+		checkPassFail(index.lookup(&key, rids), false)
+		checkPassFail(intScan(&index,0,GTE,1000,LTE), relationSize)
+	}
+
+	//The file keeps posting lists, the flag must match when it is opened again
+	{
+		IndexOptions options;
+		options.postingLists = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intLookup(&index,0,50), 50)
+	}
+	bool thrown = false;
+	try
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	File::remove(intIndexName);
+
+	{
+		std::cout << "Bulk load a B+ Tree index with posting lists on the integer field" << std::endl;
+		IndexOptions options;
+		options.bulkLoad = true;
+		options.fillFactor = 0.7;
+		options.postingLists = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intScan(&index,9,GT,12,LTE), 1200)
+		checkPassFail(intScanBatch(&index,0,GTE,49,LTE,DESCENDING), relationSize)
+		checkPassFail(intLookup(&index,0,60), 50)
+		checkPassFail(deleteKeys(&index, INTEGER, 0, 5), relationSize / 10)
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 0, 5), relationSize / 10)
+		checkPassFail(intScan(&index,-5,GTE,100,LT), relationSize)
+	}
+	File::remove(intIndexName);
+
+	//Posting lists only for INTEGER keys and an index that is not concurrent
+	thrown = false;
+	try
+	{
+		IndexOptions options;
+		options.postingLists = true;
+		BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	thrown = false;
+	try
+	{
+		IndexOptions options;
+		options.concurrent = true;
+		options.postingLists = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// -----------------------------------------------------------------------------
+// bufferedTests
+// -----------------------------------------------------------------------------
+
+void bufferedTests()
+{
+	{
+		std::cout << "Create a buffered B+ Tree index on the integer field" << std::endl;
+		IndexOptions options;
+		options.buffered = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		//Lookups, deletes and scans find many entries still in a buffer
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(deleteKeys(&index, INTEGER, 100, 200), 100)
+		checkPassFail(intLookup(&index,0,300), 200)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,90,GTE,210,LT), 20)
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 100, 200), 100)
+		checkPassFail(intScanBatch(&index,0,GTE,relationSize,LT,DESCENDING), relationSize)
+		checkPassFail(deleteKeys(&index, INTEGER, 1000, 3000), 2000)
+		checkPassFail(intParallelScan(&index,-3,GTE,relationSize,LT,4), relationSize - 2000)
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 1000, 3000), 2000)
+		checkPassFail(intLookup(&index,500,3000), 3000)
+		checkPassFail(intScan(&index,-3,GTE,relationSize + 3,LT), relationSize)
+	}
+
+	//The buffers are part of the file, the flag must match when it is opened again
+	{
+		IndexOptions options;
+		options.buffered = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+	}
+	bool thrown = false;
+	try
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	File::remove(intIndexName);
+
+	{
+		std::cout << "Bulk load a buffered B+ Tree index on the integer field" << std::endl;
+		IndexOptions options;
+		options.bulkLoad = true;
+		options.fillFactor = 0.7;
+		options.buffered = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(deleteKeys(&index, INTEGER, 0, 50), 50)
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 0, 5000), 5000)
+		checkPassFail(intLookup(&index,0,100), 100)
+		checkPassFail(intScan(&index,-3,GTE,relationSize + 3,LT), relationSize + 4950)
+	}
+	File::remove(intIndexName);
+
+	//Inserts at random keys into a tree larger than the buffer pool. A plain index writes
+	//about one evicted leaf per insert, a buffered one a leaf per batch of inserts.
+	{
+		BufMgr smallBufMgr(16);
+		int diskWrites[2];
+		for(int buffered = 0; buffered < 2; buffered++)
+		{
+			{
+				IndexOptions options;
+				options.useBloomFilter = false;
+				options.buffered = buffered == 1;
+				BTreeIndex index(relationName, intIndexName, &smallBufMgr, offsetof(tuple,i), INTEGER, options);
+				smallBufMgr.clearBufStats();
+				for(int n = 0; n < 50000; n++)
+				{
+					int key = relationSize + (int) ((n * 2654435761u) % 1000000);
+					RecordId rid;
+					rid.page_number = 100000 + n;
+					rid.slot_number = 0;
+					index.insertEntry(&key, rid);
+				}
+				diskWrites[buffered] = smallBufMgr.getBufStats().diskwrites;
+				int low = relationSize, high = relationSize + 1000000;
+				checkPassFail((int) index.parallelScan(&low, GTE, &high, LT, 2, [](int, const RecordId*, size_t) {}), 50000)
+			}
+			File::remove(intIndexName);
+		}
+		std::cout << "Disk writes of 50000 random inserts, plain: " << diskWrites[0] << " buffered: " << diskWrites[1] << std::endl;
+		checkPassFail((diskWrites[1] * 4 < diskWrites[0]), true)
+	}
+
+	//Reads leave the inserts in their buffers, so that no page gets dirty and none is written back
+	{
+		BufMgr smallBufMgr(16);
+		IndexOptions options;
+		options.buffered = true;
+		{
+			BTreeIndex index(relationName, intIndexName, &smallBufMgr, offsetof(tuple,i), INTEGER, options);
+			for(int n = 0; n < 20000; n++)
+			{
+				int key = relationSize + (int) ((n * 2654435761u) % 1000000);
+				RecordId rid;
+				rid.page_number = 100000 + n;
+				rid.slot_number = 0;
+				index.insertEntry(&key, rid);
+			}
+		}
+		BTreeIndex index(relationName, intIndexName, &smallBufMgr, offsetof(tuple,i), INTEGER, options);
+		smallBufMgr.clearBufStats();
+		int low = -3, high = relationSize + 1000000;
+		checkPassFail((int) index.parallelScan(&low, GTE, &high, LT, 1, [](int, const RecordId*, size_t) {}), relationSize + 20000)
+		low = relationSize;
+		checkPassFail((int) index.parallelScan(&low, GTE, &high, LT, 4, [](int, const RecordId*, size_t) {}), 20000)
+		std::vector<RecordId> rids;
+		checkPassFail(index.lookup(&low, rids), true)
+		checkPassFail(smallBufMgr.getBufStats().diskwrites, 0)
+	}
+	File::remove(intIndexName);
+
+	//Buffering only for INTEGER keys, without posting lists and not concurrent
+	thrown = false;
+	try
+	{
+		IndexOptions options;
+		options.buffered = true;
+		BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	thrown = false;
+	try
+	{
+		IndexOptions options;
+		options.concurrent = true;
+		options.buffered = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	thrown = false;
+	try
+	{
+		IndexOptions options;
+		options.postingLists = true;
+		options.buffered = true;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// -----------------------------------------------------------------------------
+// deltaTests
+// -----------------------------------------------------------------------------
+
+void deltaTests()
+{
+	{
+		//The first merge bulk loads the empty tree, the later ones insert in key order
+		std::cout << "Create a B+ Tree index with a delta on the integer field" << std::endl;
+		IndexOptions options;
+		options.deltaMemory = 64 * 1024;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+
+		//Take the entries of keys [0, 1000) out, then insert them again into the delta alone
+		std::vector<int> keys;
+		std::vector<RecordId> rids;
+		for(int key = 0; key < 1000; key++)
+		{
+			std::vector<RecordId> keyRids;
+			index.lookup(&key, keyRids);
+			for(size_t i = 0; i < keyRids.size(); i++)
+			{
+				index.deleteEntry(&key, keyRids[i]);
+				keys.push_back(key);
+				rids.push_back(keyRids[i]);
+			}
+		}
+		checkPassFail((int) keys.size(), 1000)
+		index.mergeDelta();
+		checkPassFail(intScan(&index,-3,GTE,relationSize,LT), relationSize - 1000)
+		bufMgr->clearBufStats();
+		for(int i = keys.size() - 1; i >= 0; i--)
+			index.insertEntry(&keys[i], rids[i]);
+		checkPassFail(bufMgr->getBufStats().accesses, 0)
+
+		//Scans merge the delta with the leaves
+		checkPassFail(intScan(&index,-3,GTE,relationSize,LT), relationSize)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+		checkPassFail(intScanBatch(&index,500,GTE,1500,LT,DESCENDING), 1000)
+		checkPassFail(intScanBatch(&index,990,GT,1010,LTE,DESCENDING), 20)
+		checkPassFail(intScanBatch(&index,10,GT,10,LT), 0)
+		checkPassFail(intParallelScan(&index,-3,GTE,relationSize,LT,4), relationSize)
+		checkPassFail(intLookup(&index,0,2000), 2000)
+		checkPassFail(deleteKeys(&index, INTEGER, 900, 1100), 200)
+		checkPassFail(intScanBatch(&index,800,GTE,1200,LT), 200)
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 900, 1100), 200)
+
+		//The merge writes each leaf once for all of its entries instead of descending for every entry
+		index.mergeDelta();
+		checkPassFail(deleteKeys(&index, INTEGER, 900, 1100), 200)
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 900, 1100), 200)
+		int numReads = index.getHotNodeHits() + index.getHotNodeMisses() + index.getHotNodeCapMisses();
+		index.mergeDelta();
+		checkPassFail((index.getHotNodeHits() + index.getHotNodeMisses() + index.getHotNodeCapMisses() - numReads < 50), true)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+		checkPassFail(intLookup(&index,800,400), 400)
+	}
+
+	//The destructor merged the delta, the file is that of any index
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+	}
+	File::remove(intIndexName);
+
+	{
+		//Only keys of the delta, the tree has no leaf yet
+		IndexOptions options;
+		options.bulkLoad = true;
+		options.deltaMemory = 1024 * 1024;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(deleteKeys(&index, INTEGER, 0, relationSize), relationSize)
+		checkPassFail(intScan(&index,-3,GTE,relationSize,LT), 0)
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 100, 200), 100)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT,DESCENDING), 100)
+		checkPassFail(intLookup(&index,0,300), 100)
+	}
+	File::remove(intIndexName);
+
+	{
+		//With every frame pinned the destructor cannot merge the delta, it keeps the entries in pages of the index
+		const std::string pinName = relationName + ".pin";
+		{
+			BlobFile pinFile(pinName, true);
+			std::vector<PageId> pinned;
+			{
+				IndexOptions options;
+				options.deltaMemory = 1024 * 1024;
+				BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+				index.mergeDelta();
+				checkPassFail(deleteKeys(&index, INTEGER, 0, 100), 100)
+				checkPassFail(insertKeys(&index, offsetof(tuple,i), 0, 100), 100)
+				checkPassFail(intLookup(&index,0,relationSize), relationSize)
+				try
+				{
+					while(true)
+					{
+						PageId pageNo;
+						Page* page;
+						bufMgr->allocPage(&pinFile, pageNo, page);
+						pinned.push_back(pageNo);
+					}
+				}
+				catch(BufferExceededException e)
+				{
+				}
+			}
+			for(size_t i = 0; i < pinned.size(); i++)
+				bufMgr->unPinPage(&pinFile, pinned[i], false);
+			bufMgr->flushFile(&pinFile);
+		}
+		File::remove(pinName);
+
+		//The open inserts the entries again
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+		checkPassFail(intLookup(&index,0,100), 100)
+	}
+	{
+		//The pages of the delta are gone with the first open
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+	}
+	File::remove(intIndexName);
+
+	{
+		std::cout << "Create B+ Tree indexes with a delta on the double and string fields" << std::endl;
+		IndexOptions options;
+		options.deltaMemory = 64 * 1024;
+		BTreeIndex doubleIndex(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+		checkPassFail(doubleScan(&doubleIndex,24.5,GT,25.5,LT), 1)
+		checkPassFail(doubleScan(&doubleIndex,3000,GTE,4000,LT), 1000)
+		BTreeIndex stringIndex(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, options);
+		checkPassFail(stringScan(&stringIndex,20,GTE,35,LTE), 16)
+		checkPassFail(deleteKeys(&stringIndex, STRING, 300, 400), 100)
+		checkPassFail(insertKeys(&stringIndex, offsetof(tuple,s), 300, 350), 50)
+		checkPassFail(stringScan(&stringIndex,300,GT,400,LT), 49)
+		checkPassFail(stringScan(&stringIndex,3000,GTE,4000,LT), 1000)
+	}
+	File::remove(doubleIndexName);
+	File::remove(stringIndexName);
+
+	//No delta for a concurrent index
+	bool thrown = false;
+	try
+	{
+		IndexOptions options;
+		options.concurrent = true;
+		options.deltaMemory = 64 * 1024;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// -----------------------------------------------------------------------------
+// hotNodeTests
+// -----------------------------------------------------------------------------
+
+void hotNodeTests()
+{
+	{
+		//Nodes filled to a tenth make a tree with several non-leaf nodes below its root
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		IndexOptions options;
+		options.bulkLoad = true;
+		options.fillFactor = 0.1;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(index.getHotNodeMisses(), 0)
+
+		//Reaching every leaf reads every non-leaf node, each misses once
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		int numMisses = index.getHotNodeMisses();
+		checkPassFail((numMisses > 1), true)
+		checkPassFail((numMisses < 25), true)
+
+		//Full scans cycle every leaf through the pool, the non-leaf nodes stay
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT,DESCENDING), relationSize)
+		int numHits = index.getHotNodeHits();
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(index.getHotNodeMisses(), numMisses)
+		checkPassFail((index.getHotNodeHits() - numHits >= 2 * relationSize), true)
+
+		//Deletes free non-leaf nodes, the descents never read them again
+		checkPassFail(deleteKeys(&index, INTEGER, 0, relationSize / 2), relationSize / 2)
+		checkPassFail(index.getHotNodeMisses(), numMisses)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize - relationSize / 2)
+		checkPassFail(deleteKeys(&index, INTEGER, relationSize / 2, relationSize), relationSize - relationSize / 2)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), 0)
+
+		//Inserts in the random order of the relation descend through the hot nodes as well
+		numHits = index.getHotNodeHits();
+		checkPassFail(insertKeys(&index, offsetof(tuple,i), 0, relationSize), relationSize)
+		checkPassFail((index.getHotNodeHits() - numHits >= relationSize / 2), true)
+		checkPassFail(intScanBatch(&index,-3,GTE,relationSize,LT), relationSize)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(index.getHotNodeCapMisses(), 0)
+	}
+	File::remove(intIndexName);
+
+	{
+		//Nodes filled to a fiftieth make more non-leaf nodes than the hot nodes may hold
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		IndexOptions options;
+		options.bulkLoad = true;
+		options.fillFactor = 0.02;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(index.getHotNodeMisses(), (int) (bufMgr->getNumBufs() * HOTNODEFRACTION))
+		int numCapMisses = index.getHotNodeCapMisses();
+		checkPassFail((numCapMisses > 0), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail((index.getHotNodeCapMisses() > numCapMisses), true)
+		checkPassFail(index.getHotNodeMisses(), (int) (bufMgr->getNumBufs() * HOTNODEFRACTION))
+
+		//The hot nodes of all indexes on the pool share its budget, a second index gets none while the first holds it
+		std::cout << "Create a B+ Tree index on the double field" << std::endl;
+		options.fillFactor = 0.1;
+		BTreeIndex doubleIndex(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+		checkPassFail(doubleScan(&doubleIndex,-3,GT,3,LT), 3)
+		checkPassFail(doubleScan(&doubleIndex,3000,GTE,4000,LT), 1000)
+		checkPassFail(doubleIndex.getHotNodeMisses(), 0)
+		checkPassFail((doubleIndex.getHotNodeCapMisses() > 0), true)
+	}
+
+	//Closing the indexes gave their frames back
+	{
+		std::cout << "Open the B+ Tree index on the double field" << std::endl;
+		BTreeIndex doubleIndex(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE);
+		checkPassFail(doubleScan(&doubleIndex,3000,GTE,4000,LT), 1000)
+		checkPassFail((doubleIndex.getHotNodeMisses() > 0), true)
+		checkPassFail(doubleIndex.getHotNodeCapMisses(), 0)
+	}
+
+	try
+	{
+		File::remove(intIndexName);
+		File::remove(doubleIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+}
+
+// -----------------------------------------------------------------------------
+// intTests
+// -----------------------------------------------------------------------------
+
+void intTests()
+{
+  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions);
+	
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(intScan(&index,100,GT,1000,LTE), 900)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,300,GT,400,LT), 99)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(intScanBatch(&index,25,GT,40,LT), 14)
+	checkPassFail(intScanBatch(&index,0,GT,1,LT), 0)
+	checkPassFail(intScanBatch(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(intScanBatch(&index,-3,GT,relationSize,LTE), relationSize)
+	checkPassFail(intJoin(&index,100,300), 200)
+	checkPassFail(intScanBatch(&index,25,GT,40,LT,DESCENDING), 14)
+	checkPassFail(intScanBatch(&index,3000,GTE,4000,LT,DESCENDING), 1000)
+	checkPassFail(intScanBatch(&index,-3,GT,relationSize,LTE,DESCENDING), relationSize)
+	checkPassFail(intTopN(&index,0,relationSize - 1,3), 3 * relationSize - 6)
+	checkPassFail(intParallelScan(&index,25,GT,40,LT,4), 14)
+	checkPassFail(intParallelScan(&index,3000,GTE,4000,LT,3), 1000)
+	checkPassFail(intParallelScan(&index,-3,GT,relationSize,LTE,8), relationSize)
+	checkPassFail(intLookup(&index,0,100), 100)
+	checkPassFail(intLookup(&index,relationSize,1000), 0)
+	checkPassFail((index.getBloomFilterSkips() > 900), true)
+}
+void largeIntTests()
+{
+  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexOptions);
+	
+	// run some tests
+	checkPassFail(intScan(&index,25000,GT,40000,LT), 14999)
+	checkPassFail(intScan(&index,-100,GT,1000,LT), 1000)
+	checkPassFail(intScan(&index,590000,GTE,600000,LT), 10000)
+	checkPassFail(intScanBatch(&index,25000,GT,40000,LT), 14999)
+	checkPassFail(intScanBatch(&index,-100,GT,600000,LT), 600000)
+	checkPassFail(intScanBatch(&index,25000,GT,40000,LT,DESCENDING), 14999)
+	checkPassFail(intTopN(&index,0,300000,10), 2999955)
+	checkPassFail(intLookup(&index,599990,20), 10)
+}
+// -----------------------------------------------------------------------------
+// doubleTests
+// -----------------------------------------------------------------------------
+
+void doubleTests()
+{
+  std::cout << "Create a B+ Tree index on the double field" << std::endl;
+  BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, indexOptions);
+
+	// run some tests
+	checkPassFail(doubleScan(&index,25,GT,40,LT), 14)
+	checkPassFail(doubleScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(doubleScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(doubleScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(doubleScan(&index,0,GT,1,LT), 0)
+	checkPassFail(doubleScan(&index,300,GT,400,LT), 99)
+	checkPassFail(doubleScan(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(doubleScan(&index,24.5,GT,25.5,LT), 1)
+}
+
+// -----------------------------------------------------------------------------
+// stringTests
+// -----------------------------------------------------------------------------
+
+void stringTests()
+{
+  std::cout << "Create a B+ Tree index on the string field" << std::endl;
+  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, indexOptions);
+
+	// run some tests
+	checkPassFail(stringScan(&index,25,GT,40,LT), 14)
+	checkPassFail(stringScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(stringScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(stringScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(stringScan(&index,0,GT,1,LT), 0)
+	checkPassFail(stringScan(&index,300,GT,400,LT), 99)
+	checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
+	//Bounds shorter than the keys, against the prefixes the keys of a node share
+	checkPassFail(stringCount(&index,"0002",GTE,"0003",LT), 10)
+	checkPassFail(stringCount(&index,"00025 string record",GT,"00025 string recordz",LTE), 0)
+	checkPassFail(stringCount(&index,"00025 string recor",GT,"00025 string record",LTE), 1)
+	std::atomic<int> numRids(0);
+	checkPassFail((int) index.parallelScan("0", GTE, "a", LT, 4, [&](int worker, const RecordId* rids, size_t count) { numRids += count; }), relationSize)
+	checkPassFail(numRids.load(), relationSize)
+
+	char key[100];
+	std::vector<RecordId> rids;
+	sprintf(key, "%05d string record", 1234);
+	checkPassFail(index.lookup(key, rids), true)
+	sprintf(key, "%05d string record", relationSize + 1);
+	checkPassFail(index.lookup(key, rids), false)
+
+	//Copies of one key fill several leaves and make it a separator, a GTE scan from it must start on the first of them
+	sprintf(key, "%05d string record", 1234);
+	rids.clear();
+	checkPassFail(index.lookup(key, rids), true)
+	for(int i = 0; i < 1000; i++)
+		index.insertEntry(key, rids[0]);
+	checkPassFail(stringCount(&index,key,GTE,key,LTE), 1001)
+	checkPassFail(stringCount(&index,"01234",GTE,key,LTE), 1001)
+	checkPassFail(stringScan(&index,1233,GT,1235,LT), 1001)
+}
+
+int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+	
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	//SCHEN-Test
+	std::cout<<"Start testing Scan"<<std::endl;
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults < 5 )
+			{
+				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+			}
+			else if( numResults == 5 )
+			{
+				std::cout << "..." << std::endl;
+			}
+		}
+		catch(IndexScanCompletedException e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  if( numResults >= 5 )
+  {
+    std::cout << "Number of results: " << numResults << std::endl;
+  }
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+
+// -----------------------------------------------------------------------------
+// doubleScan
+// @return: the number of records found, -1 if a record is outside the range
+// -----------------------------------------------------------------------------
+
+int doubleScan(BTreeIndex * index, double lowVal, Operator lowOp, double highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(index->tryScanNext(scanRid))
+	{
+		bufMgr->readPage(file1, scanRid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+		bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+		if(myRec.d < lowVal || myRec.d > highVal || (lowOp == GT && myRec.d == lowVal) || (highOp == LT && myRec.d == highVal))
+		{
+			std::cout << "Out of range key:" << myRec.d << std::endl;
+			index->endScan();
+			return -1;
+		}
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// stringScan
+// The bounds are the strings the relations store for lowVal and highVal
+// @return: the number of records found, -1 if a record is outside the range
+// -----------------------------------------------------------------------------
+
+int stringScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+	char lowValStr[100];
+	sprintf(lowValStr,"%05d string record",lowVal);
+	char highValStr[100];
+	sprintf(highValStr,"%05d string record",highVal);
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(lowValStr, lowOp, highValStr, highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(index->tryScanNext(scanRid))
+	{
+		bufMgr->readPage(file1, scanRid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+		bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+		//The record with key i has i in its string
+		if(myRec.i < lowVal || myRec.i > highVal || (lowOp == GT && myRec.i == lowVal) || (highOp == LT && myRec.i == highVal))
+		{
+			std::cout << "Out of range key:" << myRec.s << std::endl;
+			index->endScan();
+			return -1;
+		}
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// intParallelScan
+// Scan with parallelScan() and check that every worker returned keys of the
+// range, in ascending order, below the keys of the next worker
+// @return: the number of entries scanned, -1 if a check failed
+// -----------------------------------------------------------------------------
+
+int compositeScan(BTreeIndex * index, const CompositeKey& lowVal, Operator lowOp, const CompositeKey& highVal, Operator highOp)
+{
+	//The entries must come in (i, d) or (s, i) order, whichever attributes the index has
+	RecordId scanRid;
+	Page *curPage;
+	int numResults = 0;
+	try
+	{
+		index->startScan(lowVal.data(), lowOp, highVal.data(), highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+		std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	RECORD last;
+	while(index->tryScanNext(scanRid))
+	{
+		bufMgr->readPage(file1, scanRid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+		bufMgr->unPinPage(file1, scanRid.page_number, false);
+		if(numResults > 0 && (myRec.i < last.i || (myRec.i == last.i && myRec.d < last.d)) && strcmp(myRec.s, last.s) < 0)
+		{
+			std::cout << "Key out of order:" << myRec.i << ":" << myRec.d << ":" << myRec.s << std::endl;
+			return -1;
+		}
+		last = myRec;
+		numResults++;
+	}
+	index->endScan();
+	std::cout << "Number of results: " << numResults << std::endl;
+	return numResults;
+}
+
+int intParallelScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numThreads)
+{
+	std::cout << "Parallel scan with " << numThreads << " threads for ";
+	if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+	std::cout << lowVal << "," << highVal;
+	if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+	std::cout << std::endl;
+
+	std::vector<std::vector<RecordId> > workerRids(numThreads);
+	int numResults = index->parallelScan(&lowVal, lowOp, &highVal, highOp, numThreads,
+		[&](int worker, const RecordId* rids, size_t count) { workerRids[worker].insert(workerRids[worker].end(), rids, rids + count); });
+
+	//Keys may repeat, but must not decrease from one worker to the next
+	int numChecked = 0, lastKey = lowVal;
+	Page *curPage;
+	for(int worker = 0; worker < numThreads; worker++)
+	{
+		for(size_t i = 0; i < workerRids[worker].size(); i++)
+		{
+			RecordId scanRid = workerRids[worker][i];
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+			if(myRec.i < lastKey || myRec.i > highVal || (lowOp == GT && myRec.i == lowVal) || (highOp == LT && myRec.i == highVal))
+			{
+				std::cout << "Worker " << worker << " returned key:" << myRec.i << " after " << lastKey << std::endl;
+				return -1;
+			}
+			lastKey = myRec.i;
+			numChecked++;
+		}
+	}
+	std::cout << "Number of results: " << numResults << std::endl << std::endl;
+	return numChecked == numResults ? numResults : -1;
+}
+
+// -----------------------------------------------------------------------------
+// deleteKeys
+// Delete every entry with a key in [firstKey, lastKey), found with lookup()
+// @return: the number of entries deleted
+// -----------------------------------------------------------------------------
+
+int deleteKeys(BTreeIndex * index, Datatype type, int firstKey, int lastKey)
+{
+	std::cout << "Delete keys [" << firstKey << "," << lastKey << ")" << std::endl;
+	int numDeleted = 0;
+	for(int i = firstKey; i < lastKey; i++)
+	{
+		double d = i;
+		char s[64];
+		sprintf(s, "%05d string record", i);
+		const void *key = type == INTEGER ? (const void *) &i : type == DOUBLE ? (const void *) &d : (const void *) s;
+
+		std::vector<RecordId> rids;
+		index->lookup(key, rids);
+		for(size_t j = 0; j < rids.size(); j++)
+			numDeleted += index->deleteEntry(key, rids[j]);
+	}
+	std::cout << "Entries deleted: " << numDeleted << std::endl;
+	return numDeleted;
+}
+
+// -----------------------------------------------------------------------------
+// insertKeys
+// Insert the entries of the records with i in [firstKey, lastKey) again
+// @return: the number of entries inserted
+// -----------------------------------------------------------------------------
+
+int insertKeys(BTreeIndex * index, int attrByteOffset, int firstKey, int lastKey)
+{
+	int numInserted = 0;
+	try
+	{
+		FileScan fscan(relationName, bufMgr);
+		RecordId scanRid;
+		while(1)
+		{
+			fscan.scanNext(scanRid);
+			std::string record = fscan.getRecord();
+			const RECORD *myRec = reinterpret_cast<const RECORD*>(record.data());
+			if(myRec->i >= firstKey && myRec->i < lastKey)
+			{
+				index->insertEntry(record.c_str() + attrByteOffset, scanRid);
+				numInserted++;
+			}
+		}
+	}
+	catch(EndOfFileException e)
+	{
+	}
+	std::cout << "Entries inserted: " << numInserted << std::endl;
+	return numInserted;
+}
+
+// -----------------------------------------------------------------------------
+// indexFileSize
+// Size in bytes of the index file on disk
+// -----------------------------------------------------------------------------
+
+long indexFileSize(const std::string & indexName)
+{
+	std::ifstream indexFile(indexName.c_str(), std::ios::binary | std::ios::ate);
+	return indexFile.tellg();
+}
+
+// -----------------------------------------------------------------------------
+// stringCount
+// Count the entries between two strings that are not stored keys themselves
+// -----------------------------------------------------------------------------
+
+int stringCount(BTreeIndex * index, const char *lowVal, Operator lowOp, const char *highVal, Operator highOp)
+{
+	std::cout << "Count for " << (lowOp == GT ? "(" : "[") << lowVal << "," << highVal << (highOp == LT ? ")" : "]") << std::endl;
+	try
+	{
+		index->startScan(lowVal, lowOp, highVal, highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+		return 0;
+	}
+
+	RecordId scanRid;
+	int numResults = 0;
+	while(index->tryScanNext(scanRid))
+		numResults++;
+	index->endScan();
+	std::cout << "Number of results: " << numResults << std::endl;
+	return numResults;
+}
+
+int intScanBatch(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanDirection direction)
+{
+	//Small enough that a scan spans several calls and leaves
+	const size_t batchSize = 200;
+  RecordId scanRids[batchSize];
+	Page *curPage;
+
+  std::cout << (direction == ASCENDING ? "Batch scan for " : "Descending batch scan for ");
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+	int lastKey = direction == ASCENDING ? lowVal : highVal;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp, direction);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	size_t numRids;
+	while((numRids = index->scanNextBatch(scanRids, batchSize)) > 0)
+	{
+		for(size_t i = 0; i < numRids; i++)
+		{
+			bufMgr->readPage(file1, scanRids[i].page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRids[i]).data()));
+			bufMgr->unPinPage(file1, scanRids[i].page_number, false);
+
+			//Keys come back in order and inside the range
+			bool outOfOrder = direction == ASCENDING ? myRec.i < lastKey : myRec.i > lastKey;
+			if(outOfOrder || myRec.i < lowVal || myRec.i > highVal || (lowOp == GT && myRec.i == lowVal) || (highOp == LT && myRec.i == highVal))
+			{
+				std::cout << "Out of order or out of range key:" << myRec.i << std::endl;
+				return -1;
+			}
+			lastKey = myRec.i;
+		}
+		numResults += numRids;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// intTopN
+// ORDER BY key DESC LIMIT query over [lowVal, highVal]: a descending scan that
+// stops after limit records
+// @return: the sum of the keys returned, -1 if they are not the highest ones in order
+// -----------------------------------------------------------------------------
+
+int intTopN(BTreeIndex * index, int lowVal, int highVal, int limit)
+{
+	RecordId scanRid;
+	Page *curPage;
+	int sum = 0;
+
+  std::cout << "Top " << limit << " of [" << lowVal << "," << highVal << "]" << std::endl;
+
+	try
+	{
+  	index->startScan(&lowVal, GTE, &highVal, LTE, DESCENDING);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	//Every key in the relations is unique, so the i-th record is highVal - i
+	for(int i = 0; i < limit && index->tryScanNext(scanRid); i++)
+	{
+		bufMgr->readPage(file1, scanRid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+		bufMgr->unPinPage(file1, scanRid.page_number, false);
+		if(myRec.i != highVal - i)
+		{
+			std::cout << "Unexpected key:" << myRec.i << std::endl;
+			index->endScan();
+			return -1;
+		}
+		sum += myRec.i;
+	}
+  index->endScan();
+  std::cout << "Sum of keys: " << sum << std::endl << std::endl;
+
+	return sum;
+}
+
+// -----------------------------------------------------------------------------
+// intLookup
+// Point lookups for every key in [firstKey, firstKey + numKeys)
+// @return: the number of keys found, -1 if a lookup returns a wrong record
+// -----------------------------------------------------------------------------
+
+int intLookup(BTreeIndex * index, int firstKey, int numKeys)
+{
+	Page *curPage;
+	int numFound = 0;
+
+  std::cout << "Lookup of " << numKeys << " keys from " << firstKey << std::endl;
+
+	for(int key = firstKey; key < firstKey + numKeys; key++)
+	{
+		std::vector<RecordId> rids;
+		if(!index->lookup(&key, rids))
+			continue;
+		for(size_t i = 0; i < rids.size(); i++)
+		{
+			bufMgr->readPage(file1, rids[i].page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rids[i]).data()));
+			bufMgr->unPinPage(file1, rids[i].page_number, false);
+			if(myRec.i != key)
+			{
+				std::cout << "Lookup of " << key << " returned key:" << myRec.i << std::endl;
+				return -1;
+			}
+		}
+		numFound++;
+	}
+  std::cout << "Keys found: " << numFound << std::endl << std::endl;
+
+	return numFound;
+}
+
+// -----------------------------------------------------------------------------
+// intJoin
+// Nested-loop self join on the integer field: an outer cursor walks [lowVal, highVal)
+// and for every record an inner cursor probes the index for the same key, while the
+// index's own scan stays open over the whole range.
+// -----------------------------------------------------------------------------
+int intJoin(BTreeIndex * index, int lowVal, int highVal)
+{
+	IndexCursor outer(index);
+	IndexCursor inner(index);
+  RecordId outerRid, innerRid, scanRid;
+	Page *curPage;
+
+  std::cout << "Join on [" << lowVal << "," << highVal << ")" << std::endl;
+
+	int numResults = 0;
+	index->startScan(&lowVal, GTE, &highVal, LT);
+	outer.startScan(&lowVal, GTE, &highVal, LT);
+	while(outer.tryScanNext(outerRid))
+	{
+		bufMgr->readPage(file1, outerRid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(outerRid).data()));
+		bufMgr->unPinPage(file1, outerRid.page_number, false);
+
+		inner.startScan(&myRec.i, GTE, &myRec.i, LTE);
+		while(inner.tryScanNext(innerRid))
+		{
+			if(innerRid == outerRid)
+				numResults++;
+		}
+
+		//The index's own scan moves in step with the outer cursor
+		if(!index->tryScanNext(scanRid) || scanRid != outerRid)
+		{
+			std::cout << "Index scan out of step with outer cursor" << std::endl;
+			return -1;
+		}
+	}
+	inner.endScan();
+	outer.endScan();
+	index->endScan();
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// errorTests
+// -----------------------------------------------------------------------------
+
+void errorTests()
+{
+	std::cout << "Error handling tests" << std::endl;
+	std::cout << "--------------------" << std::endl;
+	// Given error test
+
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  file1 = new PageFile(relationName, true);
+	
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
 	PageId new_page_number;
@@ -635,6 +2469,28 @@ void errorTests()
 		std::cout << "BadScanrangeException Test 1 Passed." << std::endl;
 	}
 
+	std::cout << "Call scanNext after the scan is completed" << std::endl;
+	{
+		RecordId foo;
+		int numResults = 0;
+  	index.startScan(&int2, GTE, &int5, LTE);
+		while(index.tryScanNext(foo))
+			numResults++;
+		try
+		{
+			index.scanNext(foo);
+			std::cout << "IndexScanCompletedException Test 1 Failed." << std::endl;
+		}
+		catch(IndexScanCompletedException e)
+		{
+			if(numResults == 4 && !index.tryScanNext(foo))
+				std::cout << "IndexScanCompletedException Test 1 Passed." << std::endl;
+			else
+				std::cout << "IndexScanCompletedException Test 1 Failed." << std::endl;
+		}
+		index.endScan();
+	}
+
 	deleteRelation();
 }
 
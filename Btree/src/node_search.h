@@ -0,0 +1,166 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace badgerdb
+{
+
+/**
+ * @brief Window size at which the binary search stops halving and the
+ * remaining keys are compared in one vector pass (two AVX2 registers).
+ */
+const int NODE_SEARCH_WINDOW = 16;
+
+/**
+ * @brief Count the keys in keyArray[0, count) that are less than key, or not
+ * greater than key if UPPER is set. The keys are compared 8 (AVX2) or 4 (SSE2)
+ * at a time, the remainder one by one without branching.
+ *
+ * @param keyArray	Sorted keys
+ * @param count			Number of keys to look at, at most NODE_SEARCH_WINDOW on the hot path
+ * @param key				Key searched for
+ * @return					Number of keys ordered before key
+ */
+template <bool UPPER>
+inline int nodeSearchWindow(const int *keyArray, int count, int key)
+{
+	int below = 0;
+	int i = 0;
+#if defined(__AVX2__)
+	__m256i needle = _mm256_set1_epi32(key);
+	for(; i + 8 <= count; i += 8){
+		__m256i keys = _mm256_loadu_si256((const __m256i *) (keyArray + i));
+		__m256i mask = UPPER ? _mm256_cmpgt_epi32(keys, needle) : _mm256_cmpgt_epi32(needle, keys);
+		int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+		below += UPPER ? 8 - bits : bits;
+	}
+#elif defined(__SSE2__)
+	__m128i needle = _mm_set1_epi32(key);
+	for(; i + 4 <= count; i += 4){
+		__m128i keys = _mm_loadu_si128((const __m128i *) (keyArray + i));
+		__m128i mask = UPPER ? _mm_cmpgt_epi32(keys, needle) : _mm_cmpgt_epi32(needle, keys);
+		int bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(mask)));
+		below += UPPER ? 4 - bits : bits;
+	}
+#endif
+	for(; i < count; i++)
+		below += UPPER ? keyArray[i] <= key : keyArray[i] < key;
+	return below;
+}
+
+/**
+ * @brief Branch-free binary search over the sorted keys of a node. Each step
+ * halves the window with a conditional move instead of a branch, and the last
+ * NODE_SEARCH_WINDOW keys are handed to nodeSearchWindow().
+ *
+ * @param keyArray	Sorted keys of the node
+ * @param count			Number of valid keys in keyArray
+ * @param key				Key searched for
+ * @return					Index of the first key >= key, or > key if UPPER is set. count if there is none.
+ */
+template <bool UPPER>
+inline int nodeSearch(const int *keyArray, int count, int key)
+{
+	const int *base = keyArray;
+	int len = count;
+	while(len > NODE_SEARCH_WINDOW){
+		int half = len / 2;
+		bool right = UPPER ? base[half - 1] <= key : base[half - 1] < key;
+		base = right ? base + half : base;
+		len -= half;
+	}
+	return (base - keyArray) + nodeSearchWindow<UPPER>(base, len, key);
+}
+
+/**
+ * @brief Search the keys of a node laid out by cache lines of NODE_SEARCH_WINDOW keys. lineKeys holds the last
+ * key of each full line and groupKeys the last key of each full group of NODE_SEARCH_WINDOW lines. The group
+ * separators, the line separators of one group and the keys of one line are each compared in one vector pass.
+ *
+ * @param groupKeys	Last key of each full group
+ * @param lineKeys	Last key of each full line
+ * @param keyArray	Sorted keys of the node
+ * @param count			Number of valid keys in keyArray
+ * @param key				Key searched for
+ * @return					Index of the first key >= key, or > key if UPPER is set. count if there is none.
+ */
+template <bool UPPER>
+inline int directorySearch(const int *groupKeys, const int *lineKeys, const int *keyArray, int count, int key)
+{
+	//The full groups before the key, then the full lines of its group before it
+	int numLines = count / NODE_SEARCH_WINDOW;
+	int line = nodeSearchWindow<UPPER>(groupKeys, numLines / NODE_SEARCH_WINDOW, key) * NODE_SEARCH_WINDOW;
+	int linesLeft = numLines - line;
+	line += nodeSearchWindow<UPPER>(lineKeys + line, linesLeft < NODE_SEARCH_WINDOW ? linesLeft : NODE_SEARCH_WINDOW, key);
+
+	int first = line * NODE_SEARCH_WINDOW;
+	int keysLeft = count - first;
+	return first + nodeSearchWindow<UPPER>(keyArray + first, keysLeft < NODE_SEARCH_WINDOW ? keysLeft : NODE_SEARCH_WINDOW, key);
+}
+
+/**
+ * @brief Branch-free binary search for any key type with a less-than operator,
+ * halving the window down to a single key.
+ *
+ * @param keyArray	Sorted keys of the node
+ * @param count			Number of valid keys in keyArray
+ * @param key				Key searched for
+ * @return					Index of the first key >= key, or > key if UPPER is set. count if there is none.
+ */
+template <bool UPPER, class T>
+inline int keySearch(const T *keyArray, int count, const T &key)
+{
+	const T *base = keyArray;
+	int len = count;
+	while(len > 1){
+		int half = len / 2;
+		bool right = UPPER ? !(key < base[half - 1]) : base[half - 1] < key;
+		base = right ? base + half : base;
+		len -= half;
+	}
+	int last = len == 1 && (UPPER ? !(key < base[0]) : base[0] < key);
+	return (base - keyArray) + last;
+}
+
+/**
+ * @brief Slot of the first key not less than key. Used to place a new entry in a leaf
+ * and to position a GTE scan.
+ */
+inline int lowerBoundKey(const int *keyArray, int count, int key)
+{
+	return nodeSearch<false>(keyArray, count, key);
+}
+
+template <class T>
+inline int lowerBoundKey(const T *keyArray, int count, const T &key)
+{
+	return keySearch<false>(keyArray, count, key);
+}
+
+/**
+ * @brief Slot of the first key greater than key. In a non-leaf node this is the
+ * index of the child to descend into.
+ */
+inline int upperBoundKey(const int *keyArray, int count, int key)
+{
+	return nodeSearch<true>(keyArray, count, key);
+}
+
+template <class T>
+inline int upperBoundKey(const T *keyArray, int count, const T &key)
+{
+	return keySearch<true>(keyArray, count, key);
+}
+
+}
@@ -0,0 +1,317 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Microbenchmark for the in-node key search. Compares the linear sentinel scan
+ * the B+ tree used to do against nodeSearch() on full leaf and non-leaf nodes,
+ * reporting key compares and time per lookup. Then builds the 600000 key
+ * INTEGER trees of test6 and test7 and descends their non-leaf nodes with a
+ * binary search over the flat keyArray and with directorySearch(), reporting
+ * the cache lines each reads per node and the time per descent.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+#include "btree.h"
+#include "node_search.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const int numLookups = 1000000;
+const std::string relationName = "relNodeSearch";
+const int numTreeKeys = 600000;
+long compares = 0;
+std::set<std::uintptr_t> lines;
+
+// -----------------------------------------------------------------------------
+// linearSearch
+// The old descent: walk keyArray until a greater key or the first empty child
+// -----------------------------------------------------------------------------
+int linearSearch(const int *keyArray, const PageId *pageNoArray, int size, int key)
+{
+	int idx;
+	for(idx = 0; idx < size; idx++){
+		compares++;
+		if(key < keyArray[idx] || pageNoArray[idx + 1] == 0)
+			break;
+	}
+	return idx;
+}
+
+// -----------------------------------------------------------------------------
+// countedNodeSearch
+// Same steps as nodeSearch<true>(), counting one compare per binary step, one per
+// vector compare instruction and one per scalar tail key
+// -----------------------------------------------------------------------------
+int countedNodeSearch(const int *keyArray, int count, int key)
+{
+	const int *base = keyArray;
+	int len = count;
+	while(len > NODE_SEARCH_WINDOW){
+		int half = len / 2;
+		compares++;
+		base = base[half - 1] <= key ? base + half : base;
+		len -= half;
+	}
+#if defined(__AVX2__)
+	const int lanes = 8;
+#elif defined(__SSE2__)
+	const int lanes = 4;
+#else
+	const int lanes = 1;
+#endif
+	compares += len / lanes + len % lanes;
+	return (base - keyArray) + nodeSearchWindow<true>(base, len, key);
+}
+
+void runNode(const char *name, int size)
+{
+	std::vector<int> keyArray(size);
+	std::vector<PageId> pageNoArray(size + 1);
+	for(int i = 0; i < size; i++){
+		keyArray[i] = i * 4;
+		pageNoArray[i] = i + 1;
+	}
+	pageNoArray[size] = size + 1;
+
+	std::vector<int> keys(numLookups);
+	for(int i = 0; i < numLookups; i++)
+		keys[i] = random() % (size * 4);
+
+	//Both searches must agree before anything is measured
+	compares = 0;
+	for(int i = 0; i < numLookups; i++){
+		if(linearSearch(&keyArray[0], &pageNoArray[0], size, keys[i]) != countedNodeSearch(&keyArray[0], size, keys[i])){
+			std::cout << "Search mismatch for key " << keys[i] << std::endl;
+			exit(1);
+		}
+	}
+
+	compares = 0;
+	for(int i = 0; i < numLookups; i++)
+		linearSearch(&keyArray[0], &pageNoArray[0], size, keys[i]);
+	double linearCompares = (double) compares / numLookups;
+
+	compares = 0;
+	for(int i = 0; i < numLookups; i++)
+		countedNodeSearch(&keyArray[0], size, keys[i]);
+	double searchCompares = (double) compares / numLookups;
+
+	long sink = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(int i = 0; i < numLookups; i++){
+		int idx;
+		for(idx = 0; idx < size; idx++)
+			if(keys[i] < keyArray[idx] || pageNoArray[idx + 1] == 0)
+				break;
+		sink += idx;
+	}
+	std::chrono::steady_clock::time_point mid = std::chrono::steady_clock::now();
+	for(int i = 0; i < numLookups; i++)
+		sink += upperBoundKey(&keyArray[0], size, keys[i]);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	double linearNs = std::chrono::duration<double, std::nano>(mid - start).count() / numLookups;
+	double searchNs = std::chrono::duration<double, std::nano>(end - mid).count() / numLookups;
+
+	std::cout << name << " (" << size << " keys)" << std::endl;
+	std::cout << "  linear scan: " << linearCompares << " compares/lookup, " << linearNs << " ns/lookup" << std::endl;
+	std::cout << "  nodeSearch:  " << searchCompares << " compares/lookup, " << searchNs << " ns/lookup" << std::endl;
+	if(sink == 0)
+		std::cout << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+// touch
+// Note the cache lines of numBytes bytes from begin as read
+// -----------------------------------------------------------------------------
+void touch(const void *begin, int numBytes)
+{
+	std::uintptr_t first = (std::uintptr_t) begin / CACHELINESIZE;
+	std::uintptr_t last = ((std::uintptr_t) begin + numBytes - 1) / CACHELINESIZE;
+	for(std::uintptr_t line = first; line <= last; line++)
+		lines.insert(line);
+}
+
+// -----------------------------------------------------------------------------
+// flatLines, directoryLines
+// Cache lines of a non-leaf that upperBoundKey() over the flat keyArray and
+// directorySearch<true>() read, the line holding numKeys included
+// -----------------------------------------------------------------------------
+int flatLines(const NonLeafNodeInt *node, int key)
+{
+	lines.clear();
+	touch(&node->numKeys, sizeof(int));
+	const int *base = node->keyArray;
+	int len = node->numKeys;
+	while(len > NODE_SEARCH_WINDOW){
+		int half = len / 2;
+		touch(base + half - 1, sizeof(int));
+		base = base[half - 1] <= key ? base + half : base;
+		len -= half;
+	}
+	if(len > 0)
+		touch(base, len * sizeof(int));
+	return lines.size();
+}
+
+int directoryLines(const NonLeafNodeInt *node, int key)
+{
+	lines.clear();
+	touch(&node->numKeys, sizeof(int));
+	int numLines = node->numKeys / LINEKEYS;
+	int numGroups = numLines / LINEKEYS;
+	if(numGroups > 0)
+		touch(node->groupKeys, numGroups * sizeof(int));
+	int line = nodeSearchWindow<true>(node->groupKeys, numGroups, key) * LINEKEYS;
+	int linesLeft = std::min(numLines - line, LINEKEYS);
+	if(linesLeft > 0)
+		touch(node->lineKeys + line, linesLeft * sizeof(int));
+	line += nodeSearchWindow<true>(node->lineKeys + line, linesLeft, key);
+	int first = line * LINEKEYS;
+	int keysLeft = std::min(node->numKeys - first, LINEKEYS);
+	if(keysLeft > 0)
+		touch(node->keyArray + first, keysLeft * sizeof(int));
+	return lines.size();
+}
+
+// -----------------------------------------------------------------------------
+// runTree
+// Insert keys into an empty INTEGER index, then descend its non-leaf nodes
+// for every key in random order
+// -----------------------------------------------------------------------------
+void runTree(const char *name, const std::vector<int>& keys)
+{
+	std::string indexName;
+	BufMgr *bufMgr = new BufMgr(100);
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, 0, INTEGER);
+		for(size_t i = 0; i < keys.size(); i++)
+			index.insertEntry(&keys[i], RecordId());
+	}
+
+	//Pin the non-leaf nodes, level by level from the root
+	std::map<PageId, const NonLeafNodeInt *> nodes;
+	{
+		BlobFile file(indexName, false);
+		Page *page;
+		bufMgr->readPage(&file, 1, page);
+		std::vector<PageId> pageNos(1, ((IndexMetaInfo *) page)->rootPageNo);
+		bufMgr->unPinPage(&file, 1, false);
+		for(size_t i = 0; i < pageNos.size(); i++){
+			bufMgr->readPage(&file, pageNos[i], page);
+			const NonLeafNodeInt *node = (const NonLeafNodeInt *) page;
+			nodes[pageNos[i]] = node;
+			for(int c = 0; node->level > 1 && c <= node->numKeys; c++)
+				pageNos.push_back(node->pageNoArray[c]);
+		}
+		const NonLeafNodeInt *root = nodes[pageNos[0]];
+
+		std::vector<int> lookups(keys);
+		std::random_shuffle(lookups.begin(), lookups.end());
+
+		//Both searches must agree on every node before anything is measured
+		long flatTotal = 0, directoryTotal = 0, numNodes = 0;
+		for(size_t i = 0; i < lookups.size(); i++){
+			for(const NonLeafNodeInt *node = root; ; ){
+				int idx = upperBoundKey(node->keyArray, node->numKeys, lookups[i]);
+				if(idx != directorySearch<true>(node->groupKeys, node->lineKeys, node->keyArray, node->numKeys, lookups[i])){
+					std::cout << "Search mismatch for key " << lookups[i] << std::endl;
+					exit(1);
+				}
+				flatTotal += flatLines(node, lookups[i]);
+				directoryTotal += directoryLines(node, lookups[i]);
+				numNodes++;
+				if(node->level == 1)
+					break;
+				node = nodes[node->pageNoArray[idx]];
+			}
+		}
+
+		long sink = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < lookups.size(); i++){
+			const NonLeafNodeInt *node = root;
+			PageId child;
+			while(1){
+				child = node->pageNoArray[upperBoundKey(node->keyArray, node->numKeys, lookups[i])];
+				if(node->level == 1)
+					break;
+				node = nodes[child];
+			}
+			sink += child;
+		}
+		std::chrono::steady_clock::time_point mid = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < lookups.size(); i++){
+			const NonLeafNodeInt *node = root;
+			PageId child;
+			while(1){
+				child = node->pageNoArray[directorySearch<true>(node->groupKeys, node->lineKeys, node->keyArray, node->numKeys, lookups[i])];
+				if(node->level == 1)
+					break;
+				node = nodes[child];
+			}
+			sink += child;
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		double flatNs = std::chrono::duration<double, std::nano>(mid - start).count() / lookups.size();
+		double directoryNs = std::chrono::duration<double, std::nano>(end - mid).count() / lookups.size();
+		std::cout << name << " (" << keys.size() << " keys, " << root->level << " non-leaf levels, " << nodes.size() << " non-leaf nodes)" << std::endl;
+		std::cout << "  flat keyArray:   " << (double) flatTotal / numNodes << " lines/node, " << flatNs << " ns/descent" << std::endl;
+		std::cout << "  directorySearch: " << (double) directoryTotal / numNodes << " lines/node, " << directoryNs << " ns/descent" << std::endl;
+		if(sink == 0)
+			std::cout << std::endl;
+
+		for(std::map<PageId, const NonLeafNodeInt *>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+			bufMgr->unPinPage(&file, it->first, false);
+		bufMgr->flushFile(&file);
+	}
+	File::remove(indexName);
+	delete bufMgr;
+}
+
+int main(int argc, char **argv)
+{
+#if defined(__AVX2__)
+	std::cout << "Vector path: AVX2" << std::endl;
+#elif defined(__SSE2__)
+	std::cout << "Vector path: SSE2" << std::endl;
+#else
+	std::cout << "Vector path: none" << std::endl;
+#endif
+	runNode("LeafNodeInt", INTARRAYLEAFSIZE);
+	runNode("NonLeafNodeInt", INTARRAYNONLEAFSIZE);
+
+	//The index is filled by inserts, the relation stays empty
+	try{
+		File::remove(relationName);
+	}catch(FileNotFoundException e){}
+	{
+		PageFile::create(relationName);
+	}
+	std::vector<int> keys;
+	for(int i = 0; i < numTreeKeys; i++)
+		keys.push_back(i);
+	runTree("Ascending keys, test6", keys);
+	std::reverse(keys.begin(), keys.end());
+	runTree("Descending keys, test7", keys);
+	std::random_shuffle(keys.begin(), keys.end());
+	runTree("Random keys", keys);
+	File::remove(relationName);
+	return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Benchmark for ExternalSort. Sorts random 100-byte records about ten times the
+ * size of the buffer pool with several fan-ins, reporting the seconds taken and
+ * the number of runs written for each.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "external_sort.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const int numFrames = 256;
+const int recordSize = 100;
+const int numRecords = 10 * numFrames * Page::SIZE / recordSize;
+std::vector<std::string> records;
+
+void runBench(int memoryFrames, int fanIn)
+{
+	BufMgr *bufMgr = new BufMgr(numFrames);
+	ExternalSort::LessThan lessThan = [](const std::string& a, const std::string& b)
+	{
+		return memcmp(a.data(), b.data(), sizeof(int)) < 0;
+	};
+	int numRuns, count = 0;
+	bool sorted = true;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		ExternalSort sort(bufMgr, "sortBench", lessThan, memoryFrames, fanIn);
+		for(int i = 0; i < numRecords; i++)
+			sort.add(records[i]);
+		sort.finish();
+
+		std::string record, previous;
+		while(sort.next(record)){
+			if(count++ > 0 && lessThan(record, previous))
+				sorted = false;
+			previous.swap(record);
+		}
+		numRuns = sort.getNumRunsWritten();
+	}
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	delete bufMgr;
+
+	std::cout << memoryFrames << " pages, fan-in " << fanIn << ": " << secs << " s, " << numRuns << " runs"
+		<< (sorted && count == numRecords ? "" : ", NOT SORTED") << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	//Keys compare bytewise, so they are stored big-endian
+	for(int i = 0; i < numRecords; i++){
+		std::string record(recordSize, ' ');
+		unsigned int key = random();
+		for(int b = 0; b < 4; b++)
+			record[b] = (char) (key >> (24 - 8 * b));
+		records.push_back(record);
+	}
+
+	std::cout << numRecords << " records of " << recordSize << " bytes, " << numFrames << " buffer frames" << std::endl;
+	runBench(16, 4);
+	runBench(16, 15);
+	runBench(65, 64);
+	runBench(255, 64);
+	return 0;
+}